@@ -0,0 +1,215 @@
+#include "ac.h"
+#include "dict.h"
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NONE UINT32_MAX // No state, or no entry.
+
+// An Aho-Corasick automaton over the oldspeak of a dictionary, laid out as a DFA. Bytes are mapped to classes
+// first, one for each distinct byte of the dictionary and one for every other byte, so each state has a row of
+// classes transitions and a scan does one table read per byte. Letters are folded to lowercase by the class map, and
+// every whitespace byte maps to the class of a space.
+struct Automaton {
+    uint8_t classes[256];
+    uint32_t width; // Number of classes.
+    uint32_t states;
+    uint32_t capacity;
+    uint32_t *delta; // states * width transitions.
+    uint32_t *output; // First state on the suffix chain of each state that ends an entry, or NONE.
+    uint32_t *next; // First state that ends an entry on the suffix chain after the state's own output.
+    uint32_t *entry; // Entry ended by each state, or NONE.
+    Entry *entries;
+    uint32_t count;
+};
+
+// The patterns of a dictionary while the automaton is built.
+typedef struct {
+    Automaton *ac;
+    bool failed;
+} Builder;
+
+// This function is a helper function that returns the byte the automaton reads for c.
+static inline unsigned char fold(unsigned char c) {
+    return isspace(c) ? ' ' : (unsigned char) tolower(c);
+}
+
+// This function is a helper function that collects an entry and gives each of its bytes a class.
+static void collect(const Entry *e, void *arg) {
+    Builder *b = (Builder *) arg;
+    Automaton *ac = b->ac;
+    if (b->failed) {
+        return;
+    }
+    if ((ac->count & (ac->count - 1)) == 0) {
+        Entry *entries = (Entry *) realloc(ac->entries, (size_t) (ac->count ? 2 * ac->count : 1) * sizeof(Entry));
+        if (!entries) {
+            b->failed = true;
+            return;
+        }
+        ac->entries = entries;
+    }
+    ac->entries[ac->count++] = *e;
+    for (const char *c = e->oldspeak; *c != '\0'; c++) {
+        unsigned char f = fold((unsigned char) *c);
+        if (ac->classes[f] == 0) {
+            ac->classes[f] = (uint8_t) ac->width++;
+        }
+    }
+}
+
+// This function is a helper function that adds a state with no transitions.
+// Returns the new state, or NONE if memory could not be allocated.
+static uint32_t add_state(Automaton *ac) {
+    if (ac->states == ac->capacity) {
+        uint32_t capacity = ac->capacity ? 2 * ac->capacity : 1024;
+        uint32_t *delta = (uint32_t *) realloc(ac->delta, (size_t) capacity * ac->width * sizeof(uint32_t));
+        if (!delta) {
+            return NONE;
+        }
+        ac->delta = delta;
+        uint32_t *entry = (uint32_t *) realloc(ac->entry, (size_t) capacity * sizeof(uint32_t));
+        if (!entry) {
+            return NONE;
+        }
+        ac->entry = entry;
+        ac->capacity = capacity;
+    }
+    memset(ac->delta + (size_t) ac->states * ac->width, 0, (size_t) ac->width * sizeof(uint32_t));
+    ac->entry[ac->states] = NONE;
+    return ac->states++;
+}
+
+// This function is the constructor for an Aho-Corasick automaton. The oldspeak of every entry is added to a trie,
+// then the trie is walked breadth first to fill in the missing transitions from the failure links. A state that
+// was entered on a space loops on further spaces, so a run of whitespace in the input matches the single space
+// between the words of a phrase.
+// This function takes in as a parameter the Dictionary dict, which must outlive the automaton.
+// This function returns the created Automaton, or NULL if memory could not be allocated.
+Automaton *ac_create(Dictionary *dict) {
+    Automaton *ac = (Automaton *) calloc(1, sizeof(Automaton));
+    if (!ac) {
+        return NULL;
+    }
+    Builder b = { ac, false };
+    ac->width = 1;
+    dict_walk(dict, collect, &b);
+    for (int c = 0; c < 256; c++) {
+        ac->classes[c] = ac->classes[fold((unsigned char) c)];
+    }
+    if (b.failed || add_state(ac) == NONE) {
+        ac_delete(&ac);
+        return NULL;
+    }
+
+    // Building the trie. Transitions to the start state are missing, since no entry leads back to it.
+    for (uint32_t i = 0; i < ac->count; i++) {
+        uint32_t s = AC_START;
+        for (const char *c = ac->entries[i].oldspeak; *c != '\0'; c++) {
+            uint32_t *t = &ac->delta[(size_t) s * ac->width + ac->classes[(unsigned char) *c]];
+            if (*t == AC_START) {
+                uint32_t state = add_state(ac);
+                if (state == NONE) {
+                    ac_delete(&ac);
+                    return NULL;
+                }
+                t = &ac->delta[(size_t) s * ac->width + ac->classes[(unsigned char) *c]];
+                *t = state;
+            }
+            s = *t;
+        }
+        if (ac->entry[s] == NONE) {
+            ac->entry[s] = i;
+        }
+    }
+
+    // Filling in the transitions and outputs breadth first, so the failure link of a state is done before it
+    uint32_t *queue = (uint32_t *) malloc((size_t) ac->states * sizeof(uint32_t));
+    uint32_t *fail = (uint32_t *) malloc((size_t) ac->states * sizeof(uint32_t));
+    uint8_t *incoming = (uint8_t *) calloc(ac->states, sizeof(uint8_t));
+    ac->output = (uint32_t *) malloc((size_t) ac->states * sizeof(uint32_t));
+    ac->next = (uint32_t *) malloc((size_t) ac->states * sizeof(uint32_t));
+    if (!queue || !fail || !incoming || !ac->output || !ac->next) {
+        free(queue);
+        free(fail);
+        free(incoming);
+        ac_delete(&ac);
+        return NULL;
+    }
+    uint8_t space = ac->classes[' '];
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    fail[AC_START] = AC_START;
+    ac->output[AC_START] = NONE;
+    ac->next[AC_START] = NONE;
+    queue[tail++] = AC_START;
+    while (head < tail) {
+        uint32_t s = queue[head++];
+        uint32_t *row = &ac->delta[(size_t) s * ac->width];
+        const uint32_t *fallback = &ac->delta[(size_t) fail[s] * ac->width];
+        for (uint32_t c = 0; c < ac->width; c++) {
+            if (row[c] != AC_START) {
+                uint32_t t = row[c];
+                fail[t] = s == AC_START ? AC_START : fallback[c];
+                incoming[t] = (uint8_t) c;
+                ac->next[t] = ac->output[fail[t]];
+                ac->output[t] = ac->entry[t] != NONE ? t : ac->next[t];
+                queue[tail++] = t;
+            } else if (s != AC_START && space != 0 && c == space && incoming[s] == space) {
+                row[c] = s;
+            } else if (s != AC_START) {
+                row[c] = fallback[c];
+            }
+        }
+    }
+    free(queue);
+    free(fail);
+    free(incoming);
+    return ac;
+}
+
+// This function is the destructor for an Aho-Corasick automaton.
+// This function takes in as a parameter a double pointer to the Automaton ac.
+void ac_delete(Automaton **ac) {
+    free((*ac)->delta);
+    free((*ac)->output);
+    free((*ac)->next);
+    free((*ac)->entry);
+    free((*ac)->entries);
+    free(*ac);
+    *ac = NULL;
+}
+
+// This function returns the number of states of an Aho-Corasick automaton.
+// This function takes in as a parameter an Automaton ac.
+uint32_t ac_states(Automaton *ac) {
+    return ac->states;
+}
+
+// This function returns the number of byte classes, and transitions per state, of an Aho-Corasick automaton.
+// This function takes in as a parameter an Automaton ac.
+uint32_t ac_classes(Automaton *ac) {
+    return ac->width;
+}
+
+// This function runs the automaton over length bytes of data in a single pass and calls hit for every entry that
+// ends in it, whether or not the entry starts or ends on a word boundary. A scan can be continued over the next
+// bytes of the same input by passing in the state the last scan returned.
+// This function takes in as parameters an Automaton ac, the uint32_t state to start in, the char data and its
+// size_t length, the function hit, and a void arg which is passed on to hit.
+// This function returns the state the automaton is in after the last byte.
+uint32_t ac_scan(Automaton *ac, uint32_t state, const char *data, size_t length,
+    void (*hit)(const Entry *e, void *arg), void *arg) {
+    const uint32_t *delta = ac->delta;
+    const uint32_t width = ac->width;
+    for (size_t i = 0; i < length; i++) {
+        state = delta[(size_t) state * width + ac->classes[(unsigned char) data[i]]];
+        for (uint32_t o = ac->output[state]; o != NONE; o = ac->next[o]) {
+            hit(&ac->entries[ac->entry[o]], arg);
+        }
+    }
+    return state;
+}
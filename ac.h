@@ -0,0 +1,21 @@
+#pragma once
+
+#include "dict.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AC_START 0 // State the automaton starts a scan in.
+
+typedef struct Automaton Automaton;
+
+Automaton *ac_create(Dictionary *dict);
+
+void ac_delete(Automaton **ac);
+
+uint32_t ac_states(Automaton *ac);
+
+uint32_t ac_classes(Automaton *ac);
+
+uint32_t ac_scan(Automaton *ac, uint32_t state, const char *data, size_t length,
+    void (*hit)(const Entry *e, void *arg), void *arg);
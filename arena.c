@@ -0,0 +1,79 @@
+#include "arena.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define FIRST_BLOCK 65536 // Size of the first block. Each block after it is twice as large, up to LAST_BLOCK.
+#define LAST_BLOCK  (1 << 24)
+#define ALIGNMENT   sizeof(void *)
+
+// A block of memory that allocations are bumped out of. Blocks are chained so they can all be freed at once.
+typedef struct Block Block;
+
+struct Block {
+    Block *next;
+    size_t used;
+    size_t capacity;
+    max_align_t data[];
+};
+
+struct Arena {
+    Block *head; // Block currently allocated from. Earlier blocks follow it.
+    size_t block_size;
+    size_t used; // Bytes handed out by arena_alloc().
+};
+
+// This function is the constructor for an arena that memory is bump allocated from and freed all at once.
+// This function returns the created Arena, or NULL if memory could not be allocated.
+Arena *arena_create(void) {
+    Arena *a = (Arena *) calloc(1, sizeof(Arena));
+    if (a) {
+        a->block_size = FIRST_BLOCK;
+    }
+    return a;
+}
+
+// This function is the destructor for an arena. It frees every allocation made from the arena.
+// This function takes in as a parameter a double pointer to the Arena a.
+void arena_delete(Arena **a) {
+    Block *b = (*a)->head;
+    while (b) {
+        Block *next = b->next;
+        free(b);
+        b = next;
+    }
+    free(*a);
+    *a = NULL;
+}
+
+// This function allocates size bytes from an arena, aligned for a pointer. The memory stays valid until the arena
+// is deleted and cannot be freed on its own. An allocation larger than a block gets a block to itself.
+// This function takes in as parameters an Arena a and the size_t size of the allocation.
+// This function returns a pointer to the memory, or NULL if memory could not be allocated.
+void *arena_alloc(Arena *a, size_t size) {
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    Block *b = a->head;
+    if (!b || b->capacity - b->used < size) {
+        size_t capacity = size > a->block_size ? size : a->block_size;
+        b = (Block *) malloc(sizeof(Block) + capacity);
+        if (!b) {
+            return NULL;
+        }
+        b->used = 0;
+        b->capacity = capacity;
+        b->next = a->head;
+        a->head = b;
+        a->block_size = a->block_size < LAST_BLOCK ? 2 * a->block_size : LAST_BLOCK;
+    }
+    void *p = (char *) b->data + b->used;
+    b->used += size;
+    a->used += size;
+    return p;
+}
+
+// This function returns the number of bytes allocated from an arena.
+// This function takes in as a parameter an Arena a.
+size_t arena_used(Arena *a) {
+    return a->used;
+}
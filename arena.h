@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stddef.h>
+
+typedef struct Arena Arena;
+
+Arena *arena_create(void);
+
+void arena_delete(Arena **a);
+
+void *arena_alloc(Arena *a, size_t size);
+
+size_t arena_used(Arena *a);
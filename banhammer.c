@@ -1,15 +1,27 @@
+#include "ac.h"
 #include "bf.h"
 #include "bst.h"
 #include "bv.h"
+#include "dict.h"
+#include "epoch.h"
+#include "frame.h"
+#include "fuse.h"
+#include "hc.h"
+#include "hs.h"
 #include "ht.h"
+#include "json.h"
 #include "node.h"
 #include "parser.h"
+#include "queue.h"
+#include "rewrite.h"
 #include "speck.h"
+#include "stats.h"
+#include "utf8.h"
 #include "salts.h"
 #include "messages.h"
 
-#include <regex.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -17,149 +29,1449 @@
 #include <inttypes.h>
 #include <ctype.h>
 #include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
 
-#define WORD "[A-Za-z0-9_]+(('|-)[A-Za-z0-9_]+)*"
+#define OPTIONS "ht:T:f:se:k:bi:j:m:a"
 
-#define OPTIONS "ht:f:s"
+#define OPT_COMPILE_DICT 256
+#define OPT_DICT         257
+#define OPT_RELOAD       258
+#define OPT_SERVE        259
+#define OPT_STATS_JSON   260
+#define OPT_FPR          261
+#define OPT_PREFILTER    262
+#define OPT_REWRITE      263
+#define OPT_MASK         264
+#define OPT_HITS         265
+
+static const struct option long_options[] = {
+    { "compile-dict", required_argument, NULL, OPT_COMPILE_DICT },
+    { "dict", required_argument, NULL, OPT_DICT },
+    { "reload", no_argument, NULL, OPT_RELOAD },
+    { "serve", required_argument, NULL, OPT_SERVE },
+    { "stats-json", required_argument, NULL, OPT_STATS_JSON },
+    { "fpr", required_argument, NULL, OPT_FPR },
+    { "prefilter", required_argument, NULL, OPT_PREFILTER },
+    { "rewrite", no_argument, NULL, OPT_REWRITE },
+    { "mask", required_argument, NULL, OPT_MASK },
+    { "hits", no_argument, NULL, OPT_HITS },
+    { NULL, 0, NULL, 0 },
+};
+
+#define CHUNK_SIZE  (1 << 20) // Bytes of input handed to a worker thread at a time.
+#define MAX_THREADS 1024
+
+#define BADSPEAK_PATH "badspeak.txt"
+#define NEWSPEAK_PATH "newspeak.txt"
 
 void help_message(void) {
     fprintf(stderr, "SYNOPSIS\n"
                     "  A word filtering program for the GPRSC.\n"
-                    "  Filters out and reports bad words parsed from stdin.\n"
+                    "  Filters out and reports bad words parsed from stdin or a file.\n"
                     "\n"
                     "USAGE\n"
-                    "  ./banhammer [-hs] [-t size] [-f size]\n"
+                    "  ./banhammer [-hsba] [-t size] [-T table] [-f size] [-k hashes] [-e engine] [-i input]\n"
+                    "              [-j threads] [-m format] [--compile-dict snapshot] [--dict snapshot]\n"
+                    "              [--reload] [--serve socket] [--stats-json file] [--fpr rate]\n"
+                    "              [--prefilter filter] [--rewrite] [--mask policy] [--hits]\n"
                     "\n"
                     "OPTIONS\n"
                     "  -h           Program usage and help.\n"
                     "  -s           Print program statistics.\n"
-                    "  -t size      Specify hash table size (default: 2^16).\n"
-                    "  -f size      Specify Bloom filter size (default: 2^20).\n");
+                    "  -t size      Specify the initial hash table size, which doubles as the\n"
+                    "               dictionary outgrows it (default: 2^16).\n"
+                    "  -T table     Hash table engine, bst, open or perfect (default: bst).\n"
+                    "  -f size      Specify Bloom filter size (default: 2^20).\n"
+                    "  -k hashes    Specify Bloom filter bits set per word (default: 3).\n"
+                    "  -b           Use a cache-line blocked Bloom filter.\n"
+                    "  -e engine    Hash engine, speck or fast (default: speck).\n"
+                    "  -i input     Read words from input instead of stdin.\n"
+                    "  -j threads   Filter the input on threads threads (default: 1).\n"
+                    "  -m format    Filter each record of the input separately and print one\n"
+                    "               JSON verdict per record. Records are lines, nul-separated,\n"
+                    "               or jsonl objects whose text member is filtered.\n"
+                    "  -a           Also match phrases and words hidden inside other words,\n"
+                    "               with an Aho-Corasick automaton.\n"
+                    "  --compile-dict snapshot\n"
+                    "               Write the dictionary to snapshot and exit.\n"
+                    "  --dict snapshot\n"
+                    "               Map the dictionary from snapshot instead of building it.\n"
+                    "               The table and filter options it was compiled with are used.\n"
+                    "  --reload     With -m or --serve, rebuild the dictionary in the background\n"
+                    "               when it changes on disk or on SIGHUP, and filter the records\n"
+                    "               or requests that follow with the new one.\n"
+                    "  --serve socket\n"
+                    "               Load the dictionary once and filter requests from clients\n"
+                    "               of the Unix socket on threads threads until SIGINT or SIGTERM.\n"
+                    "  --stats-json file\n"
+                    "               Write the runtime statistics and latency histograms to file\n"
+                    "               as JSON at exit, or to stdout if file is -.\n"
+                    "  --fpr rate   Count the dictionary first and size the Bloom filter, and\n"
+                    "               the hash table unless -t is given, for a false positive\n"
+                    "               rate of rate, such as 0.001, instead of using -f and -k.\n"
+                    "  --prefilter filter\n"
+                    "               Filter words are ruled out with before the hash table is\n"
+                    "               searched, bloom, fuse8 or fuse16 (default: bloom). The\n"
+                    "               binary fuse filters are built once the dictionary is loaded.\n"
+                    "  --rewrite    Write the input to stdout with oldspeak replaced by its\n"
+                    "               newspeak and badspeak masked, instead of printing a message.\n"
+                    "               Statistics are printed to stderr.\n"
+                    "  --mask policy\n"
+                    "               How --rewrite masks badspeak: stars, first to keep the first\n"
+                    "               character, drop or keep (default: stars).\n"
+                    "  --hits       Print a line of JSON for every word found as soon as it is\n"
+                    "               found, with its offset, length, id and kind, and then how\n"
+                    "               often each word occurred, instead of printing a message.\n"
+                    "               Statistics are printed to stderr.\n");
+}
+
+// How the input is split into separately filtered records.
+typedef enum { RECORDS_NONE, RECORDS_LINES, RECORDS_NUL, RECORDS_JSONL } RecordFormat;
+
+// Where the dictionary comes from and how it is built, so that it can be built again when it changes.
+typedef struct {
+    const char *snapshot; // Snapshot to map, or NULL to build the dictionary from the word lists.
+    uint32_t size_ht; // Initial hash table size, or 0 to size it for the entries.
+    TableEngine table;
+    uint32_t size_bf;
+    uint32_t hashes;
+    bool blocked;
+    HashEngine engine;
+    Prefilter prefilter;
+    bool substrings; // Whether to build an automaton over the dictionary.
+    uint32_t loaders; // Threads the word lists are read on.
+    double fpr; // Target false positive rate to size the Bloom filter for, or 0 to use size_bf and hashes.
+} Source;
+
+// A version of the dictionary together with the automaton built over it, if any. Record mode reads the current
+// version through an Epoch, so that a reload can publish a new one between records.
+typedef struct {
+    Dictionary *dict;
+    Automaton *ac;
+} Version;
+
+// The thread that rebuilds the dictionary on SIGHUP or when its files change, and publishes the new version.
+typedef struct {
+    pthread_t thread;
+    const Source *source;
+    Epoch *versions;
+    struct stat seen[2]; // The files of the source as they were when the current version was loaded.
+    sigset_t signals; // SIGHUP, which is blocked in every thread and taken by sigtimedwait().
+    atomic_bool stop;
+} Reloader;
+
+// A chunk of input waiting to be filtered by a worker thread.
+typedef struct {
+    const char *data;
+    size_t length;
+    char *owned; // Buffer to free once the chunk is filtered, if any.
+} Chunk;
+
+// The state of one worker thread. The dictionary is shared and only read, while the words found belong to the
+// worker.
+typedef struct {
+    pthread_t thread;
+    Queue *chunks;
+    Dictionary *dict;
+    HitSet *bad_message;
+    HitSet *mix_message;
+} Worker;
+
+// This function builds a version of the dictionary from source, mapping its snapshot or loading its word lists,
+// and the automaton over it if source asks for one.
+// This function takes in as a parameter the Source source.
+// This function returns the created Version, or NULL if the dictionary or automaton could not be built.
+static Version *version_load(const Source *source) {
+    Version *v = (Version *) calloc(1, sizeof(Version));
+    if (v == NULL) {
+        fprintf(stderr, "Failed to create dictionary.\n");
+        return NULL;
+    }
+    if (source->snapshot != NULL) {
+        v->dict = dict_open(source->snapshot);
+    } else {
+        // Counting the entries first to size the Bloom filter for the target false positive rate, and the hash
+        // table for the entries unless its size was given
+        uint32_t size_ht = source->size_ht;
+        uint32_t size_bf = source->size_bf;
+        uint32_t hashes = source->hashes;
+        if (source->fpr > 0) {
+            uint64_t entries = 0;
+            if (!dict_count(BADSPEAK_PATH, NEWSPEAK_PATH, source->loaders, &entries)) {
+                free(v);
+                return NULL;
+            }
+            if ((size_bf = bf_size_for(entries, source->fpr, source->blocked, &hashes)) == 0) {
+                fprintf(stderr, "The Bloom filter would be too large for the false positive rate.\n");
+                free(v);
+                return NULL;
+            }
+            if (size_ht == 0) {
+                size_ht = (uint32_t) (entries < 1 ? 1 : entries < (UINT32_C(1) << 31) ? entries : UINT32_C(1) << 31);
+            }
+        }
+        v->dict = dict_create(
+            size_ht, source->table, size_bf, hashes, source->blocked, source->engine, source->prefilter);
+        if (v->dict == NULL) {
+            fprintf(stderr, "Failed to create dictionary.\n");
+        } else if (!dict_load(v->dict, BADSPEAK_PATH, NEWSPEAK_PATH, source->loaders)) {
+            dict_delete(&v->dict);
+        }
+    }
+    if (v->dict == NULL) {
+        free(v);
+        return NULL;
+    }
+    if (source->substrings && (v->ac = ac_create(v->dict)) == NULL) {
+        fprintf(stderr, "Failed to create automaton.\n");
+        dict_delete(&v->dict);
+        free(v);
+        return NULL;
+    }
+    return v;
+}
+
+// This function is the destructor for a version of the dictionary.
+// This function takes in as a parameter a double pointer to the Version v.
+static void version_delete(Version **v) {
+    if ((*v)->ac != NULL) {
+        ac_delete(&(*v)->ac);
+    }
+    dict_delete(&(*v)->dict);
+    free(*v);
+    *v = NULL;
+}
+
+// This function is a helper function that checks whether the files of source changed since they were last seen,
+// by their modification time, size and inode, and records them as seen. A file that is missing is seen as empty.
+// This function takes in as parameters the Source source and the two struct stats the files were last seen with.
+static bool files_changed(const Source *source, struct stat seen[2]) {
+    const char *paths[2] = { source->snapshot != NULL ? source->snapshot : BADSPEAK_PATH,
+        source->snapshot != NULL ? NULL : NEWSPEAK_PATH };
+    bool changed = false;
+    for (int i = 0; i < 2; i++) {
+        struct stat now;
+        memset(&now, 0, sizeof(now));
+        if (paths[i] != NULL) {
+            stat(paths[i], &now);
+        }
+        if (now.st_mtim.tv_sec != seen[i].st_mtim.tv_sec || now.st_mtim.tv_nsec != seen[i].st_mtim.tv_nsec
+            || now.st_size != seen[i].st_size || now.st_ino != seen[i].st_ino) {
+            changed = true;
+        }
+        seen[i] = now;
+    }
+    return changed;
+}
+
+// This function is the body of the reloader thread. Once a second, or as soon as SIGHUP arrives, it checks whether
+// to reload. A new version is built while the old one keeps filtering, then published, and the old one is deleted
+// once the record being filtered with it is done. If the new version cannot be built the old one is kept.
+// This function takes in as a parameter a void arg which is the Reloader.
+static void *reloader_main(void *arg) {
+    Reloader *r = (Reloader *) arg;
+    struct timespec poll = { 1, 0 };
+    while (!atomic_load(&r->stop)) {
+        int sig = sigtimedwait(&r->signals, NULL, &poll);
+        if (atomic_load(&r->stop)) {
+            break;
+        }
+        if (!files_changed(r->source, r->seen) && sig != SIGHUP) {
+            continue;
+        }
+        Version *next = version_load(r->source);
+        if (next == NULL) {
+            fprintf(stderr, "Failed to reload dictionary, keeping the current one.\n");
+            continue;
+        }
+        Version *old = (Version *) epoch_publish(r->versions, next);
+        version_delete(&old);
+    }
+    return NULL;
+}
+
+// This function starts the reloader thread for the versions published by versions. SIGHUP is blocked in every
+// thread from here on so that only the reloader takes it, and the reloader is started with every signal blocked
+// so that signals meant for the other threads are not delivered to it.
+// This function takes in as parameters the Reloader r to start, the Source source, the Epoch versions, and the two
+// struct stats the files of source were seen with just before the current version was loaded, so that a change made
+// while it was loading is not missed.
+// This function returns false if the thread could not be created. Otherwise, returns true.
+static bool reloader_start(Reloader *r, const Source *source, Epoch *versions, const struct stat seen[2]) {
+    sigset_t all;
+    sigset_t previous;
+    r->source = source;
+    r->versions = versions;
+    r->seen[0] = seen[0];
+    r->seen[1] = seen[1];
+    atomic_init(&r->stop, false);
+    sigemptyset(&r->signals);
+    sigaddset(&r->signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &r->signals, NULL);
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    bool started = pthread_create(&r->thread, NULL, reloader_main, r) == 0;
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    return started;
+}
+
+// This function stops the reloader thread and waits for it to exit.
+// This function takes in as a parameter the Reloader r.
+static void reloader_stop(Reloader *r) {
+    atomic_store(&r->stop, true);
+    pthread_kill(r->thread, SIGHUP);
+    pthread_join(r->thread, NULL);
+}
+
+// This function filters every word scanned by parser. The ids of words found in the dictionary without a newspeak
+// translation are inserted into bad_message, and the ids of words found with a translation into mix_message. Words
+// are scanned and looked up DICT_BATCH at a time, so the lookups can overlap their cache misses. With statistics
+// on, the time spent scanning and looking up is measured once per batch.
+// This function takes in as parameters a Parser parser, the Dictionary dict, and the HitSets bad_message and
+// mix_message.
+static void filter_words(Parser *parser, Dictionary *dict, HitSet *bad_message, HitSet *mix_message) {
+    const char *words[DICT_BATCH];
+    uint32_t lengths[DICT_BATCH];
+    Entry e[DICT_BATCH];
+    bool found[DICT_BATCH];
+    uint32_t count = DICT_BATCH;
+    bool timed = stats_enabled();
+    uint64_t start = timed ? stats_now() : 0;
+    while (count == DICT_BATCH && (count = next_words_lower(parser, DICT_BATCH, words, lengths)) > 0) {
+        uint64_t scanned = timed ? stats_now() : 0;
+        stats_add(STAT_TOKENS, count);
+
+        // Looking the words, which the parser has already folded to lowercase, up in the dictionary
+        // If the dictionary contains a word and the word does not have a newspeak translation,
+        // insert badspeak word into a set of badspeak words that the citizen used.
+        // If the dictionary contains a word and the word does have a newspeak translation,
+        // insert oldspeak word into a set of oldspeak words with newspeak translations.
+        if (dict_lookup_many(dict, (char **) words, lengths, count, e, found) > 0) {
+            for (uint32_t i = 0; i < count; i++) {
+                if (found[i]) {
+                    hs_insert(e[i].newspeak == NULL ? bad_message : mix_message, e[i].id);
+                }
+            }
+        }
+        if (timed) {
+            uint64_t looked_up = stats_now();
+            stats_add(STAT_SCAN_NS, scanned - start);
+            stats_add(STAT_LOOKUP_NS, looked_up - scanned);
+            stats_record(STAT_BATCH_NS, looked_up - scanned);
+            start = looked_up;
+        }
+    }
+}
+
+// The sets that the hits of the automaton are inserted into.
+typedef struct {
+    HitSet *bad_message;
+    HitSet *mix_message;
+} Hits;
+
+// This function is a helper function that inserts an entry found by the automaton into the matching set, the same
+// way filter_words() does.
+static void insert_hit(const Entry *e, void *arg) {
+    Hits *hits = (Hits *) arg;
+    stats_add(STAT_LOOKUPS, 1);
+    hs_insert(e->newspeak == NULL ? hits->bad_message : hits->mix_message, e->id);
+}
+
+// This function filters the input of parser with the Aho-Corasick automaton ac, if there is one, or else word by
+// word. The automaton reads the input a chunk at a time in a single pass, carrying its state across chunks so a
+// phrase can span them. The automaton only folds ASCII itself, so a chunk with multibyte characters is case folded
+// first, which chunks ending on ASCII bytes that cannot be part of a word makes safe.
+// This function takes in as parameters a Parser parser, the Dictionary dict, the Automaton ac or NULL, and the
+// HitSets bad_message and mix_message.
+static void filter_text(Parser *parser, Dictionary *dict, Automaton *ac, HitSet *bad_message, HitSet *mix_message) {
+    if (ac == NULL) {
+        filter_words(parser, dict, bad_message, mix_message);
+        return;
+    }
+    Hits hits = { bad_message, mix_message };
+    uint32_t state = AC_START;
+    const char *data = NULL;
+    size_t length = 0;
+    char *owned = NULL;
+    char *folded = NULL;
+    size_t capacity = 0;
+    bool timed = stats_enabled();
+    while ((data = next_chunk(parser, CHUNK_SIZE, &length, &owned)) != NULL) {
+        uint64_t start = timed ? stats_now() : 0;
+        if (!utf8_is_ascii(data, length)) {
+            if (2 * length > capacity) {
+                capacity = 2 * length;
+                free(folded);
+                folded = (char *) malloc(capacity);
+                if (folded == NULL) {
+                    perror("malloc");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            length = utf8_fold_text(data, length, folded);
+            data = folded;
+        }
+        state = ac_scan(ac, state, data, length, insert_hit, &hits);
+        if (timed) {
+            stats_add(STAT_AUTOMATON_NS, stats_now() - start);
+        }
+        free(owned);
+    }
+    free(folded);
+}
+
+// The words of the input that stream_hits() has scanned but not yet looked up, together with where they are.
+typedef struct {
+    Dictionary *dict;
+    uint64_t *counts; // Occurrences of each entry of the dictionary found so far, indexed by id.
+    uint32_t count;
+    const char *words[DICT_BATCH];
+    uint32_t lengths[DICT_BATCH];
+    uint64_t offsets[DICT_BATCH];
+    char *folded; // The words folded to lowercase.
+    size_t capacity;
+} HitStream;
+
+// This function is a helper function that looks up the words a HitStream holds and prints a line of JSON for each
+// one found.
+static void look_up_hits(HitStream *h) {
+    if (h->count == 0) {
+        return;
+    }
+    Entry e[DICT_BATCH];
+    bool found[DICT_BATCH];
+    stats_add(STAT_TOKENS, h->count);
+
+    bool timed = stats_enabled();
+    uint64_t start = timed ? stats_now() : 0;
+    if (!dict_lookup_views(h->dict, h->words, h->lengths, h->count, &h->folded, &h->capacity, e, found)) {
+        perror("realloc");
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; i < h->count; i++) {
+        if (found[i]) {
+            h->counts[e[i].id] += 1;
+            printf("{\"offset\":%" PRIu64 ",\"length\":%" PRIu32 ",\"id\":%" PRIu32 ",\"type\":\"%s\"}\n",
+                h->offsets[i], h->lengths[i], e[i].id, e[i].newspeak == NULL ? "badspeak" : "oldspeak");
+        }
+    }
+    if (timed) {
+        uint64_t looked_up = stats_now();
+        stats_add(STAT_LOOKUP_NS, looked_up - start);
+        stats_record(STAT_BATCH_NS, looked_up - start);
+    }
+    h->count = 0;
+}
+
+// This function is a helper function the parser calls before it waits for more input. It looks up the words a
+// HitStream holds while they are still valid and flushes stdout, so that every hit is seen before the wait.
+static void drain_hits(void *arg) {
+    look_up_hits((HitStream *) arg);
+    fflush(stdout);
+}
+
+// This function prints a line of JSON for every occurrence of a word of the dictionary in the input of parser as
+// soon as it is found, with the offset and length of the word in the input, the id of its entry, and whether it is
+// badspeak or oldspeak, and then a line for every entry found with the number of times it occurred, in order of
+// id. Words are looked up DICT_BATCH at a time like filter_words(), but a batch is also looked up and the hits
+// flushed before the parser waits for more input, so the hits of a stream are seen as soon as its input arrives.
+// This function takes in as parameters a Parser parser and the Dictionary dict.
+// This function returns false if memory could not be allocated. Otherwise, returns true.
+static bool stream_hits(Parser *parser, Dictionary *dict) {
+    HitStream h;
+    memset(&h, 0, sizeof(h));
+    h.dict = dict;
+    h.counts = (uint64_t *) calloc(dict_entries(dict) + 1, sizeof(uint64_t));
+    if (h.counts == NULL) {
+        fprintf(stderr, "Failed to allocate memory.\n");
+        return false;
+    }
+    parser_set_drain(parser, drain_hits, &h);
+    const char *word = NULL;
+    uint32_t length = 0;
+    while ((word = next_word(parser, &length)) != NULL) {
+        h.words[h.count] = word;
+        h.lengths[h.count] = length;
+        h.offsets[h.count] = parser_offset(parser, word);
+        h.count = h.count + 1;
+        if (h.count == DICT_BATCH) {
+            look_up_hits(&h);
+        }
+    }
+    look_up_hits(&h);
+    parser_set_drain(parser, NULL, NULL);
+
+    // Printing how often each entry found occurred
+    for (uint32_t id = 0; id < dict_entries(dict); id++) {
+        if (h.counts[id] > 0) {
+            Entry e;
+            dict_entry(dict, id, &e);
+            printf("{\"id\":%" PRIu32 ",\"word\":", id);
+            json_print_string(stdout, e.oldspeak, strlen(e.oldspeak));
+            printf(",\"type\":\"%s\",\"count\":%" PRIu64 "}\n", e.newspeak == NULL ? "badspeak" : "oldspeak",
+                h.counts[id]);
+        }
+    }
+    fflush(stdout);
+    free(h.counts);
+    free(h.folded);
+    return true;
+}
+
+// This function is a helper function that orders entries by oldspeak.
+static int compare_oldspeak(const void *a, const void *b) {
+    return strcmp(((const Entry *) a)->oldspeak, ((const Entry *) b)->oldspeak);
+}
+
+// This function looks up the entries of the ids in hits and sorts them by oldspeak, the order the words are
+// reported in.
+// This function takes in as parameters the Dictionary dict and a HitSet hits.
+// This function returns an array of hs_size(hits) entries that must be freed, or NULL if hits is empty.
+static Entry *sort_hits(Dictionary *dict, HitSet *hits) {
+    uint32_t size = hs_size(hits);
+    if (size == 0) {
+        return NULL;
+    }
+    Entry *entries = (Entry *) malloc((size_t) size * sizeof(Entry));
+    if (entries == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    const uint32_t *ids = hs_ids(hits);
+    for (uint32_t i = 0; i < size; i++) {
+        dict_entry(dict, ids[i], &entries[i]);
+    }
+    qsort(entries, size, sizeof(Entry), compare_oldspeak);
+    return entries;
+}
+
+// This function prints the words found in the dictionary, one per line, with their newspeak translation if there
+// is one.
+// This function takes in as parameters the FILE out to print to, the Dictionary dict and a HitSet hits.
+static void print_hits(FILE *out, Dictionary *dict, HitSet *hits) {
+    Entry *entries = sort_hits(dict, hits);
+    for (uint32_t i = 0; i < hs_size(hits); i++) {
+        if (entries[i].newspeak != NULL) {
+            fprintf(out, "%s -> %s\n", entries[i].oldspeak, entries[i].newspeak);
+        } else {
+            fprintf(out, "%s\n", entries[i].oldspeak);
+        }
+    }
+    free(entries);
+}
+
+// This function prints the message the citizen receives for the words found, followed by the words, or nothing if
+// no words were found.
+// This function takes in as parameters the FILE out to print to, the Dictionary dict, and the HitSets bad_message
+// and mix_message.
+static void print_message(FILE *out, Dictionary *dict, HitSet *bad_message, HitSet *mix_message) {
+    if (hs_size(mix_message) > 0 && hs_size(bad_message) > 0) {
+        fprintf(out, "%s", mixspeak_message);
+        print_hits(out, dict, bad_message);
+        print_hits(out, dict, mix_message);
+    } else if (hs_size(mix_message) == 0 && hs_size(bad_message) > 0) {
+        fprintf(out, "%s", badspeak_message);
+        print_hits(out, dict, bad_message);
+    } else if (hs_size(mix_message) > 0 && hs_size(bad_message) == 0) {
+        fprintf(out, "%s", goodspeak_message);
+        print_hits(out, dict, mix_message);
+    }
+}
+
+// This function prints the verdict for one record as a line of JSON. The verdict names the message the citizen
+// would have received, or is clean if no words were found.
+// This function takes in as parameters the uint64_t number of the record, a bool valid which is false if the record
+// could not be read, the Dictionary dict, and the HitSets bad_message and mix_message.
+static void print_verdict(uint64_t record, bool valid, Dictionary *dict, HitSet *bad_message, HitSet *mix_message) {
+    printf("{\"record\":%" PRIu64 ",", record);
+    if (!valid) {
+        printf("\"error\":\"record has no text member\"}\n");
+        return;
+    }
+    uint32_t bad = hs_size(bad_message);
+    uint32_t mix = hs_size(mix_message);
+    if (mix > 0 && bad > 0) {
+        printf("\"verdict\":\"mixspeak\",");
+    } else if (bad > 0) {
+        printf("\"verdict\":\"badspeak\",");
+    } else if (mix > 0) {
+        printf("\"verdict\":\"goodspeak\",");
+    } else {
+        printf("\"verdict\":\"clean\",");
+    }
+    Entry *entries = sort_hits(dict, bad_message);
+    printf("\"badspeak\":[");
+    for (uint32_t i = 0; i < bad; i++) {
+        printf(i == 0 ? "" : ",");
+        json_print_string(stdout, entries[i].oldspeak, strlen(entries[i].oldspeak));
+    }
+    free(entries);
+    entries = sort_hits(dict, mix_message);
+    printf("],\"oldspeak\":{");
+    for (uint32_t i = 0; i < mix; i++) {
+        printf(i == 0 ? "" : ",");
+        json_print_string(stdout, entries[i].oldspeak, strlen(entries[i].oldspeak));
+        printf(":");
+        json_print_string(stdout, entries[i].newspeak, strlen(entries[i].newspeak));
+    }
+    free(entries);
+    printf("}}\n");
+}
+
+// This function prints the statistics of -s: the shape of the table and filters of the dictionary of version,
+// and the averages and counts of the lookups made by every thread.
+// This function takes in as parameters the FILE out to print to, the Version version, and the Stats totals.
+static void print_stats(FILE *out, Version *version, Stats *totals) {
+    Dictionary *dict = version->dict;
+    BloomFilter *bf = dict_bf(dict);
+    FuseFilter *fuse = dict_fuse(dict);
+    uint64_t branches = stats_get(totals, STAT_BRANCHES);
+    uint64_t lookups = stats_get(totals, STAT_LOOKUPS);
+    fprintf(out, "Average BST size: %f\n", dict_avg_bst_size(dict));
+    fprintf(out, "Average BST height: %f\n", dict_avg_bst_height(dict));
+    fprintf(out, "Average branches traversed: %f\n", ((float) branches / lookups));
+    fprintf(out, "Hash table load: %0.6f%%\n", (100 * ((float) dict_ht_count(dict) / dict_ht_size(dict))));
+    fprintf(out, "Bloom filter load: %0.6f%%\n", (100 * ((float) bf_count(bf) / bf_size(bf))));
+    fprintf(out, "Bloom filter false positive rate: %0.6g%%\n", 100 * bf_fpr(bf));
+    if (version->ac != NULL) {
+        fprintf(out, "Automaton states: %" PRIu32 " (%" PRIu32 " byte classes)\n", ac_states(version->ac),
+            ac_classes(version->ac));
+    }
+    fprintf(out, "Words scanned: %" PRIu64 "\n", stats_get(totals, STAT_TOKENS));
+    const char *name = "Bloom filter";
+    if (fuse != NULL) {
+        name = "Binary fuse filter";
+        fprintf(out, "%s bits per key: %f\n", name, fuse_bits_per_key(fuse));
+        fprintf(out, "%s false positive rate: %0.6g%%\n", name, 100 * fuse_fpr(fuse));
+    } else {
+        fprintf(out, "%s bits per key: %f\n", name, bf_bits_per_key(bf));
+    }
+    fprintf(out, "%s negatives: %" PRIu64 "\n", name, stats_get(totals, STAT_BF_NEGATIVES));
+    fprintf(out, "%s positives: %" PRIu64 "\n", name, stats_get(totals, STAT_BF_POSITIVES));
+    fprintf(out, "%s measured false positive rate: %0.6g%%\n", name, 100 * stats_bf_fpr(totals));
+}
+
+// This function writes the statistics as one line of JSON: the configuration of the dictionary of version, with
+// the bits per key and false positive rate its filters are expected to have, and the runtime statistics of every
+// thread.
+// This function takes in as parameters the char path of the file to write, or - for stdout, the Version version,
+// and the Stats totals.
+// This function returns true if the file was written.
+static bool write_stats_json(const char *path, Version *version, Stats *totals) {
+    FILE *out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        return false;
+    }
+    Dictionary *dict = version->dict;
+    BloomFilter *bf = dict_bf(dict);
+    FuseFilter *fuse = dict_fuse(dict);
+    fprintf(out, "{\"dictionary\":{\"entries\":%" PRIu32 ",\"ht_size\":%" PRIu32 ",\"ht_count\":%" PRIu32,
+        dict_entries(dict), dict_ht_size(dict), dict_ht_count(dict));
+    fprintf(out, ",\"bf_size\":%" PRIu32 ",\"bf_hashes\":%" PRIu32 ",\"bf_blocked\":%s,\"bf_count\":%" PRIu32,
+        bf_size(bf), bf_hashes(bf), bf_blocked(bf) ? "true" : "false", bf_count(bf));
+    fprintf(out, ",\"bf_expected_fpr\":%.6g,\"prefilter\":\"%s\"", bf_fpr(bf),
+        fuse == NULL ? "bloom" : fuse_bits(fuse) == 8 ? "fuse8" : "fuse16");
+    fprintf(out, ",\"prefilter_bits_per_key\":%.6g,\"prefilter_expected_fpr\":%.6g},\"runtime\":",
+        fuse != NULL ? fuse_bits_per_key(fuse) : bf_bits_per_key(bf), fuse != NULL ? fuse_fpr(fuse) : bf_fpr(bf));
+    stats_print_json(out, totals);
+    fprintf(out, "}\n");
+    bool written = !ferror(out);
+    if (out == stdout) {
+        fflush(out);
+    } else {
+        written = fclose(out) == 0 && written;
+    }
+    if (!written) {
+        perror(path);
+    }
+    return written;
+}
+
+// This function reports the statistics every thread has gathered so far. It can be called while the threads are
+// still counting.
+// This function takes in as parameters the FILE out to print the statistics to or NULL, the char path to write them
+// to as JSON or NULL, and the Version version whose dictionary is reported.
+// This function returns true if the statistics were reported.
+static bool report_stats(FILE *out, const char *path, Version *version) {
+    Stats *totals = stats_total();
+    if (totals == NULL) {
+        fprintf(stderr, "Failed to gather statistics.\n");
+        return false;
+    }
+    if (out != NULL) {
+        print_stats(out, version, totals);
+        fflush(out);
+    }
+    bool reported = path == NULL || write_stats_json(path, version, totals);
+    stats_delete(&totals);
+    return reported;
+}
+
+// This function makes sure the sets of words found can hold every id of dict, creating them if they do not exist
+// yet and recreating them if a reload has grown the dictionary past their universe. The sets must be empty.
+// This function takes in as parameters the Dictionary dict, the uint32_t universe of the sets, and the HitSets
+// bad_message and mix_message, which may start out NULL.
+static void fit_hits(Dictionary *dict, uint32_t *universe, HitSet **bad_message, HitSet **mix_message) {
+    if (*mix_message != NULL && dict_entries(dict) <= *universe) {
+        return;
+    }
+    *universe = dict_entries(dict);
+    if (*mix_message != NULL) {
+        hs_delete(mix_message);
+        hs_delete(bad_message);
+    }
+    *mix_message = hs_create(*universe);
+    *bad_message = hs_create(*universe);
+    if (*mix_message == NULL || *bad_message == NULL) {
+        fprintf(stderr, "Failed to create hit sets.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// This function filters each record of the input separately. Only the words found in a record are reset between
+// records, which costs time in the number of words found; the dictionary is loaded once for all of them.
+// Each record is filtered with the version of the dictionary current when it starts, which it holds until its
+// verdict is printed, so a reload takes effect from the next record on.
+// This function takes in as parameters a Parser parser, the RecordFormat format of the input, a bool print which
+// is false if verdicts should not be printed, and the Epoch versions that publishes the Version to use.
+static void filter_records(Parser *parser, RecordFormat format, bool print, Epoch *versions) {
+    const char *record = NULL;
+    size_t length = 0;
+    uint64_t records = 0;
+    char *text = NULL;
+    size_t text_length = 0;
+    size_t capacity = 0;
+    uint32_t universe = 0;
+    HitSet *mix_message = NULL;
+    HitSet *bad_message = NULL;
+    bool timed = stats_enabled();
+    while ((record = next_record(parser, format == RECORDS_NUL ? '\0' : '\n', &length)) != NULL) {
+        uint64_t start = timed ? stats_now() : 0;
+        bool valid = true;
+        records = records + 1;
+        Version *version = (Version *) epoch_enter(versions, 0);
+        Dictionary *dict = version->dict;
+        fit_hits(dict, &universe, &bad_message, &mix_message);
+
+        // Decoding the text member of a JSON record
+        if (format == RECORDS_JSONL) {
+            valid = json_string_field(record, length, "text", &text, &text_length, &capacity);
+            record = text;
+            length = text_length;
+        }
+
+        if (valid) {
+            Parser *words = parser_create_buffer(record, length);
+            if (words == NULL) {
+                fprintf(stderr, "Failed to create parser.\n");
+                exit(EXIT_FAILURE);
+            }
+            filter_text(words, dict, version->ac, bad_message, mix_message);
+            parser_delete(&words);
+        }
+        if (print) {
+            print_verdict(records, valid, dict, bad_message, mix_message);
+        }
+
+        hs_clear(mix_message);
+        hs_clear(bad_message);
+        epoch_exit(versions, 0);
+        if (timed) {
+            stats_record(STAT_RECORD_NS, stats_now() - start);
+        }
+    }
+    if (mix_message != NULL) {
+        hs_delete(&mix_message);
+        hs_delete(&bad_message);
+    }
+    free(text);
+}
+
+// This function is the body of a worker thread. It filters chunks from the queue until the queue is closed.
+// This function takes in as a parameter a void arg which is the Worker of the thread.
+static void *worker_main(void *arg) {
+    Worker *w = (Worker *) arg;
+    void *item = NULL;
+    stats_attach();
+    while (queue_pop(w->chunks, &item)) {
+        Chunk *chunk = (Chunk *) item;
+        Parser *parser = parser_create_buffer(chunk->data, chunk->length);
+        if (parser == NULL) {
+            fprintf(stderr, "Failed to create parser.\n");
+            exit(EXIT_FAILURE);
+        }
+        filter_words(parser, w->dict, w->bad_message, w->mix_message);
+        parser_delete(&parser);
+        free(chunk->owned);
+        free(chunk);
+    }
+    return NULL;
+}
+
+// A client connection of the server. The event loop owns a connection while it reads a request from it, and a
+// responder owns it from when the request has been read until the response has been sent.
+typedef struct Connection Connection;
+struct Connection {
+    int fd;
+    unsigned char header[FRAME_HEADER];
+    uint32_t length; // Length of the request, once its header has been read.
+    size_t received; // Bytes of the frame received so far, header included.
+    char *request;
+    size_t capacity;
+    atomic_bool busy; // Whether a responder owns the connection, cleared once it has handed it back.
+    Connection *prev; // Links of the list of every open connection, which only the event loop touches.
+    Connection *next;
+};
+
+// The state of one responder thread of the server. The responders take requests that have been read in full off a
+// queue, filter them with the current version of the dictionary, and send back the responses.
+typedef struct {
+    pthread_t thread;
+    uint32_t reader; // Index of the responder as a reader of the versions.
+    Queue *requests;
+    Epoch *versions;
+    int epoll;
+} Responder;
+
+// This function is a helper function that watches the connection c for the next request. The connection is armed
+// for a single event, so that no other thread gets an event for it until it has been handled.
+static void arm(int epoll, Connection *c) {
+    struct epoll_event event = { EPOLLIN | EPOLLONESHOT, { .ptr = c } };
+    epoll_ctl(epoll, EPOLL_CTL_MOD, c->fd, &event);
+}
+
+// This function is a helper function that reads as much of a request as has arrived on the non-blocking connection c,
+// never reading past the end of the request.
+// Returns 1 once the request has been read in full, 0 if more of it is still to arrive, and -1 if the connection
+// was closed, failed, or sent a request larger than FRAME_MAX.
+static int receive(Connection *c) {
+    while (true) {
+        char *into = (char *) c->header + c->received;
+        size_t wanted = FRAME_HEADER - c->received;
+        if (c->received >= FRAME_HEADER) {
+            into = c->request + (c->received - FRAME_HEADER);
+            wanted = c->length - (c->received - FRAME_HEADER);
+        }
+        if (wanted == 0) {
+            return 1;
+        }
+        ssize_t got = recv(c->fd, into, wanted, 0);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        if (got <= 0) {
+            return -1;
+        }
+        c->received += (size_t) got;
+        if (c->received == FRAME_HEADER) {
+            c->length = frame_length(c->header);
+            if (c->length > FRAME_MAX) {
+                return -1;
+            }
+            if (c->length >= c->capacity) {
+                char *grown = (char *) realloc(c->request, (size_t) c->length + 1);
+                if (grown == NULL) {
+                    return -1;
+                }
+                c->request = grown;
+                c->capacity = (size_t) c->length + 1;
+            }
+        }
+    }
+}
+
+// This function is the body of a responder thread. It filters requests from the queue until the queue is closed.
+// The response to a request is what banhammer prints for the same text: the message and the words found, or
+// nothing. A connection whose response cannot be sent is shut down and left for the event loop to close.
+// This function takes in as a parameter a void arg which is the Responder of the thread.
+static void *responder_main(void *arg) {
+    Responder *r = (Responder *) arg;
+    uint32_t universe = 0;
+    HitSet *mix_message = NULL;
+    HitSet *bad_message = NULL;
+    void *item = NULL;
+    stats_attach();
+    bool timed = stats_enabled();
+    while (queue_pop(r->requests, &item)) {
+        Connection *c = (Connection *) item;
+        uint64_t start = timed ? stats_now() : 0;
+        Version *version = (Version *) epoch_enter(r->versions, r->reader);
+        fit_hits(version->dict, &universe, &bad_message, &mix_message);
+        Parser *parser = parser_create_buffer(c->request, c->length);
+        if (parser == NULL) {
+            fprintf(stderr, "Failed to create parser.\n");
+            exit(EXIT_FAILURE);
+        }
+        filter_text(parser, version->dict, version->ac, bad_message, mix_message);
+        parser_delete(&parser);
+
+        char *response = NULL;
+        size_t length = 0;
+        FILE *out = open_memstream(&response, &length);
+        if (out == NULL) {
+            perror("open_memstream");
+            exit(EXIT_FAILURE);
+        }
+        print_message(out, version->dict, bad_message, mix_message);
+        fclose(out);
+        hs_clear(mix_message);
+        hs_clear(bad_message);
+        epoch_exit(r->versions, r->reader);
+
+        c->received = 0;
+        if (!frame_send(c->fd, response, (uint32_t) length)) {
+            shutdown(c->fd, SHUT_RDWR);
+        }
+        free(response);
+        if (timed) {
+            stats_record(STAT_REQUEST_NS, stats_now() - start);
+        }
+        arm(r->epoll, c);
+        atomic_store_explicit(&c->busy, false, memory_order_release);
+    }
+    if (mix_message != NULL) {
+        hs_delete(&mix_message);
+        hs_delete(&bad_message);
+    }
+    return NULL;
+}
+
+// This function is a helper function that closes the connection c and unlinks it from the list of open
+// connections.
+static void disconnect(Connection **open, Connection *c) {
+    if (c->prev != NULL) {
+        c->prev->next = c->next;
+    } else {
+        *open = c->next;
+    }
+    if (c->next != NULL) {
+        c->next->prev = c->prev;
+    }
+    close(c->fd);
+    free(c->request);
+    free(c);
+}
+
+// This function serves requests over the Unix socket at path until SIGINT or SIGTERM. A single event loop accepts
+// clients and reads their requests with epoll, and threads responders filter the requests and send the responses,
+// so the dictionary is built once for every request and a slow client holds up no one else. A client that stops
+// reading its response for FRAME_WAIT milliseconds is dropped rather than left holding a responder. Each request is
+// filtered with the version of the dictionary current when a responder takes it. With statistics on, SIGUSR1
+// reports the statistics gathered so far without stopping the server.
+// This function takes in as parameters the char path of the socket, the uint32_t number of threads, the Epoch
+// versions, which must have threads + 1 readers, the last of which is the event loop, and the bool print and char
+// stats_path to report statistics with.
+// This function returns the exit status of the program.
+static int serve(const char *path, uint32_t threads, Epoch *versions, bool print, const char *stats_path) {
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path is too long.\n");
+        return EXIT_FAILURE;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    // Replacing a socket left behind by an earlier server, but no other kind of file
+    struct stat existing;
+    if (stat(path, &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        unlink(path);
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener < 0 || bind(listener, (struct sockaddr *) &address, sizeof(address)) < 0
+        || listen(listener, SOMAXCONN) < 0) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    // Taking SIGINT, SIGTERM and, with statistics on, SIGUSR1 through the event loop, blocking them before any
+    // responder starts
+    sigset_t taken;
+    sigemptyset(&taken);
+    sigaddset(&taken, SIGINT);
+    sigaddset(&taken, SIGTERM);
+    if (stats_enabled()) {
+        sigaddset(&taken, SIGUSR1);
+    }
+    pthread_sigmask(SIG_BLOCK, &taken, NULL);
+    int signals = signalfd(-1, &taken, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event = { EPOLLIN, { .ptr = &listener } };
+    if (signals < 0 || epoll < 0 || epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event) < 0) {
+        perror("epoll");
+        return EXIT_FAILURE;
+    }
+    event.data.ptr = &signals;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, signals, &event);
+
+    // Starting the responders
+    Queue *requests = queue_create(2 * threads);
+    Responder *responders = (Responder *) calloc(threads, sizeof(Responder));
+    if (requests == NULL || responders == NULL) {
+        fprintf(stderr, "Failed to create responder threads.\n");
+        return EXIT_FAILURE;
+    }
+    for (uint32_t i = 0; i < threads; i++) {
+        responders[i].reader = i;
+        responders[i].requests = requests;
+        responders[i].versions = versions;
+        responders[i].epoll = epoll;
+        if (pthread_create(&responders[i].thread, NULL, responder_main, &responders[i]) != 0) {
+            fprintf(stderr, "Failed to create responder threads.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Accepting clients and reading their requests until asked to stop
+    Connection *open = NULL;
+    struct epoll_event events[64];
+    bool running = true;
+    while (running) {
+        int ready = epoll_wait(epoll, events, 64, -1);
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.ptr == &signals) {
+                struct signalfd_siginfo info;
+                while (read(signals, &info, sizeof(info)) == sizeof(info)) {
+                    if (info.ssi_signo == SIGUSR1) {
+                        Version *version = (Version *) epoch_enter(versions, threads);
+                        report_stats(print ? stdout : NULL, stats_path, version);
+                        epoch_exit(versions, threads);
+                    } else {
+                        running = false;
+                    }
+                }
+            } else if (events[i].data.ptr == &listener) {
+                int fd;
+                while ((fd = accept(listener, NULL, NULL)) >= 0) {
+                    Connection *c = (Connection *) calloc(1, sizeof(Connection));
+                    if (c == NULL) {
+                        close(fd);
+                        continue;
+                    }
+                    fcntl(fd, F_SETFL, O_NONBLOCK);
+                    fcntl(fd, F_SETFD, FD_CLOEXEC);
+                    c->fd = fd;
+                    c->next = open;
+                    if (open != NULL) {
+                        open->prev = c;
+                    }
+                    open = c;
+                    struct epoll_event armed = { EPOLLIN | EPOLLONESHOT, { .ptr = c } };
+                    epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &armed);
+                }
+            } else {
+                // Waiting for a responder that has just armed the connection to let go of it
+                Connection *c = (Connection *) events[i].data.ptr;
+                while (atomic_load_explicit(&c->busy, memory_order_acquire)) {
+                    sched_yield();
+                }
+                int status = receive(c);
+                if (status < 0) {
+                    disconnect(&open, c);
+                } else if (status == 0) {
+                    arm(epoll, c);
+                } else {
+                    atomic_store_explicit(&c->busy, true, memory_order_relaxed);
+                    queue_push(requests, c);
+                }
+            }
+        }
+    }
+
+    // Letting the responders finish the requests already read, then closing every connection
+    queue_close(requests);
+    for (uint32_t i = 0; i < threads; i++) {
+        pthread_join(responders[i].thread, NULL);
+    }
+    while (open != NULL) {
+        disconnect(&open, open);
+    }
+    free(responders);
+    queue_delete(&requests);
+    close(epoll);
+    close(signals);
+    close(listener);
+    unlink(path);
+    return EXIT_SUCCESS;
+}
+
+// This function is a helper function that parses a size or count given as an option argument.
+// Returns false if the argument is not a whole number from 1 to UINT32_MAX. Otherwise, sets value to it.
+static bool parse_size(const char *arg, uint32_t *value) {
+    char *end = NULL;
+    errno = 0;
+    unsigned long long parsed = strtoull(arg, &end, 10);
+    if (!isdigit((unsigned char) arg[0]) || *end != '\0' || errno != 0 || parsed == 0 || parsed > UINT32_MAX) {
+        return false;
+    }
+    *value = (uint32_t) parsed;
+    return true;
 }
 
 int main(int argc, char **argv) {
     int opt = 0;
     uint32_t size_ht = 65536;
+    TableEngine table = TABLE_BST;
     uint32_t size_bf = 1048576;
+    uint32_t hashes = 3;
+    bool blocked = false;
     bool stats = false;
-    BloomFilter *bf;
-    HashTable *ht;
-    char badspeak[1024];
-    char oldspeak[1024];
-    char newspeak[1024];
-
-    // Parsing command-line options using getopt() and handling them accordingly
-    while ((opt = getopt(argc, argv, OPTIONS)) != -1) {
+    HashEngine engine = HASH_SPECK;
+    char *input = NULL;
+    uint32_t threads = 1;
+    RecordFormat format = RECORDS_NONE;
+    char *compile_path = NULL;
+    char *dict_path = NULL;
+    bool substrings = false;
+    bool reload = false;
+    char *serve_path = NULL;
+    char *stats_path = NULL;
+    double fpr = 0;
+    Prefilter prefilter = PREFILTER_BLOOM;
+    bool rewrite = false;
+    RewriteMask mask = MASK_STARS;
+    bool hits = false;
+    bool size_ht_given = false;
+    char *end = NULL;
+    Dictionary *dict;
+    Automaton *ac = NULL;
+
+    // Parsing command-line options using getopt_long() and handling them accordingly
+    while ((opt = getopt_long(argc, argv, OPTIONS, long_options, NULL)) != -1) {
         switch (opt) {
-        case 't': size_ht = atoi(optarg); break;
-        case 'f': size_bf = atoi(optarg); break;
+        case OPT_COMPILE_DICT: compile_path = optarg; break;
+        case OPT_DICT: dict_path = optarg; break;
+        case OPT_RELOAD: reload = true; break;
+        case OPT_SERVE: serve_path = optarg; break;
+        case OPT_STATS_JSON: stats_path = optarg; break;
+        case OPT_FPR:
+            fpr = strtod(optarg, &end);
+            if (end == optarg || *end != '\0' || !(fpr > 0 && fpr < 1)) {
+                fprintf(stderr, "Invalid false positive rate.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case OPT_PREFILTER:
+            if (strcmp(optarg, "bloom") == 0) {
+                prefilter = PREFILTER_BLOOM;
+            } else if (strcmp(optarg, "fuse8") == 0) {
+                prefilter = PREFILTER_FUSE8;
+            } else if (strcmp(optarg, "fuse16") == 0) {
+                prefilter = PREFILTER_FUSE16;
+            } else {
+                fprintf(stderr, "Invalid prefilter.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case OPT_REWRITE: rewrite = true; break;
+        case OPT_HITS: hits = true; break;
+        case OPT_MASK:
+            if (strcmp(optarg, "stars") == 0) {
+                mask = MASK_STARS;
+            } else if (strcmp(optarg, "first") == 0) {
+                mask = MASK_FIRST;
+            } else if (strcmp(optarg, "drop") == 0) {
+                mask = MASK_DROP;
+            } else if (strcmp(optarg, "keep") == 0) {
+                mask = MASK_KEEP;
+            } else {
+                fprintf(stderr, "Invalid mask policy.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 't':
+            if (!parse_size(optarg, &size_ht)) {
+                fprintf(stderr, "Invalid hash table size.\n");
+                return EXIT_FAILURE;
+            }
+            size_ht_given = true;
+            break;
+        case 'T':
+            if (strcmp(optarg, "bst") == 0) {
+                table = TABLE_BST;
+            } else if (strcmp(optarg, "open") == 0) {
+                table = TABLE_OPEN;
+            } else if (strcmp(optarg, "perfect") == 0) {
+                table = TABLE_PERFECT;
+            } else {
+                fprintf(stderr, "Invalid hash table engine.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'f':
+            if (!parse_size(optarg, &size_bf)) {
+                fprintf(stderr, "Invalid Bloom filter size.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'k':
+            if (!parse_size(optarg, &hashes) || hashes > BV_BLOCK_BITS) {
+                fprintf(stderr, "Invalid number of Bloom filter hashes.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'b': blocked = true; break;
+        case 'i': input = optarg; break;
+        case 'j':
+            if (!parse_size(optarg, &threads) || threads > MAX_THREADS) {
+                fprintf(stderr, "Invalid number of threads.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'm':
+            if (strcmp(optarg, "lines") == 0) {
+                format = RECORDS_LINES;
+            } else if (strcmp(optarg, "nul") == 0) {
+                format = RECORDS_NUL;
+            } else if (strcmp(optarg, "jsonl") == 0) {
+                format = RECORDS_JSONL;
+            } else {
+                fprintf(stderr, "Invalid record format.\n");
+                return EXIT_FAILURE;
+            }
+            break;
         case 's': stats = true; break;
+        case 'a': substrings = true; break;
+        case 'e':
+            if (strcmp(optarg, "speck") == 0) {
+                engine = HASH_SPECK;
+            } else if (strcmp(optarg, "fast") == 0) {
+                engine = HASH_FAST;
+            } else {
+                fprintf(stderr, "Invalid hash engine.\n");
+                return EXIT_FAILURE;
+            }
+            break;
         case 'h': help_message(); return EXIT_SUCCESS;
         default: help_message(); return EXIT_FAILURE;
         }
     }
 
-    // Initializing Bloom Filter
-    if (size_bf <= 0) {
-        fprintf(stderr, "Invalid Bloom filter size.\n");
+    if (threads <= 0 || threads > MAX_THREADS) {
+        fprintf(stderr, "Invalid number of threads.\n");
         return EXIT_FAILURE;
-    } else {
-        bf = bf_create(size_bf);
     }
-
-    // Initializing hash table
-    if (size_ht <= 0) {
-        fprintf(stderr, "Invalid hash table size.\n");
+    if (threads > 1 && format != RECORDS_NONE) {
+        fprintf(stderr, "Records are filtered on a single thread.\n");
+        return EXIT_FAILURE;
+    }
+    if (threads > 1 && substrings && serve_path == NULL) {
+        fprintf(stderr, "Phrases are matched on a single thread.\n");
+        return EXIT_FAILURE;
+    }
+    if (serve_path != NULL && format != RECORDS_NONE) {
+        fprintf(stderr, "Records are not read while serving.\n");
+        return EXIT_FAILURE;
+    }
+    if (reload && format == RECORDS_NONE && serve_path == NULL) {
+        fprintf(stderr, "The dictionary is only reloaded between records.\n");
         return EXIT_FAILURE;
-    } else {
-        ht = ht_create(size_ht);
     }
 
-    // Reading in a list of badspeak words from badspeak.txt
-    FILE *badspeak_file = fopen("badspeak.txt", "r");
-    while (fscanf(badspeak_file, "%s\n", badspeak) != EOF) {
-        bf_insert(bf, badspeak);
-        ht_insert(ht, badspeak, NULL);
+    if (rewrite && (threads > 1 || format != RECORDS_NONE || substrings || serve_path != NULL)) {
+        fprintf(stderr, "The input is rewritten on a single thread, a word at a time.\n");
+        return EXIT_FAILURE;
+    }
+    if (hits && (threads > 1 || format != RECORDS_NONE || substrings || serve_path != NULL || rewrite)) {
+        fprintf(stderr, "Hits are streamed on a single thread, a word at a time.\n");
+        return EXIT_FAILURE;
+    }
+    if ((rewrite || hits) && stats_path != NULL && strcmp(stats_path, "-") == 0) {
+        fprintf(stderr, "The rewritten input or the hits are written to stdout.\n");
+        return EXIT_FAILURE;
     }
-    fclose(badspeak_file);
 
-    // Reading in a list of oldspeak and newspeak pairs from newspeak.txt
-    FILE *newspeak_file = fopen("newspeak.txt", "r");
-    while (fscanf(newspeak_file, "%s %s\n", oldspeak, newspeak) != EOF) {
-        bf_insert(bf, oldspeak);
-        ht_insert(ht, oldspeak, newspeak);
+    if ((fpr > 0 || prefilter != PREFILTER_BLOOM) && dict_path != NULL) {
+        fprintf(stderr, "A snapshot keeps the Bloom filter it was built with.\n");
+        return EXIT_FAILURE;
     }
-    fclose(newspeak_file);
 
-    // Compiling regular expression
-    regex_t re;
-    if (regcomp(&re, WORD, REG_EXTENDED)) {
-        fprintf(stderr, "Failed to compile regex.\n");
+    // Reading the word lists on every processor, though lists too short to be worth splitting are read on one
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t loaders = processors < 1 ? 1 : processors > MAX_THREADS ? MAX_THREADS : (uint32_t) processors;
+
+    // Counting from the start, so that the inserts of building the dictionary are counted as they always have been
+    if (stats || stats_path != NULL) {
+        stats_enable();
+    }
+    // Mapping the dictionary from a snapshot
+    // Else, building the dictionary from badspeak.txt and newspeak.txt, sized for the entries if given a rate
+    Source source = { dict_path, fpr > 0 && !size_ht_given ? 0 : size_ht, table, size_bf, hashes, blocked, engine,
+        prefilter, substrings && compile_path == NULL, loaders, fpr };
+    struct stat seen[2];
+    files_changed(&source, seen);
+    Version *version = version_load(&source);
+    if (version == NULL) {
         return EXIT_FAILURE;
     }
+    dict = version->dict;
+    ac = version->ac;
 
-    // Reading in words from stdin and filtering them if needed
-    char *word = NULL;
-    Node *mix_message = bst_create();
-    Node *bad_message = bst_create();
-    while ((word = next_word(stdin, &re)) != NULL) {
-        // Changing word to all lowercase
-        for (uint32_t i = 0; i < strlen(word); i++) {
-            word[i] = tolower(word[i]);
+    // Writing the dictionary to a snapshot if asked to, instead of filtering
+    if (compile_path != NULL) {
+        bool compiled = dict_compile(dict, compile_path);
+        version_delete(&version);
+        stats_clear();
+        return compiled ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Serving requests over a Unix socket instead of filtering the input, reloading the dictionary if asked to
+    if (serve_path != NULL) {
+        Epoch *versions = epoch_create(version, threads + 1);
+        Reloader reloader;
+        if (versions == NULL) {
+            fprintf(stderr, "Failed to create dictionary.\n");
+            return EXIT_FAILURE;
         }
-        // Check if word has been added to the Bloom filter
-        if (bf_probe(bf, word)) {
-            Node *n = ht_lookup(ht, word);
-            // If the hash table contains the word and the word does not have a newspeak translation,
-            // insert badspeak word into a list of badspeak words that the citizen used.
-            // If the hash table contains the word and the word does have a newspeak translation,
-            // insert oldspeak word and newspeak translation into a list of oldspeak words with newspeak translations.
-            if (n != NULL && n->newspeak == NULL) {
-                bad_message = bst_insert(bad_message, n->oldspeak, n->newspeak);
-            } else if (n != NULL && n->newspeak != NULL) {
-                mix_message = bst_insert(mix_message, n->oldspeak, n->newspeak);
-            }
+        if (reload && !reloader_start(&reloader, &source, versions, seen)) {
+            fprintf(stderr, "Failed to create reloader thread.\n");
+            return EXIT_FAILURE;
+        }
+        int status = serve(serve_path, threads, versions, stats, stats_path);
+        if (reload) {
+            reloader_stop(&reloader);
         }
+        version = (Version *) epoch_current(versions);
+        if (stats_enabled() && !report_stats(stats ? stdout : NULL, stats_path, version)) {
+            status = EXIT_FAILURE;
+        }
+        epoch_delete(&versions);
+        version_delete(&version);
+        stats_clear();
+        return status;
     }
 
-    // Print statistics if enabled
-    // Else, printing the corresponding message based on the crime of the citizen
-    if (stats) {
-        fprintf(stdout, "Average BST size: %f\n", ht_avg_bst_size(ht));
-        fprintf(stdout, "Average BST height: %f\n", ht_avg_bst_height(ht));
-        fprintf(stdout, "Average branches traversed: %f\n", ((float) branches / lookups));
-        fprintf(stdout, "Hash table load: %0.6f%%\n", (100 * ((float) ht_count(ht) / ht_size(ht))));
-        fprintf(
-            stdout, "Bloom filter load: %0.6f%%\n", (100 * ((float) bf_count(bf) / bf_size(bf))));
+    // Opening the input and creating the parser that scans words from it
+    int infile = STDIN_FILENO;
+    if (input != NULL && (infile = open(input, O_RDONLY)) < 0) {
+        perror(input);
+        return EXIT_FAILURE;
+    }
+    Parser *parser = parser_create(infile);
+    if (parser == NULL) {
+        fprintf(stderr, "Failed to create parser.\n");
+        return EXIT_FAILURE;
+    }
+
+    // Reading in words from the input and filtering them if needed
+    HitSet *mix_message = hs_create(dict_entries(dict));
+    HitSet *bad_message = hs_create(dict_entries(dict));
+    if (mix_message == NULL || bad_message == NULL) {
+        fprintf(stderr, "Failed to create hit sets.\n");
+        return EXIT_FAILURE;
+    }
+    bool streamed = true;
+    if (format != RECORDS_NONE) {
+        // Publishing the dictionary to the records, and reloading it in the background if asked to
+        Epoch *versions = epoch_create(version, 1);
+        Reloader reloader;
+        if (versions == NULL) {
+            fprintf(stderr, "Failed to create dictionary.\n");
+            return EXIT_FAILURE;
+        }
+        if (reload && !reloader_start(&reloader, &source, versions, seen)) {
+            fprintf(stderr, "Failed to create reloader thread.\n");
+            return EXIT_FAILURE;
+        }
+        filter_records(parser, format, !stats, versions);
+        if (reload) {
+            reloader_stop(&reloader);
+        }
+        version = (Version *) epoch_current(versions);
+        dict = version->dict;
+        ac = version->ac;
+        epoch_delete(&versions);
+    } else if (rewrite) {
+        // Streaming the input to stdout with the words found replaced, and the statistics printed to stderr
+        streamed = rewrite_text(parser, dict, mask, STDOUT_FILENO);
+    } else if (hits) {
+        // Printing every word found as soon as it is found, and then how often each one occurred
+        streamed = stream_hits(parser, dict);
+    } else if (threads == 1) {
+        filter_text(parser, dict, ac, bad_message, mix_message);
     } else {
-        if (bst_size(mix_message) > 0 && bst_size(bad_message) > 0) {
-            printf("%s", mixspeak_message);
-            bst_print(bad_message);
-            bst_print(mix_message);
-        } else if (bst_size(mix_message) == 0 && bst_size(bad_message) > 0) {
-            printf("%s", badspeak_message);
-            bst_print(bad_message);
-        } else if (bst_size(mix_message) > 0 && bst_size(bad_message) == 0) {
-            printf("%s", goodspeak_message);
-            bst_print(mix_message);
+        // Handing chunks of the input that end on word boundaries to the worker threads
+        Queue *chunks = queue_create(2 * threads);
+        Worker *workers = (Worker *) calloc(threads, sizeof(Worker));
+        if (chunks == NULL || workers == NULL) {
+            fprintf(stderr, "Failed to create worker threads.\n");
+            return EXIT_FAILURE;
         }
-    }
+        for (uint32_t i = 0; i < threads; i++) {
+            workers[i].chunks = chunks;
+            workers[i].dict = dict;
+            workers[i].bad_message = hs_create(dict_entries(dict));
+            workers[i].mix_message = hs_create(dict_entries(dict));
+            if (workers[i].bad_message == NULL || workers[i].mix_message == NULL) {
+                fprintf(stderr, "Failed to create hit sets.\n");
+                return EXIT_FAILURE;
+            }
+            if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) {
+                fprintf(stderr, "Failed to create worker threads.\n");
+                return EXIT_FAILURE;
+            }
+        }
+        Chunk *chunk = (Chunk *) malloc(sizeof(Chunk));
+        while (chunk != NULL
+               && (chunk->data = next_chunk(parser, CHUNK_SIZE, &chunk->length, &chunk->owned)) != NULL) {
+            queue_push(chunks, chunk);
+            chunk = (Chunk *) malloc(sizeof(Chunk));
+        }
+        free(chunk);
+        queue_close(chunks);
 
-    // Deleting the binary search trees used
-    bst_delete(&mix_message);
-    bst_delete(&bad_message);
+        // Merging the words each worker found
+        for (uint32_t i = 0; i < threads; i++) {
+            pthread_join(workers[i].thread, NULL);
+            hs_merge(bad_message, workers[i].bad_message);
+            hs_merge(mix_message, workers[i].mix_message);
+            hs_delete(&workers[i].bad_message);
+            hs_delete(&workers[i].mix_message);
+        }
+        free(workers);
+        queue_delete(&chunks);
+    }
 
-    // Deleting the bloom filter used
-    bf_delete(&bf);
+    // Print statistics if enabled, and write them as JSON if asked to
+    // Else, printing the corresponding message based on the crime of the citizen unless each record got a verdict,
+    // the input was rewritten or the hits were printed
+    int status = streamed ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (!stats && format == RECORDS_NONE && !rewrite && !hits) {
+        print_message(stdout, dict, bad_message, mix_message);
+    }
+    if (stats_enabled() && !report_stats(stats ? (rewrite || hits ? stderr : stdout) : NULL, stats_path, version)) {
+        status = EXIT_FAILURE;
+    }
 
-    // Deleting the hash table used
-    ht_delete(&ht);
+    // Deleting the sets of words found
+    hs_delete(&mix_message);
+    hs_delete(&bad_message);
 
-    // Clearing out the static words buffer
-    clear_words();
+    // Deleting the automaton and dictionary used, and the statistics
+    version_delete(&version);
+    stats_clear();
 
-    // Freeing the memory used by the regular expression
-    regfree(&re);
+    // Deleting the parser used and closing the input
+    parser_delete(&parser);
+    if (infile != STDIN_FILENO) {
+        close(infile);
+    }
 
-    return EXIT_SUCCESS;
+    return status;
 }
@@ -1,31 +1,65 @@
 #include "bf.h"
-#include "salts.h"
 #include "bv.h"
-#include "speck.h"
+#include "hc.h"
 
+#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
 struct BloomFilter {
-    uint64_t primary[2]; // Primary hash function salt.
-    uint64_t secondary[2]; // Secondary hash function salt.
-    uint64_t tertiary[2]; // Tertiary hash function salt.
+    uint32_t k; // Number of bits set per key.
+    bool blocked; // Whether all k bits of a key live in one cache-line block.
+    uint32_t blocks; // Number of cache-line blocks when blocked.
+    uint64_t keys; // Number of keys inserted.
     BitVector *filter;
 };
 
 // This function is the constructor for a Bloom filter.
-// This function takes in as a parameter a uint32_t size which represents the size in bits of the BitVector filter.
-// This function returns the created BloomFilter.
-BloomFilter *bf_create(uint32_t size) {
+// In blocked mode the size is rounded up to a whole number of BV_BLOCK_BITS blocks.
+// This function takes in as parameters a uint32_t size which represents the size in bits of the BitVector filter,
+// a uint32_t k which is the number of bits set per key, and a bool blocked which selects the blocked layout.
+// This function returns the created BloomFilter, or NULL if memory could not be allocated.
+BloomFilter *bf_create(uint32_t size, uint32_t k, bool blocked) {
     BloomFilter *bf = (BloomFilter *) malloc(sizeof(BloomFilter));
-    bf->primary[0] = SALT_PRIMARY_LO;
-    bf->primary[1] = SALT_PRIMARY_HI;
-    bf->secondary[0] = SALT_SECONDARY_LO;
-    bf->secondary[1] = SALT_SECONDARY_HI;
-    bf->tertiary[0] = SALT_TERTIARY_LO;
-    bf->tertiary[1] = SALT_TERTIARY_HI;
-    bf->filter = bv_create(size);
+    if (bf) {
+        bf->k = k;
+        bf->blocked = blocked;
+        bf->blocks = 0;
+        bf->keys = 0;
+        if (blocked) {
+            uint64_t blocks = ((uint64_t) size + BV_BLOCK_BITS - 1) / BV_BLOCK_BITS;
+            bf->blocks = (uint32_t) (blocks < UINT32_MAX / BV_BLOCK_BITS ? blocks : UINT32_MAX / BV_BLOCK_BITS);
+            size = (uint32_t) ((uint64_t) bf->blocks * BV_BLOCK_BITS);
+        }
+        bf->filter = bv_create(size);
+        if (!bf->filter) {
+            free(bf);
+            return NULL;
+        }
+    }
+    return bf;
+}
+
+// This function is the constructor for a read-only Bloom filter over the words of a filter built earlier, such as
+// the words of a mapped dictionary snapshot. The words are not copied and must outlive the Bloom filter.
+// This function takes in as parameters the uint64_t words of the filter, the uint32_t size, k and bool blocked the
+// filter was built with, the uint64_t number of keys that were inserted, and the uint32_t count of bits set.
+// This function returns the created BloomFilter, or NULL if memory could not be allocated.
+BloomFilter *bf_create_view(
+    const uint64_t *words, uint32_t size, uint32_t k, bool blocked, uint64_t keys, uint32_t count) {
+    BloomFilter *bf = (BloomFilter *) malloc(sizeof(BloomFilter));
+    if (bf) {
+        bf->k = k;
+        bf->blocked = blocked;
+        bf->blocks = blocked ? size / BV_BLOCK_BITS : 0;
+        bf->keys = keys;
+        bf->filter = bv_create_view(words, size, count);
+        if (!bf->filter) {
+            free(bf);
+            return NULL;
+        }
+    }
     return bf;
 }
 
@@ -44,32 +78,195 @@ uint32_t bf_size(BloomFilter *bf) {
     return bv_length(bf->filter);
 }
 
-// This function takes oldspeak and inserts it into the Bloom filter.
-// This function takes in as parameters a BloomFilter bf and char oldspeak.
-void bf_insert(BloomFilter *bf, char *oldspeak) {
-    bv_set_bit(bf->filter, hash(bf->primary, oldspeak) % bf_size(bf));
-    bv_set_bit(bf->filter, hash(bf->secondary, oldspeak) % bf_size(bf));
-    bv_set_bit(bf->filter, hash(bf->tertiary, oldspeak) % bf_size(bf));
+// This function returns the number of bits set per key.
+// This function takes in as a parameter a BloomFilter bf.
+uint32_t bf_hashes(BloomFilter *bf) {
+    return bf->k;
+}
+
+// This function returns whether the Bloom filter uses the blocked layout.
+// This function takes in as a parameter a BloomFilter bf.
+bool bf_blocked(BloomFilter *bf) {
+    return bf->blocked;
+}
+
+// This function returns the number of keys inserted into the Bloom filter.
+// This function takes in as a parameter a BloomFilter bf.
+uint64_t bf_keys(BloomFilter *bf) {
+    return bf->keys;
+}
+
+// This function returns the words that hold the bits of the Bloom filter.
+// This function takes in as a parameter a BloomFilter bf.
+const uint64_t *bf_words(BloomFilter *bf) {
+    return bv_words(bf->filter);
+}
+
+// This function is a helper function that builds the mask of the k bits a key sets inside its block. The block is
+// picked from the low half of the digest and the bit positions within the block from the high half, so the bits
+// land in a single cache line.
+// This function takes in as parameters a BloomFilter bf, the Digest d of the key, and the BV_BLOCK_WORDS words of
+// mask to fill in.
+// This function returns the index of the block.
+static inline uint32_t block_mask(BloomFilter *bf, Digest d, uint64_t mask[]) {
+    uint32_t h1 = (uint32_t) d.hi;
+    uint32_t h2 = (uint32_t) (d.hi >> 32) | 1;
+    for (uint32_t w = 0; w < BV_BLOCK_WORDS; w++) {
+        mask[w] = 0;
+    }
+    for (uint32_t i = 0; i < bf->k; i++) {
+        uint32_t bit = (h1 + i * h2) % BV_BLOCK_BITS;
+        mask[bit / 64] |= UINT64_C(0x1) << (bit % 64);
+    }
+    return (uint32_t) (d.lo % bf->blocks);
+}
+
+// This function inserts oldspeak into the Bloom filter. The k indices are derived from the digest of oldspeak
+// through double hashing, so oldspeak is only hashed once.
+// This function takes in as parameters a BloomFilter bf and the Digest d of oldspeak.
+void bf_insert(BloomFilter *bf, Digest d) {
+    bf->keys = bf->keys + 1;
+    if (bf->blocked) {
+        uint64_t mask[BV_BLOCK_WORDS];
+        uint32_t block = block_mask(bf, d, mask);
+        bv_set_block(bf->filter, block, mask);
+        return;
+    }
+    for (uint32_t i = 0; i < bf->k; i++) {
+        bv_set_bit(bf->filter, hc_index(d, i, bf_size(bf)));
+    }
+}
+
+// This function probes the Bloom filter for oldspeak. If all the bits at the indices derived from the digest of
+// oldspeak are set, this function returns true to signify that oldspeak was most likely added to the Bloom filter.
+// Else, this function returns false.
+// This function takes in as parameters a BloomFilter bf and the Digest d of oldspeak.
+bool bf_probe(BloomFilter *bf, Digest d) {
+    if (bf->blocked) {
+        uint64_t mask[BV_BLOCK_WORDS];
+        uint32_t block = block_mask(bf, d, mask);
+        return bv_test_block(bf->filter, block, mask);
+    }
+    for (uint32_t i = 0; i < bf->k; i++) {
+        if (!bv_get_bit(bf->filter, hc_index(d, i, bf_size(bf)))) {
+            return false;
+        }
+    }
+    return true;
 }
 
-// This function probes the Bloom filter for oldspeak. Oldspeak is hashed with each of the three salts for the three
-// indices. If all the bits at those indices are set, this function returns true to signify that oldspeak was most
-// likely added to the Bloom filter. Else, this function returns false.
-// This function takes in as parameters a BloomFilter bf and char oldspeak.
-bool bf_probe(BloomFilter *bf, char *oldspeak) {
-    return bv_get_bit(bf->filter, hash(bf->primary, oldspeak) % bf_size(bf))
-           && bv_get_bit(bf->filter, hash(bf->secondary, oldspeak) % bf_size(bf))
-           && bv_get_bit(bf->filter, hash(bf->tertiary, oldspeak) % bf_size(bf));
+// This function is a helper function that prefetches the word of the filter that probing for the Digest d reads
+// first. Without the blocked layout only the word of the first bit is prefetched: most keys are not in the filter
+// and their probe stops at that bit.
+static inline void prefetch(BloomFilter *bf, Digest d) {
+    const uint64_t *words = bv_words(bf->filter);
+    if (bf->blocked) {
+        __builtin_prefetch(words + (size_t) (d.lo % bf->blocks) * BV_BLOCK_WORDS);
+    } else {
+        __builtin_prefetch(words + hc_index(d, 0, bf_size(bf)) / 64);
+    }
+}
+
+// This function probes the Bloom filter for n keys at once. The words every key reads are prefetched before any key
+// is tested, so the cache misses of the keys overlap instead of following one another.
+// This function takes in as parameters a BloomFilter bf, the Digests d of the n keys, the uint32_t n, and the n
+// bools present which are set to what bf_probe() would return for each key.
+void bf_probe_many(BloomFilter *bf, const Digest *d, uint32_t n, bool *present) {
+    for (uint32_t i = 0; i < n; i++) {
+        prefetch(bf, d[i]);
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        present[i] = bf_probe(bf, d[i]);
+    }
 }
 
-// This function returns the number of set bits in the Bloom filter.
+// This function returns the number of set bits in the Bloom filter. The bit vector keeps its count as bits are set,
+// so this does not scan the filter.
 // This function takes in as a parameter a BloomFilter bf.
 uint32_t bf_count(BloomFilter *bf) {
-    uint32_t count = 0;
-    for (uint32_t i = 0; i < bv_length(bf->filter); i++) {
-        count = count + bv_get_bit(bf->filter, i);
+    return bv_count(bf->filter);
+}
+
+// This function merges the Bloom filter other into bf, so that bf holds every key inserted into either, as if they
+// had all been inserted into bf. This lets filters built separately, such as over shards of a dictionary, be
+// combined by ORing their bits. The filters must have been built with the same size, k, layout and hash keys.
+// The key count becomes the sum of both, which overcounts keys inserted into both filters, so bf_fpr() stays an
+// upper bound.
+// Returns false and leaves bf unchanged if the filters were built with different sizes, k or layouts, or bf is a
+// read-only view. Otherwise, returns true.
+// This function takes in as parameters the BloomFilters bf and other.
+bool bf_merge(BloomFilter *bf, BloomFilter *other) {
+    if (bf->k != other->k || bf->blocked != other->blocked || !bv_union(bf->filter, other->filter)) {
+        return false;
+    }
+    bf->keys = bf->keys + other->keys;
+    return true;
+}
+
+// This function returns true if two Bloom filters were built with the same size, k and layout and have the same bits
+// set, so that they answer every probe alike. Otherwise, returns false.
+// This function takes in as parameters the BloomFilters bf and other.
+bool bf_equal(BloomFilter *bf, BloomFilter *other) {
+    return bf->k == other->k && bf->blocked == other->blocked && bv_equal(bf->filter, other->filter);
+}
+
+// This function is a helper function that returns the theoretical false positive rate of a Bloom filter of size
+// bits that sets k bits per key, once n keys are inserted. The classic filter uses (1 - e^(-kn/m))^k. For the
+// blocked filter the keys per block follow a Poisson distribution, so the rate is the classic rate of a single
+// block averaged over that distribution.
+static double expected_fpr(double n, uint64_t size, double k, bool blocked) {
+    if (!blocked) {
+        return pow(1.0 - exp(-k * n / size), k);
+    }
+
+    double lambda = n / (double) (size / BV_BLOCK_BITS);
+    double fpr = 0.0;
+    uint64_t last = (uint64_t) (lambda + 10.0 * sqrt(lambda) + 10.0);
+    for (uint64_t j = 0; j <= last; j++) {
+        double p = exp(j * log(lambda) - lambda - lgamma(j + 1.0));
+        fpr += p * pow(1.0 - exp(-k * j / BV_BLOCK_BITS), k);
+    }
+    return fpr;
+}
+
+// This function returns the theoretical false positive rate of the Bloom filter given the keys inserted so far.
+// This function takes in as a parameter a BloomFilter bf.
+double bf_fpr(BloomFilter *bf) {
+    if (bf->keys == 0) {
+        return 0.0;
+    }
+    return expected_fpr((double) bf->keys, bf_size(bf), bf->k, bf->blocked);
+}
+
+// This function returns the number of bits of the Bloom filter per key inserted so far, or 0 if none has been.
+// This function takes in as a parameter a BloomFilter bf.
+double bf_bits_per_key(BloomFilter *bf) {
+    return bf->keys > 0 ? (double) bf_size(bf) / bf->keys : 0.0;
+}
+
+// This function picks the size and k of a Bloom filter that is expected to have a false positive rate of at most
+// fpr once keys keys are inserted. It starts from the classic optimum of -n ln(fpr) / ln(2)^2 bits with k of ln(2)
+// bits per key, and grows the size until bf_fpr() would meet fpr, which takes a few percent more bits for the
+// blocked filter, whose keys crowd some blocks more than others.
+// Returns the size in bits and sets k, or returns 0 if no filter of at most UINT32_MAX bits meets fpr.
+// This function takes in as parameters the uint64_t number of keys, the double fpr which must be between 0 and 1,
+// a bool blocked which selects the blocked layout, and a pointer to the uint32_t k.
+uint32_t bf_size_for(uint64_t keys, double fpr, bool blocked, uint32_t *k) {
+    double n = keys > 0 ? (double) keys : 1.0;
+    double bits = ceil(-n * log(fpr) / (log(2.0) * log(2.0)));
+    double hashes = round(bits / n * log(2.0));
+    *k = (uint32_t) (hashes < 1.0 ? 1.0 : hashes > BV_BLOCK_BITS ? BV_BLOCK_BITS : hashes);
+    uint64_t limit = blocked ? (UINT32_MAX / BV_BLOCK_BITS) * BV_BLOCK_BITS : UINT32_MAX;
+    for (uint64_t size = bits < 64.0 ? 64 : (uint64_t) fmin(bits, (double) limit); size <= limit;
+         size = size + size / 64 + 1) {
+        if (blocked) {
+            size = (size + BV_BLOCK_BITS - 1) / BV_BLOCK_BITS * BV_BLOCK_BITS;
+        }
+        if (size <= limit && expected_fpr(n, size, *k, blocked) <= fpr) {
+            return (uint32_t) size;
+        }
     }
-    return count;
+    return 0;
 }
 
 // This function is a debug function to print out the bits of a Bloom filter.
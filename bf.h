@@ -1,22 +1,46 @@
 #pragma once
 
 #include "bv.h"
+#include "hc.h"
 
 #include <stdbool.h>
 #include <stdint.h>
 
 typedef struct BloomFilter BloomFilter;
 
-BloomFilter *bf_create(uint32_t size);
+BloomFilter *bf_create(uint32_t size, uint32_t k, bool blocked);
+
+BloomFilter *bf_create_view(
+    const uint64_t *words, uint32_t size, uint32_t k, bool blocked, uint64_t keys, uint32_t count);
 
 void bf_delete(BloomFilter **bf);
 
 uint32_t bf_size(BloomFilter *bf);
 
-void bf_insert(BloomFilter *bf, char *oldspeak);
+uint32_t bf_hashes(BloomFilter *bf);
+
+bool bf_blocked(BloomFilter *bf);
+
+uint64_t bf_keys(BloomFilter *bf);
+
+const uint64_t *bf_words(BloomFilter *bf);
+
+void bf_insert(BloomFilter *bf, Digest d);
+
+bool bf_probe(BloomFilter *bf, Digest d);
 
-bool bf_probe(BloomFilter *bf, char *oldspeak);
+void bf_probe_many(BloomFilter *bf, const Digest *d, uint32_t n, bool *present);
 
 uint32_t bf_count(BloomFilter *bf);
 
+bool bf_merge(BloomFilter *bf, BloomFilter *other);
+
+bool bf_equal(BloomFilter *bf, BloomFilter *other);
+
+double bf_fpr(BloomFilter *bf);
+
+double bf_bits_per_key(BloomFilter *bf);
+
+uint32_t bf_size_for(uint64_t keys, double fpr, bool blocked, uint32_t *k);
+
 void bf_print(BloomFilter *bf);
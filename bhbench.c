@@ -0,0 +1,534 @@
+#include "ac.h"
+#include "bf.h"
+#include "bst.h"
+#include "corpus.h"
+#include "dict.h"
+#include "fuse.h"
+#include "hc.h"
+#include "hs.h"
+#include "ht.h"
+#include "node.h"
+#include "parser.h"
+
+#include <unistd.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <ctype.h>
+
+#define OPTIONS "hn:c:z:r:S:o:t:T:f:k:be:aj:"
+
+#define PATH_SIZE   4096
+#define BENCH_NS    250000000 // Nanoseconds each benchmark runs for at least.
+#define MAX_LOADERS 1024 // Most threads the word lists are read on.
+
+void help_message(void) {
+    fprintf(stderr, "SYNOPSIS\n"
+                    "  Microbenchmarks for banhammer.\n"
+                    "  Generates a corpus, times each stage of filtering it, and prints\n"
+                    "  the results as one line of JSON. The rates of dict_load are of\n"
+                    "  dictionary entries and word list bytes rather than of text.\n"
+                    "\n"
+                    "USAGE\n"
+                    "  ./bhbench [-hba] [-n entries] [-c tokens] [-z zipf] [-r rate] [-S seed]\n"
+                    "            [-o dir] [-t size] [-T table] [-f size] [-k hashes] [-e engine]\n"
+                    "            [-j threads]\n"
+                    "\n"
+                    "OPTIONS\n"
+                    "  -h           Program usage and help.\n"
+                    "  -n entries   Dictionary entries (default: 1000).\n"
+                    "  -c tokens    Words of text (default: 1000000).\n"
+                    "  -z zipf      Zipf exponent of the words of the text (default: 1.0).\n"
+                    "  -r rate      Fraction of the words of the text that are in the\n"
+                    "               dictionary (default: 0.05).\n"
+                    "  -S seed      Seed of the generator (default: 1).\n"
+                    "  -o dir       Directory to write the corpus to (default: bench.d).\n"
+                    "  -t size      Hash table size (default: 2^16).\n"
+                    "  -T table     Hash table engine, bst, open or perfect (default: bst).\n"
+                    "  -f size      Bloom filter size (default: 2^20).\n"
+                    "  -k hashes    Bloom filter bits set per word (default: 3).\n"
+                    "  -b           Use a cache-line blocked Bloom filter.\n"
+                    "  -e engine    Hash engine, speck or fast (default: speck).\n"
+                    "  -a           Also time the Aho-Corasick automaton.\n"
+                    "  -j threads   Threads dict_load reads the word lists on (default: 1).\n");
+}
+
+// The inputs every benchmark runs over. The words of the text are scanned once up front, folded to lowercase and
+// null terminated, so that each benchmark only times its own stage.
+typedef struct {
+    const char *text;
+    size_t bytes;
+    uint64_t tokens;
+    char **words;
+    uint32_t *lengths;
+    Digest *digests;
+    HashContext *hc;
+    BloomFilter *bf;
+    FuseFilter *fuse8;
+    FuseFilter *fuse16;
+    HashTable *ht;
+    Node *root; // A single binary search tree of every entry.
+    Dictionary *dict;
+    Automaton *ac;
+    HitSet *bad_message;
+    HitSet *mix_message;
+} Bench;
+
+// This function returns the time of the monotonic clock in nanoseconds.
+static uint64_t now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + (uint64_t) t.tv_nsec;
+}
+
+// This function is a helper function that prints one result as a JSON object. A result is the time per operation
+// and the rate at which the text would be filtered if only this stage ran, in words and in bytes.
+static void report(bool first, const char *name, uint64_t ops, uint64_t ns, uint64_t tokens, uint64_t bytes) {
+    printf("%s{\"name\":\"%s\",\"ops\":%" PRIu64 ",\"ns_per_op\":%.3f,\"tokens_per_s\":%.1f,\"mb_per_s\":%.3f}",
+        first ? "" : ",", name, ops, (double) ns / (double) ops, (double) tokens * 1e9 / (double) ns,
+        (double) bytes * 1e3 / (double) ns);
+}
+
+// This function runs pass over and over for at least BENCH_NS and reports the time per operation, where a pass is
+// one operation per word of the text. The results of the passes are summed into a checksum so they cannot be
+// optimized away.
+static uint64_t measure(Bench *b, bool first, const char *name, uint64_t (*pass)(Bench *b)) {
+    uint64_t checksum = pass(b);
+    uint64_t passes = 0;
+    uint64_t start = now();
+    uint64_t elapsed = 0;
+    do {
+        checksum += pass(b);
+        passes = passes + 1;
+        elapsed = now() - start;
+    } while (elapsed < BENCH_NS);
+    report(first, name, passes * b->tokens, elapsed, passes * b->tokens, passes * b->bytes);
+    return checksum;
+}
+
+// This function hashes every word.
+static uint64_t pass_hash(Bench *b) {
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < b->tokens; i++) {
+        sum += hc_digest(b->hc, b->words[i], b->lengths[i]).lo;
+    }
+    return sum;
+}
+
+// This function probes the Bloom filter for every word.
+static uint64_t pass_bf_probe(Bench *b) {
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < b->tokens; i++) {
+        sum += bf_probe(b->bf, b->digests[i]);
+    }
+    return sum;
+}
+
+// This function probes the 8-bit binary fuse filter for every word.
+static uint64_t pass_fuse8_probe(Bench *b) {
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < b->tokens; i++) {
+        sum += fuse_probe(b->fuse8, b->digests[i]);
+    }
+    return sum;
+}
+
+// This function probes the 16-bit binary fuse filter for every word.
+static uint64_t pass_fuse16_probe(Bench *b) {
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < b->tokens; i++) {
+        sum += fuse_probe(b->fuse16, b->digests[i]);
+    }
+    return sum;
+}
+
+// This function looks every word up in the hash table, whether or not the Bloom filter would let it through.
+static uint64_t pass_ht_lookup(Bench *b) {
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < b->tokens; i++) {
+        sum += ht_lookup(b->ht, b->words[i], b->lengths[i], b->digests[i]) != NULL;
+    }
+    return sum;
+}
+
+// This function looks every word up in a single binary search tree of the whole dictionary.
+static uint64_t pass_bst_find(Bench *b) {
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < b->tokens; i++) {
+        sum += bst_find(b->root, b->words[i]) != NULL;
+    }
+    return sum;
+}
+
+// This function scans every word of the text.
+static uint64_t pass_next_word(Bench *b) {
+    uint64_t sum = 0;
+    uint32_t length = 0;
+    Parser *parser = parser_create_buffer(b->text, b->bytes);
+    while (next_word(parser, &length) != NULL) {
+        sum += length;
+    }
+    parser_delete(&parser);
+    return sum;
+}
+
+// This function scans every word of the text and folds it to lowercase.
+static uint64_t pass_next_word_lower(Bench *b) {
+    uint64_t sum = 0;
+    uint32_t length = 0;
+    Parser *parser = parser_create_buffer(b->text, b->bytes);
+    while (next_word_lower(parser, &length) != NULL) {
+        sum += length;
+    }
+    parser_delete(&parser);
+    return sum;
+}
+
+// This function looks every word up in the dictionary, one at a time.
+static uint64_t pass_dict_lookup(Bench *b) {
+    uint64_t sum = 0;
+    Entry e;
+    for (uint64_t i = 0; i < b->tokens; i++) {
+        sum += dict_lookup(b->dict, b->words[i], b->lengths[i], &e);
+    }
+    return sum;
+}
+
+// This function looks every word up in the dictionary, DICT_BATCH at a time.
+static uint64_t pass_dict_lookup_many(Bench *b) {
+    uint64_t sum = 0;
+    Entry e[DICT_BATCH];
+    bool found[DICT_BATCH];
+    for (uint64_t i = 0; i < b->tokens; i += DICT_BATCH) {
+        uint32_t n = b->tokens - i < DICT_BATCH ? (uint32_t) (b->tokens - i) : DICT_BATCH;
+        sum += dict_lookup_many(b->dict, b->words + i, b->lengths + i, n, e, found);
+    }
+    return sum;
+}
+
+// This function is a helper function that counts a hit of the automaton.
+static void count_hit(const Entry *e, void *arg) {
+    *(uint64_t *) arg += e->id + 1;
+}
+
+// This function scans the text with the Aho-Corasick automaton.
+static uint64_t pass_ac_scan(Bench *b) {
+    uint64_t sum = 0;
+    uint32_t state = ac_scan(b->ac, AC_START, b->text, b->bytes, count_hit, &sum);
+    return sum + state;
+}
+
+// This function filters the text the way banhammer does: words are scanned, folded and looked up DICT_BATCH at a
+// time, and the ids of the words found are collected.
+static uint64_t pass_pipeline(Bench *b) {
+    const char *words[DICT_BATCH];
+    uint32_t lengths[DICT_BATCH];
+    Entry e[DICT_BATCH];
+    bool found[DICT_BATCH];
+    uint32_t count = DICT_BATCH;
+    Parser *parser = parser_create_buffer(b->text, b->bytes);
+    while (count == DICT_BATCH && (count = next_words_lower(parser, DICT_BATCH, words, lengths)) > 0) {
+        if (dict_lookup_many(b->dict, (char **) words, lengths, count, e, found) > 0) {
+            for (uint32_t i = 0; i < count; i++) {
+                if (found[i]) {
+                    hs_insert(e[i].newspeak == NULL ? b->bad_message : b->mix_message, e[i].id);
+                }
+            }
+        }
+    }
+    parser_delete(&parser);
+    uint64_t sum = hs_size(b->bad_message) + hs_size(b->mix_message);
+    hs_clear(b->bad_message);
+    hs_clear(b->mix_message);
+    return sum;
+}
+
+// This function reads the whole file at path into a null-terminated buffer that must be freed, and sets length to
+// its length. Returns NULL if the file could not be read.
+static char *read_file(const char *path, size_t *length) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL || fseek(f, 0, SEEK_END) != 0) {
+        perror(path);
+        return NULL;
+    }
+    long size = ftell(f);
+    rewind(f);
+    char *data = (char *) malloc((size_t) size + 1);
+    if (data == NULL || fread(data, 1, (size_t) size, f) != (size_t) size) {
+        perror(path);
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    data[size] = '\0';
+    *length = (size_t) size;
+    return data;
+}
+
+// This function is a helper function that parses a size or count given as an option argument.
+// Returns false if the argument is not a whole number from 1 to UINT32_MAX. Otherwise, sets value to it.
+static bool parse_size(const char *arg, uint32_t *value) {
+    char *end = NULL;
+    errno = 0;
+    unsigned long long parsed = strtoull(arg, &end, 10);
+    if (!isdigit((unsigned char) arg[0]) || *end != '\0' || errno != 0 || parsed == 0 || parsed > UINT32_MAX) {
+        return false;
+    }
+    *value = (uint32_t) parsed;
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int opt = 0;
+    uint32_t entries = 1000;
+    uint64_t tokens = 1000000;
+    double zipf = 1.0;
+    double rate = 0.05;
+    uint64_t seed = 1;
+    char *dir = "bench.d";
+    uint32_t size_ht = 65536;
+    TableEngine table = TABLE_BST;
+    uint32_t size_bf = 1048576;
+    uint32_t hashes = 3;
+    bool blocked = false;
+    HashEngine engine = HASH_SPECK;
+    bool automaton = false;
+    uint32_t loaders = 1;
+
+    // Parsing command-line options using getopt() and handling them accordingly
+    while ((opt = getopt(argc, argv, OPTIONS)) != -1) {
+        switch (opt) {
+        case 'n': entries = (uint32_t) strtoul(optarg, NULL, 10); break;
+        case 'c': tokens = strtoull(optarg, NULL, 10); break;
+        case 'z': zipf = atof(optarg); break;
+        case 'r': rate = atof(optarg); break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        case 'o': dir = optarg; break;
+        case 't':
+            if (!parse_size(optarg, &size_ht)) {
+                fprintf(stderr, "Invalid hash table size.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'T':
+            if (strcmp(optarg, "bst") == 0) {
+                table = TABLE_BST;
+            } else if (strcmp(optarg, "open") == 0) {
+                table = TABLE_OPEN;
+            } else if (strcmp(optarg, "perfect") == 0) {
+                table = TABLE_PERFECT;
+            } else {
+                fprintf(stderr, "Invalid hash table engine.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'f':
+            if (!parse_size(optarg, &size_bf)) {
+                fprintf(stderr, "Invalid Bloom filter size.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'k':
+            if (!parse_size(optarg, &hashes) || hashes > BV_BLOCK_BITS) {
+                fprintf(stderr, "Invalid number of Bloom filter hashes.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'b': blocked = true; break;
+        case 'e':
+            if (strcmp(optarg, "speck") == 0) {
+                engine = HASH_SPECK;
+            } else if (strcmp(optarg, "fast") == 0) {
+                engine = HASH_FAST;
+            } else {
+                fprintf(stderr, "Invalid hash engine.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'a': automaton = true; break;
+        case 'j':
+            if (!parse_size(optarg, &loaders) || loaders > MAX_LOADERS) {
+                fprintf(stderr, "Invalid number of threads.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'h': help_message(); return EXIT_SUCCESS;
+        default: help_message(); return EXIT_FAILURE;
+        }
+    }
+    if (zipf <= 0.0 || rate < 0.0 || rate > 1.0 || tokens == 0) {
+        fprintf(stderr, "Invalid text distribution.\n");
+        return EXIT_FAILURE;
+    }
+    if (mkdir(dir, 0777) < 0 && errno != EEXIST) {
+        perror(dir);
+        return EXIT_FAILURE;
+    }
+
+    // Generating the corpus
+    char badspeak[PATH_SIZE];
+    char newspeak[PATH_SIZE];
+    char text[PATH_SIZE];
+    snprintf(badspeak, PATH_SIZE, "%s/badspeak.txt", dir);
+    snprintf(newspeak, PATH_SIZE, "%s/newspeak.txt", dir);
+    snprintf(text, PATH_SIZE, "%s/text.txt", dir);
+    Corpus *corpus = corpus_create(entries, seed);
+    if (corpus == NULL || !corpus_write_dict(corpus, badspeak, newspeak)
+        || !corpus_write_text(corpus, text, tokens, zipf, rate)) {
+        return EXIT_FAILURE;
+    }
+    corpus_delete(&corpus);
+
+    // Loading the dictionary, which is timed once
+    Bench b;
+    memset(&b, 0, sizeof(b));
+    uint64_t start = now();
+    b.dict = dict_create(size_ht, table, size_bf, hashes, blocked, engine, PREFILTER_BLOOM);
+    if (b.dict == NULL || !dict_load(b.dict, badspeak, newspeak, loaders)) {
+        fprintf(stderr, "Failed to create dictionary.\n");
+        return EXIT_FAILURE;
+    }
+    uint64_t load_ns = now() - start;
+    entries = dict_entries(b.dict);
+    struct stat lists[2];
+    if (stat(badspeak, &lists[0]) < 0 || stat(newspeak, &lists[1]) < 0) {
+        perror(dir);
+        return EXIT_FAILURE;
+    }
+
+    // Scanning the words of the text once, so the stages after the parser run over the same words
+    b.text = read_file(text, &b.bytes);
+    if (b.text == NULL) {
+        return EXIT_FAILURE;
+    }
+    char *pool = (char *) malloc(b.bytes + 1);
+    b.words = (char **) malloc(tokens * sizeof(char *));
+    b.lengths = (uint32_t *) malloc(tokens * sizeof(uint32_t));
+    b.digests = (Digest *) malloc(tokens * sizeof(Digest));
+    b.hc = hc_create(engine);
+    b.bf = bf_create(size_bf, hashes, blocked);
+    b.ht = ht_create(size_ht, table);
+    b.bad_message = hs_create(entries);
+    b.mix_message = hs_create(entries);
+    if (pool == NULL || b.words == NULL || b.lengths == NULL || b.digests == NULL || b.hc == NULL || b.bf == NULL
+        || b.ht == NULL || b.bad_message == NULL || b.mix_message == NULL) {
+        fprintf(stderr, "Failed to allocate memory.\n");
+        return EXIT_FAILURE;
+    }
+    Parser *parser = parser_create_buffer(b.text, b.bytes);
+    const char *word = NULL;
+    uint32_t length = 0;
+    size_t used = 0;
+    while (b.tokens < tokens && (word = next_word_lower(parser, &length)) != NULL) {
+        memcpy(pool + used, word, (size_t) length + 1);
+        b.words[b.tokens] = pool + used;
+        b.lengths[b.tokens] = length;
+        b.digests[b.tokens] = hc_digest(b.hc, word, length);
+        used += (size_t) length + 1;
+        b.tokens = b.tokens + 1;
+    }
+    parser_delete(&parser);
+
+    // Building a standalone filter, table and tree over the dictionary, the tree in a shuffled order so it is not a
+    // list
+    uint32_t *order = (uint32_t *) malloc(((size_t) entries + 1) * sizeof(uint32_t));
+    Digest *keys = (Digest *) malloc(((size_t) entries + 1) * sizeof(Digest));
+    if (order == NULL || keys == NULL) {
+        fprintf(stderr, "Failed to allocate memory.\n");
+        return EXIT_FAILURE;
+    }
+    for (uint32_t i = 0; i < entries; i++) {
+        order[i] = i;
+    }
+    uint64_t state = seed;
+    for (uint32_t i = entries; i > 1; i--) {
+        state = state * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+        uint32_t j = (uint32_t) ((state >> 33) % i);
+        uint32_t swap = order[i - 1];
+        order[i - 1] = order[j];
+        order[j] = swap;
+    }
+    for (uint32_t i = 0; i < entries; i++) {
+        Entry e;
+        dict_entry(b.dict, order[i], &e);
+        Digest d = hc_digest(b.hc, e.oldspeak, (uint32_t) strlen(e.oldspeak));
+        bf_insert(b.bf, d);
+        keys[i] = d;
+        ht_insert(b.ht, (char *) e.oldspeak, (char *) e.newspeak, d);
+        b.root = bst_insert(b.root, (char *) e.oldspeak, (char *) e.newspeak);
+    }
+    ht_freeze(b.ht);
+    b.fuse8 = fuse_create(keys, entries, 8);
+    b.fuse16 = fuse_create(keys, entries, 16);
+    free(keys);
+    free(order);
+    if (b.fuse8 == NULL || b.fuse16 == NULL) {
+        fprintf(stderr, "Failed to build binary fuse filters.\n");
+        return EXIT_FAILURE;
+    }
+    if (automaton && (b.ac = ac_create(b.dict)) == NULL) {
+        fprintf(stderr, "Failed to create automaton.\n");
+        return EXIT_FAILURE;
+    }
+
+    // Counting the words of the text in the dictionary
+    uint64_t hits = 0;
+    for (uint64_t i = 0; i < b.tokens; i++) {
+        Entry e;
+        hits += dict_lookup(b.dict, b.words[i], b.lengths[i], &e);
+    }
+
+    // Running the benchmarks
+    printf("{\"config\":{\"entries\":%" PRIu32 ",\"tokens\":%" PRIu64 ",\"bytes\":%zu,\"zipf\":%g,\"hit_rate\":%g,"
+           "\"hits\":%" PRIu64 ",\"seed\":%" PRIu64 ",\"table\":\"%s\",\"size_ht\":%" PRIu32
+           ",\"size_bf\":%" PRIu32 ",\"hashes\":%" PRIu32 ",\"blocked\":%s,\"engine\":\"%s\",\"loaders\":%" PRIu32
+           "},\"results\":[",
+        entries, b.tokens, b.bytes, zipf, rate, hits, seed,
+        table == TABLE_BST ? "bst" : table == TABLE_OPEN ? "open" : "perfect", size_ht, bf_size(b.bf), hashes,
+        blocked ? "true" : "false", hc_engine_name(engine), loaders);
+    report(true, "dict_load", entries > 0 ? entries : 1, load_ns > 0 ? load_ns : 1, entries,
+        (uint64_t) (lists[0].st_size + lists[1].st_size));
+    uint64_t checksum = 0;
+    checksum += measure(&b, false, "hash", pass_hash);
+    checksum += measure(&b, false, "bf_probe", pass_bf_probe);
+    checksum += measure(&b, false, "fuse8_probe", pass_fuse8_probe);
+    checksum += measure(&b, false, "fuse16_probe", pass_fuse16_probe);
+    checksum += measure(&b, false, "ht_lookup", pass_ht_lookup);
+    checksum += measure(&b, false, "bst_find", pass_bst_find);
+    checksum += measure(&b, false, "next_word", pass_next_word);
+    checksum += measure(&b, false, "next_word_lower", pass_next_word_lower);
+    checksum += measure(&b, false, "dict_lookup", pass_dict_lookup);
+    checksum += measure(&b, false, "dict_lookup_many", pass_dict_lookup_many);
+    if (b.ac != NULL) {
+        checksum += measure(&b, false, "ac_scan", pass_ac_scan);
+    }
+    checksum += measure(&b, false, "pipeline", pass_pipeline);
+    printf("],\"checksum\":%" PRIu64 "}\n", checksum);
+
+    // Deleting everything that was built
+    if (b.ac != NULL) {
+        ac_delete(&b.ac);
+    }
+    hs_delete(&b.bad_message);
+    hs_delete(&b.mix_message);
+    bst_delete(&b.root);
+    ht_delete(&b.ht);
+    bf_delete(&b.bf);
+    fuse_delete(&b.fuse8);
+    fuse_delete(&b.fuse16);
+    hc_delete(&b.hc);
+    dict_delete(&b.dict);
+    free(b.digests);
+    free(b.lengths);
+    free(b.words);
+    free(pool);
+    free((char *) b.text);
+    return EXIT_SUCCESS;
+}
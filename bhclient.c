@@ -0,0 +1,287 @@
+#include "frame.h"
+
+#include <unistd.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+
+#define OPTIONS "hu:i:n:c:"
+
+#define MAX_CLIENTS 1024
+
+void help_message(void) {
+    fprintf(stderr, "SYNOPSIS\n"
+                    "  A client for a banhammer server.\n"
+                    "  Sends text to a banhammer --serve socket and prints the response, or\n"
+                    "  generates load against the server and reports the latency.\n"
+                    "\n"
+                    "USAGE\n"
+                    "  ./bhclient [-h] [-u socket] [-i input] [-n requests] [-c clients]\n"
+                    "\n"
+                    "OPTIONS\n"
+                    "  -h           Program usage and help.\n"
+                    "  -u socket    Socket of the server (default: banhammer.sock).\n"
+                    "  -i input     Read text from input instead of stdin.\n"
+                    "  -n requests  Send requests requests, one line of the input each, and\n"
+                    "               report the throughput and latency instead of printing the\n"
+                    "               responses.\n"
+                    "  -c clients   With -n, send the requests over clients connections at once\n"
+                    "               (default: 1).\n");
+}
+
+// The state of one connection of the load generator. Each sends its share of the requests one after another and
+// records the latency of each.
+typedef struct {
+    pthread_t thread;
+    const char *path;
+    char **lines;
+    uint32_t *lengths;
+    uint32_t count; // Number of lines.
+    uint64_t first; // Index of the first request this client sends.
+    uint64_t requests; // Number of requests this client sends.
+    uint64_t *latencies; // Nanoseconds each request took, indexed from first.
+    bool failed;
+} Client;
+
+// This function connects to the Unix socket at path.
+// This function returns the connected socket, or -1 after printing why if it could not connect.
+static int connect_to(const char *path) {
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path is too long.\n");
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &address, sizeof(address)) < 0) {
+        perror(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+// This function returns the time of the monotonic clock in nanoseconds.
+static uint64_t now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + (uint64_t) t.tv_nsec;
+}
+
+// This function reads everything from the file descriptor fd into a null-terminated buffer.
+// This function returns the buffer, which must be freed, and sets length to its length. Returns NULL if the input
+// could not be read or is larger than FRAME_MAX.
+static char *read_all(int fd, uint32_t *length) {
+    size_t size = 0;
+    size_t capacity = 1 << 16;
+    char *data = (char *) malloc(capacity);
+    ssize_t got = 0;
+    while (data != NULL && (got = read(fd, data + size, capacity - size - 1)) > 0) {
+        size += (size_t) got;
+        if (size > FRAME_MAX) {
+            fprintf(stderr, "Input is larger than a request can be.\n");
+            free(data);
+            return NULL;
+        }
+        if (capacity - size - 1 == 0) {
+            char *grown = (char *) realloc(data, 2 * capacity);
+            if (grown == NULL) {
+                free(data);
+            }
+            data = grown;
+            capacity = 2 * capacity;
+        }
+    }
+    if (data == NULL || got < 0) {
+        perror("read");
+        free(data);
+        return NULL;
+    }
+    data[size] = '\0';
+    *length = (uint32_t) size;
+    return data;
+}
+
+// This function is the body of a load generator connection. It sends the lines of the input round robin, starting
+// from its first request, and waits for each response before it sends the next request.
+// This function takes in as a parameter a void arg which is the Client of the thread.
+static void *client_main(void *arg) {
+    Client *c = (Client *) arg;
+    char *response = NULL;
+    uint32_t length = 0;
+    size_t capacity = 0;
+    int fd = connect_to(c->path);
+    c->failed = fd < 0;
+    for (uint64_t i = 0; i < c->requests && !c->failed; i++) {
+        uint32_t line = (uint32_t) ((c->first + i) % c->count);
+        uint64_t start = now();
+        if (!frame_send(fd, c->lines[line], c->lengths[line]) || !frame_recv(fd, &response, &length, &capacity)) {
+            fprintf(stderr, "Lost the connection to the server.\n");
+            c->failed = true;
+        }
+        c->latencies[c->first + i] = now() - start;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(response);
+    return NULL;
+}
+
+// This function is a helper function that orders latencies from shortest to longest.
+static int compare_latency(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+// This function generates load: it splits the input into lines and sends requests of them over clients
+// connections at once, then prints the throughput and the latency percentiles.
+// This function takes in as parameters the char path of the socket, the chars input with their uint32_t length,
+// and the uint64_t number of requests and uint32_t number of clients.
+// This function returns the exit status of the program.
+static int generate_load(const char *path, char *input, uint32_t length, uint64_t requests, uint32_t clients) {
+    // Splitting the input into lines, which are sent without their newlines
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        count = count + (input[i] == '\n');
+    }
+    char **lines = (char **) malloc(((size_t) count + 1) * sizeof(char *));
+    uint32_t *lengths = (uint32_t *) malloc(((size_t) count + 1) * sizeof(uint32_t));
+    uint64_t *latencies = (uint64_t *) calloc(requests, sizeof(uint64_t));
+    Client *threads = (Client *) calloc(clients, sizeof(Client));
+    if (lines == NULL || lengths == NULL || latencies == NULL || threads == NULL) {
+        fprintf(stderr, "Failed to allocate memory.\n");
+        return EXIT_FAILURE;
+    }
+    count = 0;
+    for (char *line = input; line < input + length;) {
+        char *end = memchr(line, '\n', (size_t) (input + length - line));
+        end = end != NULL ? end : input + length;
+        lines[count] = line;
+        lengths[count] = (uint32_t) (end - line);
+        count = count + 1;
+        line = end + 1;
+    }
+    if (count == 0) {
+        lines[0] = input;
+        lengths[0] = 0;
+        count = 1;
+    }
+
+    // Running the clients, each with an even share of the requests
+    uint64_t start = now();
+    for (uint32_t i = 0; i < clients; i++) {
+        threads[i].path = path;
+        threads[i].lines = lines;
+        threads[i].lengths = lengths;
+        threads[i].count = count;
+        threads[i].first = requests * i / clients;
+        threads[i].requests = requests * (i + 1) / clients - threads[i].first;
+        threads[i].latencies = latencies;
+        if (pthread_create(&threads[i].thread, NULL, client_main, &threads[i]) != 0) {
+            fprintf(stderr, "Failed to create client threads.\n");
+            return EXIT_FAILURE;
+        }
+    }
+    bool failed = false;
+    for (uint32_t i = 0; i < clients; i++) {
+        pthread_join(threads[i].thread, NULL);
+        failed = failed || threads[i].failed;
+    }
+    double seconds = (double) (now() - start) / 1e9;
+
+    // Reporting the throughput and latency
+    if (!failed) {
+        qsort(latencies, requests, sizeof(uint64_t), compare_latency);
+        printf("Requests: %" PRIu64 "\n", requests);
+        printf("Clients: %" PRIu32 "\n", clients);
+        printf("Seconds: %f\n", seconds);
+        printf("Requests per second: %f\n", (double) requests / seconds);
+        printf("Latency p50: %f us\n", (double) latencies[(requests - 1) / 2] / 1e3);
+        printf("Latency p99: %f us\n", (double) latencies[(requests - 1) * 99 / 100] / 1e3);
+        printf("Latency max: %f us\n", (double) latencies[requests - 1] / 1e3);
+    }
+    free(threads);
+    free(latencies);
+    free(lengths);
+    free(lines);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    int opt = 0;
+    char *path = "banhammer.sock";
+    char *input = NULL;
+    uint64_t requests = 0;
+    uint32_t clients = 1;
+
+    // Parsing command-line options using getopt() and handling them accordingly
+    while ((opt = getopt(argc, argv, OPTIONS)) != -1) {
+        switch (opt) {
+        case 'u': path = optarg; break;
+        case 'i': input = optarg; break;
+        case 'n': requests = strtoull(optarg, NULL, 10); break;
+        case 'c': clients = atoi(optarg); break;
+        case 'h': help_message(); return EXIT_SUCCESS;
+        default: help_message(); return EXIT_FAILURE;
+        }
+    }
+    if (clients <= 0 || clients > MAX_CLIENTS) {
+        fprintf(stderr, "Invalid number of clients.\n");
+        return EXIT_FAILURE;
+    }
+
+    // Reading the whole input
+    int infile = STDIN_FILENO;
+    if (input != NULL && (infile = open(input, O_RDONLY)) < 0) {
+        perror(input);
+        return EXIT_FAILURE;
+    }
+    uint32_t length = 0;
+    char *text = read_all(infile, &length);
+    if (infile != STDIN_FILENO) {
+        close(infile);
+    }
+    if (text == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    // Generating load if asked to
+    // Else, sending the input as one request and printing the response
+    int status = EXIT_SUCCESS;
+    if (requests > 0) {
+        status = generate_load(path, text, length, requests, clients < requests ? clients : (uint32_t) requests);
+    } else {
+        char *response = NULL;
+        uint32_t response_length = 0;
+        size_t capacity = 0;
+        int fd = connect_to(path);
+        if (fd < 0) {
+            status = EXIT_FAILURE;
+        } else if (!frame_send(fd, text, length) || !frame_recv(fd, &response, &response_length, &capacity)) {
+            fprintf(stderr, "Lost the connection to the server.\n");
+            status = EXIT_FAILURE;
+        } else {
+            fwrite(response, 1, response_length, stdout);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        free(response);
+    }
+    free(text);
+    return status;
+}
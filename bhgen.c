@@ -0,0 +1,84 @@
+#include "corpus.h"
+
+#include <unistd.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#define OPTIONS "hn:c:z:r:S:o:"
+
+#define PATH_SIZE 4096
+
+void help_message(void) {
+    fprintf(stderr, "SYNOPSIS\n"
+                    "  A synthetic corpus generator for banhammer.\n"
+                    "  Writes a dictionary and Zipf-distributed text that always come out\n"
+                    "  the same for the same options.\n"
+                    "\n"
+                    "USAGE\n"
+                    "  ./bhgen [-h] [-n entries] [-c tokens] [-z zipf] [-r rate] [-S seed] [-o dir]\n"
+                    "\n"
+                    "OPTIONS\n"
+                    "  -h           Program usage and help.\n"
+                    "  -n entries   Dictionary entries (default: 1000).\n"
+                    "  -c tokens    Words of text (default: 1000000).\n"
+                    "  -z zipf      Zipf exponent of the words of the text (default: 1.0).\n"
+                    "  -r rate      Fraction of the words of the text that are in the\n"
+                    "               dictionary (default: 0.05).\n"
+                    "  -S seed      Seed of the generator (default: 1).\n"
+                    "  -o dir       Directory to write badspeak.txt, newspeak.txt and text.txt\n"
+                    "               to (default: .).\n");
+}
+
+int main(int argc, char **argv) {
+    int opt = 0;
+    uint32_t entries = 1000;
+    uint64_t tokens = 1000000;
+    double zipf = 1.0;
+    double rate = 0.05;
+    uint64_t seed = 1;
+    char *dir = ".";
+
+    // Parsing command-line options using getopt() and handling them accordingly
+    while ((opt = getopt(argc, argv, OPTIONS)) != -1) {
+        switch (opt) {
+        case 'n': entries = (uint32_t) strtoul(optarg, NULL, 10); break;
+        case 'c': tokens = strtoull(optarg, NULL, 10); break;
+        case 'z': zipf = atof(optarg); break;
+        case 'r': rate = atof(optarg); break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        case 'o': dir = optarg; break;
+        case 'h': help_message(); return EXIT_SUCCESS;
+        default: help_message(); return EXIT_FAILURE;
+        }
+    }
+    if (zipf <= 0.0 || rate < 0.0 || rate > 1.0) {
+        fprintf(stderr, "Invalid text distribution.\n");
+        return EXIT_FAILURE;
+    }
+    if (mkdir(dir, 0777) < 0 && errno != EEXIST) {
+        perror(dir);
+        return EXIT_FAILURE;
+    }
+
+    // Writing the dictionary and then the text
+    char badspeak[PATH_SIZE];
+    char newspeak[PATH_SIZE];
+    char text[PATH_SIZE];
+    snprintf(badspeak, PATH_SIZE, "%s/badspeak.txt", dir);
+    snprintf(newspeak, PATH_SIZE, "%s/newspeak.txt", dir);
+    snprintf(text, PATH_SIZE, "%s/text.txt", dir);
+    Corpus *corpus = corpus_create(entries, seed);
+    if (corpus == NULL) {
+        fprintf(stderr, "Failed to create corpus.\n");
+        return EXIT_FAILURE;
+    }
+    bool written = corpus_write_dict(corpus, badspeak, newspeak)
+                   && corpus_write_text(corpus, text, tokens, zipf, rate);
+    corpus_delete(&corpus);
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
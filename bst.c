@@ -1,13 +1,12 @@
 #include "bst.h"
 #include "node.h"
+#include "stats.h"
 
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-uint64_t branches = 0;
-
 // This function is the constructor for a binary search tree that constructs an empty tree.
 // This function returns NULL to indicate an empty tree.
 Node *bst_create(void) {
@@ -44,64 +43,83 @@ uint32_t bst_size(Node *root) {
 // char oldspeak which is what we are trying to find in the binary search tree.
 Node *bst_find(Node *root, char *oldspeak) {
     Node *current_node = root;
+    uint64_t steps = 0;
     if (root != NULL && oldspeak != NULL) {
         while (current_node != NULL && strcmp(current_node->oldspeak, oldspeak) != 0) {
             if (strcmp(current_node->oldspeak, oldspeak) > 0) {
                 current_node = current_node->left;
-                branches = branches + 1;
             } else {
                 current_node = current_node->right;
-                branches = branches + 1;
             }
+            steps = steps + 1;
         }
     }
+    stats_add(STAT_BRANCHES, steps);
     return current_node;
 }
 
+// This function finds where oldspeak is, or belongs, in the binary search tree rooted at *root, in a single descent.
+// The branches taken are not counted, so that a caller inserting oldspeak counts them only if it is not a
+// duplicate.
+// This function takes in as parameters a double pointer to the Node root of a binary search tree, a char oldspeak,
+// and a pointer to the uint32_t depth, which is set to the number of branches taken.
+// This function returns the link that points to the node containing oldspeak, or the NULL link to set to a new node
+// containing it.
+Node **bst_slot(Node **root, const char *oldspeak, uint32_t *depth) {
+    Node **link = root;
+    *depth = 0;
+    int order = 0;
+    while (*link != NULL && (order = strcmp((*link)->oldspeak, oldspeak)) != 0) {
+        link = order > 0 ? &(*link)->left : &(*link)->right;
+        *depth = *depth + 1;
+    }
+    return link;
+}
+
 // This function inserts a new node containing the specified oldspeak and newspeak into the binary search tree
 // rooted at root. Duplicates should not be inserted.
 // This function takes in as parameters a Node root which represents the root node of a binary search tree, a char
 // oldspeak, and a char newspeak.
 // This function returns the updated binary search tree (the Node root).
 Node *bst_insert(Node *root, char *oldspeak, char *newspeak) {
-    Node *a = root;
-    Node *b = NULL;
     if (root == NULL) {
-        b = node_create(oldspeak, newspeak);
-        root = b;
-        return root;
+        return node_create(oldspeak, newspeak);
     }
-
     if (oldspeak == NULL) {
         return root;
     }
-
-    uint32_t temp = branches;
-    if (bst_find(root, oldspeak) != NULL) {
-        branches = temp;
-        return root;
+    uint32_t depth = 0;
+    Node **link = bst_slot(&root, oldspeak, &depth);
+    if (*link == NULL) {
+        *link = node_create(oldspeak, newspeak);
+        stats_add(STAT_BRANCHES, depth);
     }
-    branches = temp;
+    return root;
+}
 
-    if (root != NULL && oldspeak != NULL) {
-        while (a != NULL) {
-            b = a;
-            if (strcmp(a->oldspeak, oldspeak) > 0) {
-                a = a->left;
-                branches = branches + 1;
-            } else {
-                a = a->right;
-                branches = branches + 1;
-            }
-        }
+// This function inserts a copy of every node in the binary search tree rooted at other into the binary search tree
+// rooted at root. Duplicates are not inserted.
+// This function takes in as parameters a Node root and a Node other which represent the root nodes of the two
+// binary search trees.
+// This function returns the updated binary search tree (the Node root).
+Node *bst_merge(Node *root, Node *other) {
+    if (other) {
+        root = bst_insert(root, other->oldspeak, other->newspeak);
+        root = bst_merge(root, other->left);
+        root = bst_merge(root, other->right);
     }
+    return root;
+}
 
-    if (strcmp(b->oldspeak, oldspeak) > 0) {
-        b->left = node_create(oldspeak, newspeak);
-    } else {
-        b->right = node_create(oldspeak, newspeak);
+// This function calls visit on each node in the binary search tree through an inorder traversal.
+// This function takes in as parameters a Node root which represents the root node of a binary search tree, the
+// function visit, and a void arg which is passed on to visit.
+void bst_walk(Node *root, void (*visit)(Node *n, void *arg), void *arg) {
+    if (root) {
+        bst_walk(root->left, visit, arg);
+        visit(root, arg);
+        bst_walk(root->right, visit, arg);
     }
-    return root;
 }
 
 // This function prints out each node in the binary search tree through an inorder traversal.
@@ -4,8 +4,6 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-extern uint64_t branches;
-
 Node *bst_create(void);
 
 uint32_t bst_height(Node *root);
@@ -16,6 +14,12 @@ Node *bst_find(Node *root, char *oldspeak);
 
 Node *bst_insert(Node *root, char *oldspeak, char *newspeak);
 
+Node **bst_slot(Node **root, const char *oldspeak, uint32_t *depth);
+
+Node *bst_merge(Node *root, Node *other);
+
+void bst_walk(Node *root, void (*visit)(Node *n, void *arg), void *arg);
+
 void bst_print(Node *root);
 
 void bst_delete(Node **root);
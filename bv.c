@@ -4,14 +4,33 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <inttypes.h>
 
 struct BitVector {
     uint32_t length;
-    uint8_t *vector;
+    uint32_t count; // Number of set bits, kept up to date as bits are set and cleared.
+    bool owned; // Whether vector was allocated by the bit vector.
+    uint64_t *vector;
 };
 
+// This function is a helper function that returns the number of words that hold length bits.
+static inline size_t words_of(uint32_t length) {
+    return ((size_t) length + 63) / 64;
+}
+
+// This function is a helper function that returns the number of set bits in n words.
+static uint32_t popcount(const uint64_t *words, size_t n) {
+    uint64_t count = 0;
+    for (size_t w = 0; w < n; w++) {
+        count += (uint64_t) __builtin_popcountll(words[w]);
+    }
+    return (uint32_t) count;
+}
+
 // This function is the constructor for a bit vector that holds length bits.
+// The bits are stored in 64-bit words and the storage is aligned to and padded out to whole 64-byte cache lines
+// so that a block of BV_BLOCK_BITS bits never straddles two lines.
 // This function takes in as a parameter a uint32_t named length which represents the number of bits
 // the bit vector holds.
 // This function returns NULL in the event that sufficient memory cannot be allocated for the BitVector
@@ -19,19 +38,48 @@ struct BitVector {
 BitVector *bv_create(uint32_t length) {
     BitVector *bv = (BitVector *) malloc(sizeof(BitVector));
     if (bv) {
+        size_t blocks = ((size_t) length + BV_BLOCK_BITS - 1) / BV_BLOCK_BITS;
+        size_t bytes = (blocks ? blocks : 1) * (BV_BLOCK_BITS / 8);
         bv->length = length;
-        bv->vector = (uint8_t *) calloc(((length - 1) / 8) + 1, sizeof(uint8_t));
+        bv->count = 0;
+        bv->owned = true;
+        bv->vector = (uint64_t *) aligned_alloc(BV_BLOCK_BITS / 8, bytes);
+        if (!bv->vector) {
+            free(bv);
+            return NULL;
+        }
+        memset(bv->vector, 0, bytes);
         return bv;
     } else {
         return NULL;
     }
 }
 
+// This function is the constructor for a read-only bit vector over length bits of existing words, such as the
+// words of a mapped dictionary snapshot. The words are not copied and must outlive the bit vector. Their number of
+// set bits is passed in, as recorded when they were written, so the words are neither scanned nor paged in here.
+// This function takes in as parameters the uint64_t words, a uint32_t length which represents the number of bits,
+// and the uint32_t count of bits that are set.
+// This function returns NULL in the event that sufficient memory cannot be allocated for the BitVector
+// otherwise it returns a pointer to an allocated BitVector.
+BitVector *bv_create_view(const uint64_t *words, uint32_t length, uint32_t count) {
+    BitVector *bv = (BitVector *) malloc(sizeof(BitVector));
+    if (bv) {
+        bv->length = length;
+        bv->count = count;
+        bv->owned = false;
+        bv->vector = (uint64_t *) words;
+    }
+    return bv;
+}
+
 // This function is the destructor for a bit vector.
 // This function takes in as a parameter a double pointer to a BitVector bv.
 void bv_delete(BitVector **bv) {
     if (*bv && (*bv)->vector) {
-        free((*bv)->vector);
+        if ((*bv)->owned) {
+            free((*bv)->vector);
+        }
         free(*bv);
         *bv = NULL;
     }
@@ -43,13 +91,29 @@ uint32_t bv_length(BitVector *bv) {
     return bv->length;
 }
 
+// This function returns the words that hold the bits of a bit vector. Bit i is bit i % 64 of word i / 64, and
+// the words are padded out to whole BV_BLOCK_BITS blocks.
+// This function takes in as a parameter a BitVector bv.
+const uint64_t *bv_words(BitVector *bv) {
+    return bv->vector;
+}
+
+// This function returns the number of set bits in a bit vector. The count is kept as bits change, so this does not
+// scan the bit vector.
+// This function takes in as a parameter a BitVector bv.
+uint32_t bv_count(BitVector *bv) {
+    return bv->count;
+}
+
 // This function sets the ith bit in a bit vector. If i is out of range, returns false. Otherise, returns true
 // to indicate success.
 // This function takes in as parameters a BitVector bv and a uint32_t i which represents the index of the
 // bit we are setting.
 bool bv_set_bit(BitVector *bv, uint32_t i) {
-    if (i < bv->length && i >= 0) {
-        bv->vector[i / 8] |= (0x1 << i % 8);
+    if (i < bv->length) {
+        uint64_t bit = UINT64_C(0x1) << i % 64;
+        bv->count += (bv->vector[i / 64] & bit) == 0;
+        bv->vector[i / 64] |= bit;
         return true;
     } else {
         return false;
@@ -61,8 +125,10 @@ bool bv_set_bit(BitVector *bv, uint32_t i) {
 // This function takes in as parameters a BitVector bv and a uint32_t i which represents the index of the
 // bit we are clearing.
 bool bv_clr_bit(BitVector *bv, uint32_t i) {
-    if (i < bv->length && i >= 0) {
-        bv->vector[i / 8] &= ~(0x1 << i % 8);
+    if (i < bv->length) {
+        uint64_t bit = UINT64_C(0x1) << i % 64;
+        bv->count -= (bv->vector[i / 64] & bit) != 0;
+        bv->vector[i / 64] &= ~bit;
         return true;
     } else {
         return false;
@@ -74,17 +140,79 @@ bool bv_clr_bit(BitVector *bv, uint32_t i) {
 // This function takes in as parameters a BitVector bv and a uint32_t i which represents the index of the bit we
 // are getting.
 bool bv_get_bit(BitVector *bv, uint32_t i) {
-    if (i < bv->length && i >= 0 && (((bv->vector[i / 8] >> i % 8) & 0x1) == 1)) {
+    if (i < bv->length && (((bv->vector[i / 64] >> i % 64) & 0x1) == 1)) {
         return true;
     } else {
         return false;
     }
 }
 
+// This function sets every bit of mask in the given cache-line block of the bit vector.
+// This function takes in as parameters a BitVector bv, a uint32_t block which is the index of the block, and
+// the BV_BLOCK_WORDS words of mask.
+void bv_set_block(BitVector *bv, uint32_t block, uint64_t mask[]) {
+    uint64_t *words = bv->vector + (size_t) block * BV_BLOCK_WORDS;
+    for (uint32_t w = 0; w < BV_BLOCK_WORDS; w++) {
+        bv->count += (uint32_t) __builtin_popcountll(mask[w] & ~words[w]);
+        words[w] |= mask[w];
+    }
+}
+
+// This function returns true if every bit of mask is set in the given cache-line block of the bit vector.
+// Otherwise, returns false.
+// This function takes in as parameters a BitVector bv, a uint32_t block which is the index of the block, and
+// the BV_BLOCK_WORDS words of mask.
+bool bv_test_block(BitVector *bv, uint32_t block, uint64_t mask[]) {
+    const uint64_t *words = bv->vector + (size_t) block * BV_BLOCK_WORDS;
+    uint64_t missing = 0;
+    for (uint32_t w = 0; w < BV_BLOCK_WORDS; w++) {
+        missing |= mask[w] & ~words[w];
+    }
+    return missing == 0;
+}
+
+// This function sets every bit of bv that is set in other, so that bv becomes the union of the two.
+// Returns false and leaves bv unchanged if the lengths differ or bv is a read-only view. Otherwise, returns true.
+// This function takes in as parameters the BitVectors bv and other.
+bool bv_union(BitVector *bv, BitVector *other) {
+    if (bv->length != other->length || !bv->owned) {
+        return false;
+    }
+    size_t n = words_of(bv->length);
+    for (size_t w = 0; w < n; w++) {
+        bv->vector[w] |= other->vector[w];
+    }
+    bv->count = popcount(bv->vector, n);
+    return true;
+}
+
+// This function clears every bit of bv that is clear in other, so that bv becomes the intersection of the two.
+// Returns false and leaves bv unchanged if the lengths differ or bv is a read-only view. Otherwise, returns true.
+// This function takes in as parameters the BitVectors bv and other.
+bool bv_intersect(BitVector *bv, BitVector *other) {
+    if (bv->length != other->length || !bv->owned) {
+        return false;
+    }
+    size_t n = words_of(bv->length);
+    for (size_t w = 0; w < n; w++) {
+        bv->vector[w] &= other->vector[w];
+    }
+    bv->count = popcount(bv->vector, n);
+    return true;
+}
+
+// This function returns true if two bit vectors have the same length and the same bits set. Otherwise, returns
+// false. Bit vectors with different counts are told apart without reading their words.
+// This function takes in as parameters the BitVectors bv and other.
+bool bv_equal(BitVector *bv, BitVector *other) {
+    return bv->length == other->length && bv->count == other->count
+           && memcmp(bv->vector, other->vector, words_of(bv->length) * sizeof(uint64_t)) == 0;
+}
+
 // This function is a debug function to print the bits of a bit vector.
 // This function takes in as a parameter a BitVector bv.
 void bv_print(BitVector *bv) {
-    for (uint32_t i = 0; i < ((bv->length - 1) / 8) + 1; i++) {
-        printf("Bits at index %d: %" PRIu8 "\n", i, bv->vector[i]);
+    for (uint32_t i = 0; i < ((bv->length - 1) / 64) + 1; i++) {
+        printf("Bits at index %" PRIu32 ": %" PRIu64 "\n", i, bv->vector[i]);
     }
 }
@@ -3,18 +3,37 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#define BV_BLOCK_BITS  512 // One 64-byte cache line.
+#define BV_BLOCK_WORDS (BV_BLOCK_BITS / 64)
+
 typedef struct BitVector BitVector;
 
 BitVector *bv_create(uint32_t length);
 
+BitVector *bv_create_view(const uint64_t *words, uint32_t length, uint32_t count);
+
 void bv_delete(BitVector **bv);
 
 uint32_t bv_length(BitVector *bv);
 
+const uint64_t *bv_words(BitVector *bv);
+
+uint32_t bv_count(BitVector *bv);
+
 bool bv_set_bit(BitVector *bv, uint32_t i);
 
 bool bv_clr_bit(BitVector *bv, uint32_t i);
 
 bool bv_get_bit(BitVector *bv, uint32_t i);
 
+void bv_set_block(BitVector *bv, uint32_t block, uint64_t mask[]);
+
+bool bv_test_block(BitVector *bv, uint32_t block, uint64_t mask[]);
+
+bool bv_union(BitVector *bv, BitVector *other);
+
+bool bv_intersect(BitVector *bv, BitVector *other);
+
+bool bv_equal(BitVector *bv, BitVector *other);
+
 void bv_print(BitVector *bv);
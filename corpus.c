@@ -0,0 +1,184 @@
+#include "corpus.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A synthetic corpus. Words are numbered, and word i spells the base 64 digits of i + 1 as syllables, so words
+// are unique, short words are the low numbers, and every seed spells them with a differently shuffled syllable
+// table. Dictionary entry j is word 2j and the words that are not in the dictionary are the odd words, so both
+// have the same lengths.
+struct Corpus {
+    uint32_t entries;
+    uint32_t misses; // Number of odd words text is drawn from when it misses the dictionary.
+    uint64_t seed;
+    char syllables[64][3];
+};
+
+// This function is a helper function that returns the next number of a splitmix64 generator.
+static uint64_t next(uint64_t *state) {
+    uint64_t z = (*state += UINT64_C(0x9e3779b97f4a7c15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return z ^ (z >> 31);
+}
+
+// This function is a helper function that returns a uniform double in (0, 1].
+static double uniform(uint64_t *state) {
+    return ((next(state) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+// This function is a helper function that draws a rank in [1, n] from a Zipf distribution with exponent s, by
+// inverting the cumulative distribution of the continuous power law.
+static uint64_t zipf_rank(uint64_t *state, uint64_t n, double s) {
+    double u = uniform(state);
+    double x = 0.0;
+    if (fabs(s - 1.0) < 1e-9) {
+        x = exp(u * log((double) n + 1.0));
+    } else {
+        x = pow((pow((double) n + 1.0, 1.0 - s) - 1.0) * u + 1.0, 1.0 / (1.0 - s));
+    }
+    uint64_t rank = (uint64_t) x;
+    return rank < 1 ? 1 : rank > n ? n : rank;
+}
+
+// This function is the constructor for a corpus over a dictionary of entries words. The same entries and seed
+// always generate the same dictionary and text.
+// This function takes in as parameters the uint32_t number of entries and the uint64_t seed.
+// This function returns the created Corpus, or NULL if memory could not be allocated.
+Corpus *corpus_create(uint32_t entries, uint64_t seed) {
+    static const char consonants[] = "bdfgklmnprstvwyz";
+    static const char vowels[] = "aeio";
+    Corpus *c = (Corpus *) malloc(sizeof(Corpus));
+    if (c) {
+        uint64_t state = seed;
+        c->entries = entries;
+        c->misses = entries < 16384 ? 65536 : 4 * entries;
+        c->seed = seed;
+        for (int i = 0; i < 64; i++) {
+            c->syllables[i][0] = consonants[i / 4];
+            c->syllables[i][1] = vowels[i % 4];
+            c->syllables[i][2] = '\0';
+        }
+        for (int i = 63; i > 0; i--) {
+            int j = (int) (next(&state) % (uint64_t) (i + 1));
+            char swap[3];
+            memcpy(swap, c->syllables[i], 3);
+            memcpy(c->syllables[i], c->syllables[j], 3);
+            memcpy(c->syllables[j], swap, 3);
+        }
+    }
+    return c;
+}
+
+// This function is the destructor for a corpus.
+// This function takes in as a parameter a double pointer to the Corpus c.
+void corpus_delete(Corpus **c) {
+    free(*c);
+    *c = NULL;
+}
+
+// This function spells word i of the corpus into word, which must hold CORPUS_WORD_MAX bytes.
+// This function takes in as parameters a Corpus c, the uint64_t number i of the word, and the chars word.
+// This function returns the length of the word.
+uint32_t corpus_word(Corpus *c, uint64_t i, char *word) {
+    char digits[CORPUS_WORD_MAX / 2];
+    uint32_t count = 0;
+    for (uint64_t v = i + 1; v > 0; v /= 64) {
+        digits[count] = (char) (v % 64);
+        count = count + 1;
+    }
+    for (uint32_t d = 0; d < count; d++) {
+        memcpy(word + 2 * d, c->syllables[(int) digits[count - 1 - d]], 2);
+    }
+    word[2 * count] = '\0';
+    return 2 * count;
+}
+
+// This function writes the dictionary of the corpus, in a shuffled order, as a badspeak and a newspeak file in the
+// format dict_load() reads. Even entries are badspeak. Odd entries are oldspeak, translated to the word that follows
+// them, which is not in the dictionary.
+// This function takes in as parameters a Corpus c and the char paths of the badspeak and newspeak files.
+// This function returns false if the files could not be written. Otherwise, returns true.
+bool corpus_write_dict(Corpus *c, const char *badspeak, const char *newspeak) {
+    uint32_t *order = (uint32_t *) malloc(((size_t) c->entries + 1) * sizeof(uint32_t));
+    FILE *bad = fopen(badspeak, "w");
+    FILE *good = fopen(newspeak, "w");
+    bool written = order != NULL && bad != NULL && good != NULL;
+    if (written) {
+        uint64_t state = c->seed ^ UINT64_C(0x5bd1e995);
+        for (uint32_t j = 0; j < c->entries; j++) {
+            order[j] = j;
+        }
+        for (uint32_t j = c->entries; j > 1; j--) {
+            uint32_t k = (uint32_t) (next(&state) % j);
+            uint32_t swap = order[j - 1];
+            order[j - 1] = order[k];
+            order[k] = swap;
+        }
+        char word[CORPUS_WORD_MAX];
+        char translation[CORPUS_WORD_MAX];
+        for (uint32_t j = 0; j < c->entries; j++) {
+            corpus_word(c, 2 * (uint64_t) order[j], word);
+            if (order[j] % 2 == 0) {
+                fprintf(bad, "%s\n", word);
+            } else {
+                corpus_word(c, 2 * (uint64_t) order[j] + 1, translation);
+                fprintf(good, "%s %s\n", word, translation);
+            }
+        }
+    }
+    if (bad != NULL && fclose(bad) != 0) {
+        written = false;
+    }
+    if (good != NULL && fclose(good) != 0) {
+        written = false;
+    }
+    free(order);
+    if (!written) {
+        perror("corpus");
+    }
+    return written;
+}
+
+// This function writes tokens words of text drawn from the corpus. Each word is a dictionary entry with probability
+// hit_rate and otherwise a word that is not in the dictionary, and within each kind the words follow a Zipf
+// distribution with exponent zipf, so the low numbered words are the most frequent. Lines hold 4 to 19 words and
+// start with a capital letter.
+// This function takes in as parameters a Corpus c, the char path of the file, the uint64_t number of tokens, and
+// the doubles zipf and hit_rate.
+// This function returns false if the file could not be written. Otherwise, returns true.
+bool corpus_write_text(Corpus *c, const char *path, uint64_t tokens, double zipf, double hit_rate) {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        return false;
+    }
+    uint64_t state = c->seed ^ UINT64_C(0x2545f4914f6cdd1d);
+    char word[CORPUS_WORD_MAX];
+    uint64_t line = 0;
+    for (uint64_t t = 0; t < tokens; t++) {
+        uint64_t i = 0;
+        if (c->entries > 0 && uniform(&state) <= hit_rate) {
+            i = 2 * (zipf_rank(&state, c->entries, zipf) - 1);
+        } else {
+            i = 2 * (zipf_rank(&state, c->misses, zipf) - 1) + 1;
+        }
+        corpus_word(c, i, word);
+        if (line == 0) {
+            word[0] = (char) (word[0] - 'a' + 'A');
+            line = 4 + next(&state) % 16;
+        }
+        line = line - 1;
+        fputs(word, out);
+        fputc(line == 0 || t + 1 == tokens ? '\n' : ' ', out);
+    }
+    if (fclose(out) != 0) {
+        perror(path);
+        return false;
+    }
+    return true;
+}
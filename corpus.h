@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CORPUS_WORD_MAX 32 // Bytes a generated word and its null terminator fit in.
+
+typedef struct Corpus Corpus;
+
+Corpus *corpus_create(uint32_t entries, uint64_t seed);
+
+void corpus_delete(Corpus **c);
+
+uint32_t corpus_word(Corpus *c, uint64_t i, char *word);
+
+bool corpus_write_dict(Corpus *c, const char *badspeak, const char *newspeak);
+
+bool corpus_write_text(Corpus *c, const char *path, uint64_t tokens, double zipf, double hit_rate);
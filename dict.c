@@ -0,0 +1,1006 @@
+#include "dict.h"
+#include "bf.h"
+#include "bst.h"
+#include "fuse.h"
+#include "hc.h"
+#include "ht.h"
+#include "stats.h"
+#include "utf8.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAGIC       "BHDICT\0\0"
+#define VERSION     3
+#define ENDIANNESS  0x01020304
+#define ALIGN       64 // Sections start on cache-line boundaries.
+#define NO_NEWSPEAK UINT32_MAX
+#define LOAD_RANGE  (1 << 20) // Least bytes of a word list worth reading on a thread of its own.
+
+// The header of a dictionary snapshot. Sections are located by their offsets from the start of the file, so the
+// snapshot can be mapped at any address and used in place.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order; // Snapshots are only loaded on hosts with the byte order they were written on.
+    uint32_t engine; // HashEngine the digests were computed with.
+    uint32_t hashes; // Bloom filter bits set per key.
+    uint32_t blocked;
+    uint32_t bf_size; // Bloom filter size in bits.
+    uint64_t bf_keys;
+    uint64_t bf_count; // Bits set in the Bloom filter, so they need not be counted when it is mapped.
+    uint32_t ht_size; // Number of buckets.
+    uint32_t entries;
+    uint64_t bits; // Offset of the Bloom filter words.
+    uint64_t buckets; // Offset of ht_size + 1 uint32_t indices of the first entry in each bucket.
+    uint64_t table; // Offset of the entries, in order of id.
+    uint64_t order; // Offset of the indices of the entries, sorted by bucket and then by oldspeak.
+    uint64_t pool; // Offset of the null-terminated strings.
+    uint64_t pool_length;
+    uint64_t length; // Length of the whole snapshot.
+} Header;
+
+// An entry of a dictionary snapshot. The strings are offsets into the pool.
+typedef struct {
+    uint32_t oldspeak;
+    uint32_t newspeak;
+} Record;
+
+struct Dictionary {
+    HashContext *hc;
+    BloomFilter *bf;
+    FuseFilter *fuse; // Probed instead of the Bloom filter once the entries are loaded, or NULL.
+    Prefilter prefilter;
+    HashTable *ht; // NULL when the dictionary is a mapped snapshot.
+    void *map;
+    size_t map_length;
+    uint32_t size; // Number of buckets of the snapshot.
+    uint32_t entries; // Number of entries of the snapshot.
+    const uint32_t *buckets;
+    const Record *table;
+    const uint32_t *order;
+    const char *pool;
+};
+
+// This function is the constructor for an empty dictionary that words are inserted into.
+// This function takes in as parameters the uint32_t size_ht and TableEngine table of the hash table, the uint32_t
+// size_bf, k and bool blocked of the Bloom filter, the HashEngine engine words are hashed with, and the Prefilter
+// dict_load() builds for lookups.
+// This function returns the created Dictionary, or NULL if memory could not be allocated.
+Dictionary *dict_create(uint32_t size_ht, TableEngine table, uint32_t size_bf, uint32_t k, bool blocked,
+    HashEngine engine, Prefilter prefilter) {
+    Dictionary *d = (Dictionary *) calloc(1, sizeof(Dictionary));
+    if (d) {
+        d->prefilter = prefilter;
+        d->hc = hc_create(engine);
+        d->bf = bf_create(size_bf, k, blocked);
+        d->ht = ht_create(size_ht, table);
+        if (!d->hc || !d->bf || !d->ht) {
+            dict_delete(&d);
+        }
+    }
+    return d;
+}
+
+// This function is the destructor for a dictionary.
+// This function takes in as a parameter a double pointer to the Dictionary d.
+void dict_delete(Dictionary **d) {
+    if ((*d)->hc) {
+        hc_delete(&(*d)->hc);
+    }
+    if ((*d)->bf) {
+        bf_delete(&(*d)->bf);
+    }
+    if ((*d)->fuse) {
+        fuse_delete(&(*d)->fuse);
+    }
+    if ((*d)->ht) {
+        ht_delete(&(*d)->ht);
+    }
+    if ((*d)->map) {
+        munmap((*d)->map, (*d)->map_length);
+    }
+    free(*d);
+    *d = NULL;
+}
+
+// This function inserts oldspeak and its newspeak translation into the dictionary.
+// This function takes in as parameters a Dictionary d, a char oldspeak, and a char newspeak which is NULL for
+// badspeak.
+void dict_insert(Dictionary *d, char *oldspeak, char *newspeak) {
+    Digest digest = hc_digest(d->hc, oldspeak, strlen(oldspeak));
+    bf_insert(d->bf, digest);
+    ht_insert(d->ht, oldspeak, newspeak, digest);
+}
+
+// This function is a helper function that joins the whitespace separated words of line with single spaces, in
+// place, so that a phrase is stored the same way however it was spaced.
+// Returns the number of words in line.
+static uint32_t normalize(char *line) {
+    uint32_t words = 0;
+    char *out = line;
+    for (char *in = line; *in != '\0';) {
+        while (isspace((unsigned char) *in)) {
+            in++;
+        }
+        if (*in == '\0') {
+            break;
+        }
+        if (words > 0) {
+            *out++ = ' ';
+        }
+        while (*in != '\0' && !isspace((unsigned char) *in)) {
+            *out++ = *in++;
+        }
+        words = words + 1;
+    }
+    *out = '\0';
+    return words;
+}
+
+// A word list mapped into memory copy on write, so that its lines can be normalized in place.
+typedef struct {
+    char *data;
+    size_t length;
+    size_t body; // Length up to and including the last newline.
+    char *tail; // A copy of the line after the last newline, if any, with room for its terminator.
+} List;
+
+// An entry read from a word list, with the digest of its oldspeak if it was hashed.
+typedef struct {
+    char *oldspeak;
+    char *newspeak;
+    Digest digest;
+    bool owned; // Whether oldspeak was allocated, since folding it made it longer than its line.
+} Pending;
+
+// The lines of a word list that one thread reads, and the entries it reads from them in order.
+typedef struct {
+    pthread_t thread;
+    bool started; // Whether the range is read on a thread of its own rather than the caller's.
+    char *start;
+    char *end; // Every line of the range ends in a newline, except the last which may end at end.
+    bool translations; // Whether each line ends in a newspeak translation.
+    HashContext *hc; // Context to hash the entries with, or NULL to only read them.
+    Pending *entries;
+    uint64_t count;
+    uint64_t capacity;
+    bool failed;
+} Range;
+
+// This function is a helper function that folds the case of oldspeak the way the parser folds the words it looks
+// up, in place unless folding makes it longer, which only U+023A and U+023E do.
+// Returns the folded oldspeak, which is a new string if it is not oldspeak, or NULL if memory could not be
+// allocated.
+static char *fold_oldspeak(char *oldspeak) {
+    size_t length = strlen(oldspeak);
+    if (utf8_is_ascii(oldspeak, length)) {
+        for (char *c = oldspeak; *c != '\0'; c++) {
+            *c = (char) (*c >= 'A' && *c <= 'Z' ? *c | 0x20 : *c);
+        }
+        return oldspeak;
+    }
+    char *folded = (char *) malloc(2 * length + 1);
+    if (folded == NULL) {
+        return NULL;
+    }
+    size_t n = utf8_fold_text(oldspeak, length, folded);
+    folded[n] = '\0';
+    if (n <= length) {
+        memcpy(oldspeak, folded, n + 1);
+        free(folded);
+        return oldspeak;
+    }
+    return folded;
+}
+
+// This function is a helper function that maps the word list at path.
+// Returns false after printing why if the list could not be opened or mapped.
+static bool map_list(const char *path, List *list) {
+    memset(list, 0, sizeof(List));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return false;
+    }
+    list->length = (size_t) st.st_size;
+    if (list->length > 0) {
+        void *map = mmap(NULL, list->length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            perror(path);
+            close(fd);
+            return false;
+        }
+        list->data = (char *) map;
+    }
+    close(fd);
+
+    // Copying the line after the last newline, which the mapping has no room to terminate
+    list->body = list->length;
+    while (list->body > 0 && list->data[list->body - 1] != '\n') {
+        list->body = list->body - 1;
+    }
+    if (list->body < list->length) {
+        list->tail = (char *) malloc(list->length - list->body + 1);
+        if (list->tail == NULL) {
+            fprintf(stderr, "Failed to allocate memory.\n");
+            munmap(list->data, list->length);
+            return false;
+        }
+        memcpy(list->tail, list->data + list->body, list->length - list->body);
+    }
+    return true;
+}
+
+// This function is a helper function that unmaps a word list.
+static void unmap_list(List *list) {
+    if (list->data != NULL) {
+        munmap(list->data, list->length);
+    }
+    free(list->tail);
+}
+
+// This function is a helper function that reads the lines of a range. Each line of a badspeak list is an entry, and
+// each line of a newspeak list is an entry whose last word is the newspeak translation. An entry of several words
+// is a phrase. The lines are terminated and normalized in place, and the oldspeak of entries that are hashed is case
+// folded first, so it is stored the way words are looked up.
+// This function takes in as a parameter a void arg which is the Range to read.
+static void *read_range(void *arg) {
+    Range *r = (Range *) arg;
+    for (char *line = r->start; line < r->end;) {
+        char *end = memchr(line, '\n', (size_t) (r->end - line));
+        end = end != NULL ? end : r->end;
+        *end = '\0';
+        uint32_t words = normalize(line);
+        if (words > (r->translations ? 1 : 0)) {
+            if (r->count == r->capacity) {
+                r->capacity = r->capacity ? 2 * r->capacity : 1024;
+                Pending *grown = (Pending *) realloc(r->entries, r->capacity * sizeof(Pending));
+                if (grown == NULL) {
+                    r->failed = true;
+                    return NULL;
+                }
+                r->entries = grown;
+            }
+            Pending *p = &r->entries[r->count];
+            p->oldspeak = line;
+            p->newspeak = NULL;
+            p->owned = false;
+            if (r->translations) {
+                p->newspeak = strrchr(line, ' ');
+                *p->newspeak++ = '\0';
+            }
+            if (r->hc != NULL) {
+                p->oldspeak = fold_oldspeak(line);
+                if (p->oldspeak == NULL) {
+                    r->failed = true;
+                    return NULL;
+                }
+                p->owned = p->oldspeak != line;
+                p->digest = hc_digest(r->hc, p->oldspeak, strlen(p->oldspeak));
+            }
+            r->count = r->count + 1;
+        }
+        line = end + 1;
+    }
+    return NULL;
+}
+
+// This function is a helper function that splits a word list into at most parts ranges of whole lines, each at
+// least LOAD_RANGE bytes long but the last, and a range for the line after the last newline, if any.
+// Returns the number of ranges added to ranges.
+static uint32_t split_list(List *list, uint32_t parts, bool translations, HashContext *hc, Range *ranges) {
+    uint32_t count = 0;
+    size_t most = list->body / LOAD_RANGE + 1;
+    parts = parts < most ? parts : (uint32_t) most;
+    char *start = list->data;
+    for (uint32_t i = 1; i <= parts && start < list->data + list->body; i++) {
+        char *end = list->data + list->body;
+        if (i < parts) {
+            char *cut = list->data + list->body / parts * i;
+            cut = cut > start ? cut : start;
+            end = (char *) memchr(cut, '\n', (size_t) (end - cut)) + 1;
+        }
+        memset(&ranges[count], 0, sizeof(Range));
+        ranges[count].start = start;
+        ranges[count].end = end;
+        count = count + 1;
+        start = end;
+    }
+    if (list->tail != NULL) {
+        memset(&ranges[count], 0, sizeof(Range));
+        ranges[count].start = list->tail;
+        ranges[count].end = list->tail + (list->length - list->body);
+        count = count + 1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        ranges[i].translations = translations;
+        ranges[i].hc = hc;
+    }
+    return count;
+}
+
+// This function is a helper function that maps a list of badspeak words and a list of oldspeak and newspeak pairs,
+// reads them on up to threads threads, each over its own range of lines and hashing the entries with hc unless it
+// is NULL, and then calls add on each entry in the order of the lists, so the result does not depend on threads.
+// Returns false after printing why if either file could not be read.
+static bool read_lists(const char *badspeak_path, const char *newspeak_path, uint32_t threads, HashContext *hc,
+    void (*add)(Pending *p, void *arg), void *arg) {
+    List lists[2];
+    if (!map_list(badspeak_path, &lists[0])) {
+        return false;
+    }
+    if (!map_list(newspeak_path, &lists[1])) {
+        unmap_list(&lists[0]);
+        return false;
+    }
+    threads = threads > 0 ? threads : 1;
+    Range *ranges = (Range *) calloc(2 * ((size_t) threads + 1), sizeof(Range));
+    if (ranges == NULL) {
+        fprintf(stderr, "Failed to allocate memory.\n");
+        unmap_list(&lists[0]);
+        unmap_list(&lists[1]);
+        return false;
+    }
+    uint32_t count = split_list(&lists[0], threads, false, hc, ranges);
+    count += split_list(&lists[1], threads, true, hc, ranges + count);
+
+    // Reading the ranges, the first on this thread, and any that a thread could not be started for after it
+    for (uint32_t i = 1; i < count; i++) {
+        ranges[i].started = pthread_create(&ranges[i].thread, NULL, read_range, &ranges[i]) == 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (ranges[i].started) {
+            pthread_join(ranges[i].thread, NULL);
+        } else {
+            read_range(&ranges[i]);
+        }
+    }
+
+    bool read = true;
+    for (uint32_t i = 0; i < count; i++) {
+        read = read && !ranges[i].failed;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint64_t e = 0; e < ranges[i].count; e++) {
+            if (read) {
+                add(&ranges[i].entries[e], arg);
+            }
+            if (ranges[i].entries[e].owned) {
+                free(ranges[i].entries[e].oldspeak);
+            }
+        }
+        free(ranges[i].entries);
+    }
+    if (!read) {
+        fprintf(stderr, "Failed to allocate memory.\n");
+    }
+    free(ranges);
+    unmap_list(&lists[0]);
+    unmap_list(&lists[1]);
+    return read;
+}
+
+// This function is a helper function for dict_load() that inserts an entry into the dictionary arg with the digest
+// it was read with.
+static void insert_entry(Pending *p, void *arg) {
+    Dictionary *d = (Dictionary *) arg;
+    bf_insert(d->bf, p->digest);
+    ht_insert(d->ht, p->oldspeak, p->newspeak, p->digest);
+}
+
+// The digests of the entries of a dictionary a binary fuse filter is built over.
+typedef struct {
+    HashContext *hc;
+    Digest *digests;
+    uint32_t count;
+} Keys;
+
+// This function is a helper function for dict_load() that records the digest of a node of the hash table.
+static void gather(Node *n, void *arg) {
+    Keys *k = (Keys *) arg;
+    k->digests[k->count] = hc_digest(k->hc, n->oldspeak, strlen(n->oldspeak));
+    k->count = k->count + 1;
+}
+
+// This function reads a list of badspeak words and a list of oldspeak and newspeak pairs into the dictionary, then
+// freezes its hash table and builds the binary fuse filter the dictionary was created with, if any. Entries
+// inserted after that would not pass the filter. The lists are mapped and split into ranges of lines that are read
+// and hashed on up to threads threads, and the entries are then inserted in the order of the lists, so the
+// dictionary is the same whatever the number of threads. An entry listed again is only kept the first time.
+// Returns false if either file could not be read or the filter could not be built.
+// This function takes in as parameters a Dictionary d, the paths of the badspeak and newspeak files, and the
+// uint32_t number of threads to read them on.
+bool dict_load(Dictionary *d, const char *badspeak_path, const char *newspeak_path, uint32_t threads) {
+    if (!read_lists(badspeak_path, newspeak_path, threads, d->hc, insert_entry, d)) {
+        return false;
+    }
+    ht_freeze(d->ht);
+    if (d->prefilter == PREFILTER_BLOOM) {
+        return true;
+    }
+    uint32_t entries = ht_entries(d->ht);
+    Keys k = { d->hc, (Digest *) malloc(((size_t) entries + 1) * sizeof(Digest)), 0 };
+    if (k.digests != NULL) {
+        ht_walk(d->ht, gather, &k);
+        d->fuse = fuse_create(k.digests, k.count, d->prefilter == PREFILTER_FUSE8 ? 8 : 16);
+        free(k.digests);
+    }
+    if (d->fuse == NULL) {
+        fprintf(stderr, "Failed to build binary fuse filter.\n");
+        return false;
+    }
+    return true;
+}
+
+// This function is a helper function for dict_count() that counts an entry.
+static void tally(Pending *p, void *arg) {
+    (void) p;
+    *(uint64_t *) arg = *(uint64_t *) arg + 1;
+}
+
+// This function counts the entries of a list of badspeak words and a list of oldspeak and newspeak pairs without
+// building a dictionary, so that the dictionary can be sized for them first. An entry listed twice is counted
+// twice.
+// Returns false if either file could not be read.
+// This function takes in as parameters the paths of the badspeak and newspeak files, the uint32_t number of threads
+// to read them on, and a pointer to the uint64_t entries, which is set to the count.
+bool dict_count(const char *badspeak_path, const char *newspeak_path, uint32_t threads, uint64_t *entries) {
+    *entries = 0;
+    return read_lists(badspeak_path, newspeak_path, threads, NULL, tally, entries);
+}
+
+// The entries of a dictionary being compiled, with the bucket each one belongs in.
+typedef struct {
+    Node *node;
+    uint32_t bucket;
+} Sorted;
+
+typedef struct {
+    Dictionary *d;
+    Sorted *sorted;
+    uint32_t count;
+    uint64_t pool_length;
+} Compiler;
+
+// This function is a helper function for dict_compile() that records a node of the hash table.
+static void collect(Node *n, void *arg) {
+    Compiler *c = (Compiler *) arg;
+    Digest digest = hc_digest(c->d->hc, n->oldspeak, strlen(n->oldspeak));
+    c->sorted[c->count].node = n;
+    c->sorted[c->count].bucket = hc_bucket(digest, ht_size(c->d->ht));
+    c->pool_length += strlen(n->oldspeak) + 1 + (n->newspeak ? strlen(n->newspeak) + 1 : 0);
+    c->count = c->count + 1;
+}
+
+// This function is a helper function for dict_compile() that counts a node of the hash table.
+static void count(Node *n, void *arg) {
+    (void) n;
+    *(uint32_t *) arg += 1;
+}
+
+// This function is a helper function for dict_compile() that orders entries by bucket and then by oldspeak.
+static int compare(const void *a, const void *b) {
+    const Sorted *x = (const Sorted *) a;
+    const Sorted *y = (const Sorted *) b;
+    if (x->bucket != y->bucket) {
+        return x->bucket < y->bucket ? -1 : 1;
+    }
+    return strcmp(x->node->oldspeak, y->node->oldspeak);
+}
+
+// This function is a helper function for dict_compile() that pads the file out to the next section boundary.
+static uint64_t pad(FILE *f, uint64_t offset) {
+    static const char zeros[ALIGN] = { 0 };
+    uint64_t padding = (ALIGN - offset % ALIGN) % ALIGN;
+    fwrite(zeros, 1, padding, f);
+    return offset + padding;
+}
+
+// This function writes the dictionary to path as a snapshot that dict_open() can map. The snapshot is written to a
+// temporary file that is renamed over path, so a snapshot being loaded is never seen half written. Returns false
+// if the snapshot could not be written.
+// This function takes in as parameters a Dictionary d built with dict_create() and the char path to write to.
+bool dict_compile(Dictionary *d, const char *path) {
+    if (d->ht == NULL) {
+        fprintf(stderr, "Only a loaded dictionary can be compiled.\n");
+        return false;
+    }
+
+    Compiler c = { d, NULL, 0, 0 };
+    uint32_t entries = 0;
+    ht_walk(d->ht, count, &entries);
+    c.sorted = (Sorted *) malloc((entries ? entries : 1) * sizeof(Sorted));
+    uint32_t *buckets = (uint32_t *) calloc((size_t) ht_size(d->ht) + 1, sizeof(uint32_t));
+    Node **byid = (Node **) malloc((entries ? entries : 1) * sizeof(Node *));
+    if (!c.sorted || !buckets || !byid) {
+        fprintf(stderr, "Failed to compile dictionary.\n");
+        free(c.sorted);
+        free(buckets);
+        free(byid);
+        return false;
+    }
+    ht_walk(d->ht, collect, &c);
+    qsort(c.sorted, entries, sizeof(Sorted), compare);
+    if (c.pool_length >= NO_NEWSPEAK) {
+        fprintf(stderr, "Dictionary is too large to compile.\n");
+        free(c.sorted);
+        free(buckets);
+        free(byid);
+        return false;
+    }
+
+    // Laying out the sections
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(h.magic));
+    h.version = VERSION;
+    h.byte_order = ENDIANNESS;
+    h.engine = hc_engine(d->hc);
+    h.hashes = bf_hashes(d->bf);
+    h.blocked = bf_blocked(d->bf);
+    h.bf_size = bf_size(d->bf);
+    h.bf_keys = bf_keys(d->bf);
+    h.bf_count = bf_count(d->bf);
+    h.ht_size = ht_size(d->ht);
+    h.entries = entries;
+    uint64_t bits_length = ((uint64_t) h.bf_size + BV_BLOCK_BITS - 1) / BV_BLOCK_BITS * (BV_BLOCK_BITS / 8);
+    h.bits = (sizeof(Header) + ALIGN - 1) / ALIGN * ALIGN;
+    h.buckets = (h.bits + bits_length + ALIGN - 1) / ALIGN * ALIGN;
+    h.table = (h.buckets + ((uint64_t) h.ht_size + 1) * sizeof(uint32_t) + ALIGN - 1) / ALIGN * ALIGN;
+    h.order = (h.table + (uint64_t) entries * sizeof(Record) + ALIGN - 1) / ALIGN * ALIGN;
+    h.pool = (h.order + (uint64_t) entries * sizeof(uint32_t) + ALIGN - 1) / ALIGN * ALIGN;
+    h.pool_length = c.pool_length;
+    h.length = h.pool + h.pool_length;
+
+    size_t temp_length = strlen(path) + 5;
+    char *temp = (char *) malloc(temp_length);
+    if (!temp) {
+        free(c.sorted);
+        free(buckets);
+        free(byid);
+        return false;
+    }
+    snprintf(temp, temp_length, "%s.tmp", path);
+    FILE *f = fopen(temp, "wb");
+    if (f == NULL) {
+        perror(temp);
+        free(temp);
+        free(c.sorted);
+        free(buckets);
+        free(byid);
+        return false;
+    }
+
+    // Header and Bloom filter
+    uint64_t offset = fwrite(&h, 1, sizeof(h), f);
+    offset = pad(f, offset);
+    offset += fwrite(bf_words(d->bf), 1, bits_length, f);
+    offset = pad(f, offset);
+
+    // Bucket indices
+    for (uint32_t i = 0; i < entries; i++) {
+        buckets[c.sorted[i].bucket + 1] += 1;
+    }
+    for (uint32_t b = 0; b < h.ht_size; b++) {
+        buckets[b + 1] += buckets[b];
+    }
+    offset += fwrite(buckets, sizeof(uint32_t), (size_t) h.ht_size + 1, f) * sizeof(uint32_t);
+    offset = pad(f, offset);
+
+    // Entries in order of id, so ids are the same as the dictionary's, then the order they are searched in, then
+    // the strings they point to
+    for (uint32_t i = 0; i < entries; i++) {
+        byid[c.sorted[i].node->id] = c.sorted[i].node;
+    }
+    uint32_t string = 0;
+    for (uint32_t i = 0; i < entries; i++) {
+        Node *n = byid[i];
+        Record r;
+        r.oldspeak = string;
+        string += strlen(n->oldspeak) + 1;
+        r.newspeak = n->newspeak ? string : NO_NEWSPEAK;
+        string += n->newspeak ? strlen(n->newspeak) + 1 : 0;
+        offset += fwrite(&r, 1, sizeof(r), f);
+    }
+    offset = pad(f, offset);
+    for (uint32_t i = 0; i < entries; i++) {
+        offset += fwrite(&c.sorted[i].node->id, 1, sizeof(uint32_t), f);
+    }
+    offset = pad(f, offset);
+    for (uint32_t i = 0; i < entries; i++) {
+        Node *n = byid[i];
+        offset += fwrite(n->oldspeak, 1, strlen(n->oldspeak) + 1, f);
+        if (n->newspeak) {
+            offset += fwrite(n->newspeak, 1, strlen(n->newspeak) + 1, f);
+        }
+    }
+
+    bool written = offset == h.length;
+    written = (fclose(f) == 0) && written;
+    if (written && rename(temp, path) != 0) {
+        perror(path);
+        unlink(temp);
+        written = false;
+    } else if (!written) {
+        fprintf(stderr, "Failed to write %s.\n", temp);
+        unlink(temp);
+    }
+    free(temp);
+    free(c.sorted);
+    free(buckets);
+    free(byid);
+    return written;
+}
+
+// This function is a helper function for dict_open() that checks the tables of a snapshot whose header has been
+// checked: the buckets must not decrease, and every index and string offset must be in range, so that no lookup
+// reads outside the mapping however the file was damaged. The Bloom filter and the strings are not read.
+// Returns true if the tables are intact. Otherwise, returns false.
+static bool intact(const Header *h, const char *map) {
+    const uint32_t *buckets = (const uint32_t *) (map + h->buckets);
+    const Record *table = (const Record *) (map + h->table);
+    const uint32_t *order = (const uint32_t *) (map + h->order);
+    for (uint32_t b = 0; b < h->ht_size; b++) {
+        if (buckets[b] > buckets[b + 1]) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < h->entries; i++) {
+        if (order[i] >= h->entries || table[i].oldspeak >= h->pool_length
+            || (table[i].newspeak != NO_NEWSPEAK && table[i].newspeak >= h->pool_length)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// This function maps a snapshot written by dict_compile() read-only and uses it in place, so opening a snapshot
+// takes the same time whatever the size of the dictionary's strings and Bloom filter, and every process that opens
+// it shares the same pages. Only the header and the indices of the table are checked.
+// This function takes in as a parameter the char path of the snapshot.
+// This function returns the Dictionary, or NULL if the snapshot could not be opened.
+Dictionary *dict_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < sizeof(Header)) {
+        fprintf(stderr, "%s is not a dictionary snapshot.\n", path);
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return NULL;
+    }
+
+    const Header *h = (const Header *) map;
+    uint64_t bits_length = ((uint64_t) h->bf_size + BV_BLOCK_BITS - 1) / BV_BLOCK_BITS * (BV_BLOCK_BITS / 8);
+    if (memcmp(h->magic, MAGIC, sizeof(h->magic)) != 0 || h->version != VERSION || h->byte_order != ENDIANNESS
+        || h->length != (uint64_t) st.st_size || h->engine > HASH_FAST || h->hashes == 0 || h->bf_size == 0
+        || h->bf_count > h->bf_size || h->ht_size == 0 || h->bits % ALIGN || h->bits + bits_length > h->length
+        || h->buckets % ALIGN
+        || h->buckets + ((uint64_t) h->ht_size + 1) * sizeof(uint32_t) > h->length || h->table % ALIGN
+        || h->table + (uint64_t) h->entries * sizeof(Record) > h->length || h->order % ALIGN
+        || h->order + (uint64_t) h->entries * sizeof(uint32_t) > h->length || h->pool + h->pool_length != h->length
+        || (h->pool_length && ((const char *) map)[h->length - 1] != '\0')
+        || ((const uint32_t *) ((const char *) map + h->buckets))[h->ht_size] != h->entries
+        || !intact(h, (const char *) map)) {
+        fprintf(stderr, "%s is not a compatible dictionary snapshot.\n", path);
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    Dictionary *d = (Dictionary *) calloc(1, sizeof(Dictionary));
+    if (d) {
+        d->map = map;
+        d->map_length = st.st_size;
+        d->size = h->ht_size;
+        d->entries = h->entries;
+        d->buckets = (const uint32_t *) ((const char *) map + h->buckets);
+        d->table = (const Record *) ((const char *) map + h->table);
+        d->order = (const uint32_t *) ((const char *) map + h->order);
+        d->pool = (const char *) map + h->pool;
+        d->hc = hc_create((HashEngine) h->engine);
+        d->bf = bf_create_view(
+            (const uint64_t *) ((const char *) map + h->bits), h->bf_size, h->hashes, h->blocked, h->bf_keys,
+            (uint32_t) h->bf_count);
+        if (!d->hc || !d->bf) {
+            dict_delete(&d);
+        }
+    } else {
+        munmap(map, st.st_size);
+    }
+    return d;
+}
+
+// This function is a helper function that looks up word in a bucket of a snapshot. The bucket is a sorted array of
+// entry ids, so it is binary searched.
+// Returns true and fills in e if the word is in the snapshot. Otherwise, returns false.
+static bool search(Dictionary *d, char *word, Digest digest, Entry *e) {
+    stats_add(STAT_LOOKUPS, 1);
+    uint32_t steps = 0;
+    uint32_t bucket = hc_bucket(digest, d->size);
+    uint32_t lo = d->buckets[bucket];
+    uint32_t hi = d->buckets[bucket + 1];
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t id = d->order[mid];
+        int order = strcmp(d->pool + d->table[id].oldspeak, word);
+        if (order == 0) {
+            dict_entry(d, id, e);
+            stats_add(STAT_BRANCHES, steps);
+            return true;
+        }
+        if (order > 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+        steps = steps + 1;
+    }
+    stats_add(STAT_BRANCHES, steps);
+    return false;
+}
+
+// This function looks up word in the dictionary. The word is hashed once, and the table is only searched if the
+// binary fuse filter, or else the Bloom filter, says the word may be present. A bucket of a snapshot is a sorted
+// array, so it is binary searched.
+// Returns true and fills in e if the word is in the dictionary. Otherwise, returns false.
+// This function takes in as parameters a Dictionary d, a null-terminated char word, its uint32_t length, and a
+// pointer to the Entry e.
+bool dict_lookup(Dictionary *d, char *word, uint32_t length, Entry *e) {
+    Digest digest = hc_digest(d->hc, word, length);
+    if (d->fuse ? !fuse_probe(d->fuse, digest) : !bf_probe(d->bf, digest)) {
+        stats_add(STAT_BF_NEGATIVES, 1);
+        return false;
+    }
+    stats_add(STAT_BF_POSITIVES, 1);
+
+    if (d->ht) {
+        Node *n = ht_lookup(d->ht, word, length, digest);
+        if (n == NULL) {
+            return false;
+        }
+        e->oldspeak = n->oldspeak;
+        e->newspeak = n->newspeak;
+        e->id = n->id;
+        stats_add(STAT_TABLE_HITS, 1);
+        return true;
+    }
+
+    bool found = search(d, word, digest, e);
+    stats_add(STAT_TABLE_HITS, found);
+    return found;
+}
+
+// This function looks up n words in the dictionary at once, like n calls to dict_lookup(). The words are hashed
+// first, and then probed in the filter and looked up in the table in groups of DICT_BATCH, with the memory
+// each stage reads prefetched for the whole group before it is read, so the cache misses of the words overlap.
+// Returns the number of words found. found[i] is set to whether words[i] is in the dictionary, and if it is, e[i]
+// is filled in.
+// This function takes in as parameters a Dictionary d, the n null-terminated chars words, their uint32_t lengths,
+// the uint32_t n, and the n Entries e and bools found.
+uint32_t dict_lookup_many(Dictionary *d, char **words, const uint32_t *lengths, uint32_t n, Entry *e, bool *found) {
+    uint32_t hits = 0;
+    for (uint32_t base = 0; base < n; base += DICT_BATCH) {
+        uint32_t size = n - base < DICT_BATCH ? n - base : DICT_BATCH;
+        Digest digests[DICT_BATCH];
+        bool present[DICT_BATCH];
+        for (uint32_t i = 0; i < size; i++) {
+            digests[i] = hc_digest(d->hc, words[base + i], lengths[base + i]);
+            found[base + i] = false;
+        }
+        if (d->fuse) {
+            fuse_probe_many(d->fuse, digests, size, present);
+        } else {
+            bf_probe_many(d->bf, digests, size, present);
+        }
+
+        // Gathering the words the filter let through
+        uint32_t candidates = 0;
+        uint32_t index[DICT_BATCH];
+        char *candidate_words[DICT_BATCH];
+        uint32_t candidate_lengths[DICT_BATCH];
+        Digest candidate_digests[DICT_BATCH];
+        for (uint32_t i = 0; i < size; i++) {
+            if (present[i]) {
+                index[candidates] = base + i;
+                candidate_words[candidates] = words[base + i];
+                candidate_lengths[candidates] = lengths[base + i];
+                candidate_digests[candidates] = digests[i];
+                candidates = candidates + 1;
+            }
+        }
+
+        if (d->ht) {
+            Node *nodes[DICT_BATCH];
+            ht_lookup_many(d->ht, candidate_words, candidate_lengths, candidate_digests, candidates, nodes);
+            for (uint32_t c = 0; c < candidates; c++) {
+                if (nodes[c] != NULL) {
+                    e[index[c]].oldspeak = nodes[c]->oldspeak;
+                    e[index[c]].newspeak = nodes[c]->newspeak;
+                    e[index[c]].id = nodes[c]->id;
+                    found[index[c]] = true;
+                }
+            }
+        } else {
+            for (uint32_t c = 0; c < candidates; c++) {
+                __builtin_prefetch(&d->buckets[hc_bucket(candidate_digests[c], d->size)]);
+            }
+            for (uint32_t c = 0; c < candidates; c++) {
+                found[index[c]] = search(d, candidate_words[c], candidate_digests[c], &e[index[c]]);
+            }
+        }
+        for (uint32_t c = 0; c < candidates; c++) {
+            hits = hits + found[index[c]];
+        }
+        stats_add(STAT_BF_NEGATIVES, size - candidates);
+        stats_add(STAT_BF_POSITIVES, candidates);
+    }
+    stats_add(STAT_TABLE_HITS, hits);
+    return hits;
+}
+
+// This function looks up n words that are views into text, like dict_lookup_many(), after case folding copies of
+// them the way the entries were folded when they were loaded. The copies are written to a buffer that grows as
+// needed and is kept by the caller across calls.
+// Returns false if the buffer could not be grown. Otherwise, returns true, with found[i] set to whether words[i] is
+// in the dictionary, and if it is, e[i] filled in.
+// This function takes in as parameters a Dictionary d, the n chars words, their uint32_t lengths, the uint32_t n,
+// which is at most DICT_BATCH, the buffer folded with its size_t capacity, which may start out NULL and 0 and must be
+// freed, and the n Entries e and bools found.
+bool dict_lookup_views(Dictionary *d, const char **words, const uint32_t *lengths, uint32_t n, char **folded,
+    size_t *capacity, Entry *e, bool *found) {
+    char *lower[DICT_BATCH];
+    uint32_t lower_lengths[DICT_BATCH];
+    size_t needed = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        needed += 2 * (size_t) lengths[i] + 1;
+    }
+    if (needed > *capacity) {
+        char *grown = (char *) realloc(*folded, needed);
+        if (grown == NULL) {
+            return false;
+        }
+        *folded = grown;
+        *capacity = needed;
+    }
+    char *at = *folded;
+    for (uint32_t i = 0; i < n; i++) {
+        lower[i] = at;
+        lower_lengths[i] = (uint32_t) utf8_fold_text(words[i], lengths[i], at);
+        at[lower_lengths[i]] = '\0';
+        at += lower_lengths[i] + 1;
+    }
+    dict_lookup_many(d, lower, lower_lengths, n, e, found);
+    return true;
+}
+
+// This function returns the number of entries in the dictionary.
+// This function takes in as a parameter a Dictionary d.
+uint32_t dict_entries(Dictionary *d) {
+    return d->ht ? ht_entries(d->ht) : d->entries;
+}
+
+// This function fills in e with the entry of the dictionary that has the given id. A snapshot keeps the ids the
+// entries had in the dictionary it was compiled from.
+// This function takes in as parameters a Dictionary d, the uint32_t id, which must be less than dict_entries(), and
+// a pointer to the Entry e.
+void dict_entry(Dictionary *d, uint32_t id, Entry *e) {
+    if (d->ht) {
+        Node *n = ht_node(d->ht, id);
+        e->oldspeak = n->oldspeak;
+        e->newspeak = n->newspeak;
+    } else {
+        e->oldspeak = d->pool + d->table[id].oldspeak;
+        e->newspeak = d->table[id].newspeak == NO_NEWSPEAK ? NULL : d->pool + d->table[id].newspeak;
+    }
+    e->id = id;
+}
+
+// The callback and its argument while walking the hash table of a dictionary.
+typedef struct {
+    void (*visit)(const Entry *e, void *arg);
+    void *arg;
+} Walk;
+
+// This function is a helper function that hands a node of the hash table to the visit callback as an Entry.
+static void visit_node(Node *n, void *arg) {
+    Walk *w = (Walk *) arg;
+    Entry e = { n->oldspeak, n->newspeak, n->id };
+    w->visit(&e, w->arg);
+}
+
+// This function calls visit on every entry of the dictionary.
+// This function takes in as parameters a Dictionary d, the function visit, and a void arg which is passed on to
+// visit.
+void dict_walk(Dictionary *d, void (*visit)(const Entry *e, void *arg), void *arg) {
+    if (d->ht) {
+        Walk w = { visit, arg };
+        ht_walk(d->ht, visit_node, &w);
+        return;
+    }
+    for (uint32_t i = 0; i < d->entries; i++) {
+        Entry e;
+        dict_entry(d, i, &e);
+        visit(&e, arg);
+    }
+}
+
+// This function returns the Bloom filter of the dictionary.
+// This function takes in as a parameter a Dictionary d.
+BloomFilter *dict_bf(Dictionary *d) {
+    return d->bf;
+}
+
+// This function returns the binary fuse filter of the dictionary, or NULL if lookups probe the Bloom filter.
+// This function takes in as a parameter a Dictionary d.
+FuseFilter *dict_fuse(Dictionary *d) {
+    return d->fuse;
+}
+
+// This function returns the number of buckets in the dictionary's hash table.
+// This function takes in as a parameter a Dictionary d.
+uint32_t dict_ht_size(Dictionary *d) {
+    return d->ht ? ht_size(d->ht) : d->size;
+}
+
+// This function returns the number of non-empty buckets in the dictionary's hash table.
+// This function takes in as a parameter a Dictionary d.
+uint32_t dict_ht_count(Dictionary *d) {
+    if (d->ht) {
+        return ht_count(d->ht);
+    }
+    uint32_t count = 0;
+    for (uint32_t b = 0; b < d->size; b++) {
+        count = count + (d->buckets[b + 1] > d->buckets[b]);
+    }
+    return count;
+}
+
+// This function returns the average binary search tree size. A bucket of a snapshot counts as a tree that holds
+// its entries.
+// This function takes in as a parameter a Dictionary d.
+double dict_avg_bst_size(Dictionary *d) {
+    if (d->ht) {
+        return ht_avg_bst_size(d->ht);
+    }
+    return (double) d->entries / dict_ht_count(d);
+}
+
+// This function returns the average binary search tree height. A bucket of a snapshot is binary searched, so it
+// counts as a balanced tree.
+// This function takes in as a parameter a Dictionary d.
+double dict_avg_bst_height(Dictionary *d) {
+    if (d->ht) {
+        return ht_avg_bst_height(d->ht);
+    }
+    uint64_t combined_heights = 0;
+    for (uint32_t b = 0; b < d->size; b++) {
+        for (uint32_t n = d->buckets[b + 1] - d->buckets[b]; n > 0; n /= 2) {
+            combined_heights = combined_heights + 1;
+        }
+    }
+    return (double) combined_heights / dict_ht_count(d);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "bf.h"
+#include "fuse.h"
+#include "hc.h"
+#include "ht.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DICT_BATCH 16 // Words dict_lookup_many() looks up together.
+
+typedef struct Dictionary Dictionary;
+
+// The filter words are ruled out with before the table is searched. A Bloom filter is always built, since snapshots
+// keep it; the binary fuse filters are built over the entries once they are loaded and replace it on lookups.
+typedef enum { PREFILTER_BLOOM, PREFILTER_FUSE8, PREFILTER_FUSE16 } Prefilter;
+
+// A view of a dictionary entry. newspeak is NULL for badspeak. Entries are numbered by a dense id from 0 up to
+// dict_entries().
+typedef struct {
+    const char *oldspeak;
+    const char *newspeak;
+    uint32_t id;
+} Entry;
+
+Dictionary *dict_create(uint32_t size_ht, TableEngine table, uint32_t size_bf, uint32_t k, bool blocked,
+    HashEngine engine, Prefilter prefilter);
+
+Dictionary *dict_open(const char *path);
+
+void dict_delete(Dictionary **d);
+
+bool dict_load(Dictionary *d, const char *badspeak, const char *newspeak, uint32_t threads);
+
+bool dict_count(const char *badspeak, const char *newspeak, uint32_t threads, uint64_t *entries);
+
+void dict_insert(Dictionary *d, char *oldspeak, char *newspeak);
+
+bool dict_compile(Dictionary *d, const char *path);
+
+bool dict_lookup(Dictionary *d, char *word, uint32_t length, Entry *e);
+
+uint32_t dict_lookup_many(Dictionary *d, char **words, const uint32_t *lengths, uint32_t n, Entry *e, bool *found);
+
+bool dict_lookup_views(Dictionary *d, const char **words, const uint32_t *lengths, uint32_t n, char **folded,
+    size_t *capacity, Entry *e, bool *found);
+
+uint32_t dict_entries(Dictionary *d);
+
+void dict_entry(Dictionary *d, uint32_t id, Entry *e);
+
+void dict_walk(Dictionary *d, void (*visit)(const Entry *e, void *arg), void *arg);
+
+BloomFilter *dict_bf(Dictionary *d);
+
+FuseFilter *dict_fuse(Dictionary *d);
+
+uint32_t dict_ht_size(Dictionary *d);
+
+uint32_t dict_ht_count(Dictionary *d);
+
+double dict_avg_bst_size(Dictionary *d);
+
+double dict_avg_bst_height(Dictionary *d);
@@ -0,0 +1,100 @@
+#include "epoch.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+// The epoch a reader entered in, or 0 while the reader holds nothing. Each reader gets a cache line of its own so
+// that readers entering and exiting do not slow each other down.
+typedef struct {
+    _Alignas(64) _Atomic uint64_t entered;
+} Slot;
+
+struct Epoch {
+    _Atomic(void *) current; // The published pointer.
+    _Atomic uint64_t epoch; // Advanced each time a pointer is published.
+    uint32_t readers;
+    Slot *slots;
+    pthread_mutex_t lock; // Serializes publishers.
+};
+
+// This function is the constructor for an epoch, which publishes a pointer that a fixed set of reader threads read
+// while a publisher replaces it, RCU style. Readers never wait: entering and exiting are a few atomic loads and
+// stores. A publisher swaps the pointer atomically and then waits until no reader can still be using the old one.
+// This function takes in as parameters the void initial pointer to publish, and a uint32_t readers which is the
+// number of reader threads. Reader i passes i to epoch_enter() and epoch_exit().
+// This function returns the created Epoch, or NULL if memory could not be allocated.
+Epoch *epoch_create(void *initial, uint32_t readers) {
+    Epoch *e = (Epoch *) malloc(sizeof(Epoch));
+    if (e) {
+        atomic_init(&e->current, initial);
+        atomic_init(&e->epoch, 1);
+        e->readers = readers;
+        e->slots = (Slot *) aligned_alloc(_Alignof(Slot), (size_t) (readers ? readers : 1) * sizeof(Slot));
+        if (!e->slots) {
+            free(e);
+            return NULL;
+        }
+        for (uint32_t i = 0; i < readers; i++) {
+            atomic_init(&e->slots[i].entered, 0);
+        }
+        pthread_mutex_init(&e->lock, NULL);
+    }
+    return e;
+}
+
+// This function is the destructor for an epoch. The published pointer is not freed.
+// This function takes in as a parameter a double pointer to the Epoch e.
+void epoch_delete(Epoch **e) {
+    pthread_mutex_destroy(&(*e)->lock);
+    free((*e)->slots);
+    free(*e);
+    *e = NULL;
+}
+
+// This function returns the published pointer and holds it for the reader until epoch_exit(). A pointer replaced
+// while the reader holds it is not handed back by epoch_publish() until the reader exits.
+// The reader records the epoch before it loads the pointer. A publisher that has swapped the pointer and then
+// finds the reader entered before its new epoch cannot tell which pointer the reader loaded, so it waits; one that
+// finds the reader not entered knows any later load returns the new pointer.
+// This function takes in as parameters the Epoch e and the uint32_t index of the reader.
+void *epoch_enter(Epoch *e, uint32_t reader) {
+    atomic_store(&e->slots[reader].entered, atomic_load(&e->epoch));
+    return atomic_load(&e->current);
+}
+
+// This function releases the pointer the reader got from epoch_enter().
+// This function takes in as parameters the Epoch e and the uint32_t index of the reader.
+void epoch_exit(Epoch *e, uint32_t reader) {
+    atomic_store_explicit(&e->slots[reader].entered, 0, memory_order_release);
+}
+
+// This function returns the published pointer without holding it. It is for the owner of the epoch once no
+// publisher is running, such as to free the last pointer published.
+// This function takes in as a parameter an Epoch e.
+void *epoch_current(Epoch *e) {
+    return atomic_load(&e->current);
+}
+
+// This function publishes next in place of the current pointer. Readers that enter from now on get next. It then
+// waits for every reader that entered before the swap to exit, so the old pointer it returns is no longer in use
+// and can be freed. Only the publisher waits; readers keep going throughout.
+// This function takes in as parameters the Epoch e and the void pointer next.
+// This function returns the pointer that was replaced.
+void *epoch_publish(Epoch *e, void *next) {
+    pthread_mutex_lock(&e->lock);
+    void *old = atomic_exchange(&e->current, next);
+    uint64_t epoch = atomic_fetch_add(&e->epoch, 1) + 1;
+    struct timespec pause = { 0, 1000000 };
+    for (uint32_t i = 0; i < e->readers; i++) {
+        uint64_t entered = atomic_load(&e->slots[i].entered);
+        while (entered != 0 && entered < epoch) {
+            nanosleep(&pause, NULL);
+            entered = atomic_load(&e->slots[i].entered);
+        }
+    }
+    pthread_mutex_unlock(&e->lock);
+    return old;
+}
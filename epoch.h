@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef struct Epoch Epoch;
+
+Epoch *epoch_create(void *initial, uint32_t readers);
+
+void epoch_delete(Epoch **e);
+
+void *epoch_enter(Epoch *e, uint32_t reader);
+
+void epoch_exit(Epoch *e, uint32_t reader);
+
+void *epoch_current(Epoch *e);
+
+void *epoch_publish(Epoch *e, void *next);
@@ -0,0 +1,99 @@
+#include "frame.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// A frame is the length of its payload as a 32-bit big-endian integer followed by the payload. Requests carry text
+// to filter and responses carry what banhammer would print for it.
+
+// This function returns the payload length held in the header of a frame.
+// This function takes in as a parameter the FRAME_HEADER bytes of the header.
+uint32_t frame_length(const unsigned char header[FRAME_HEADER]) {
+    uint32_t length;
+    memcpy(&length, header, FRAME_HEADER);
+    return ntohl(length);
+}
+
+// This function is a helper function that writes all length bytes of data to the socket fd. If the socket is
+// non-blocking and full, it waits until it can be written to, but for no more than FRAME_WAIT milliseconds at a
+// time, so a peer that stops reading cannot hold up the sender for good.
+// Returns false if the socket was closed, failed or stayed full. Otherwise, returns true.
+static bool send_all(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            struct pollfd p = { fd, POLLOUT, 0 };
+            if ((errno != EAGAIN && errno != EWOULDBLOCK) || poll(&p, 1, FRAME_WAIT) <= 0) {
+                return false;
+            }
+            continue;
+        }
+        data += sent;
+        length -= (size_t) sent;
+    }
+    return true;
+}
+
+// This function sends length bytes of data as a frame over the socket fd.
+// Returns false if the socket was closed, failed or stayed full for FRAME_WAIT milliseconds. Otherwise, returns true.
+// This function takes in as parameters the int fd of the socket, the chars data, and their uint32_t length.
+bool frame_send(int fd, const char *data, uint32_t length) {
+    uint32_t header = htonl(length);
+    return send_all(fd, (const char *) &header, FRAME_HEADER) && send_all(fd, data, length);
+}
+
+// This function is a helper function that reads exactly length bytes from the blocking socket fd into data.
+// Returns false if the socket was closed or failed first. Otherwise, returns true.
+static bool recv_all(int fd, char *data, size_t length) {
+    while (length > 0) {
+        ssize_t got = recv(fd, data, length, 0);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        data += got;
+        length -= (size_t) got;
+    }
+    return true;
+}
+
+// This function receives a frame from the blocking socket fd. The payload is read into a buffer that grows as
+// needed and is null terminated.
+// Returns false if the socket was closed or failed, or the frame is larger than FRAME_MAX. Otherwise, returns true.
+// This function takes in as parameters the int fd of the socket, the buffer data with its size_t capacity, which
+// may start out NULL and 0 and must be freed, and the uint32_t length which is set to the payload length.
+bool frame_recv(int fd, char **data, uint32_t *length, size_t *capacity) {
+    unsigned char header[FRAME_HEADER];
+    if (!recv_all(fd, (char *) header, FRAME_HEADER)) {
+        return false;
+    }
+    *length = frame_length(header);
+    if (*length > FRAME_MAX) {
+        return false;
+    }
+    if ((size_t) *length + 1 > *capacity) {
+        char *grown = (char *) realloc(*data, (size_t) *length + 1);
+        if (grown == NULL) {
+            return false;
+        }
+        *data = grown;
+        *capacity = (size_t) *length + 1;
+    }
+    if (!recv_all(fd, *data, *length)) {
+        return false;
+    }
+    (*data)[*length] = '\0';
+    return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FRAME_HEADER 4 // Bytes of the length that starts a frame.
+#define FRAME_MAX    (1 << 26) // Largest payload accepted.
+#define FRAME_WAIT   5000 // Milliseconds a full non-blocking socket is waited on before the send fails.
+
+uint32_t frame_length(const unsigned char header[FRAME_HEADER]);
+
+bool frame_send(int fd, const char *data, uint32_t length);
+
+bool frame_recv(int fd, char **data, uint32_t *length, size_t *capacity);
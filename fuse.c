@@ -0,0 +1,344 @@
+#include "fuse.h"
+#include "hc.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARITY          3 // Slots a key is spread over.
+#define MAX_SEGMENT    262144 // Largest segment length, in slots.
+#define MAX_ATTEMPTS   100 // Seeds tried before giving up on building the filter.
+#define SEED_SEQUENCE  0x726b2b9d438b9d4d // Start of the sequence seeds are drawn from, so builds are reproducible.
+
+// A binary fuse filter (Graf and Lemire, 2022). The slots are split into segments, and a key is hashed to one slot
+// in each of three consecutive segments. Each slot holds a fingerprint, and the fingerprints are chosen when the
+// filter is built so that the three of every key XOR to the key's own fingerprint. A probe reads exactly three
+// slots, and a key that was not inserted passes with a probability of 2^-bits. The filter cannot be added to after
+// it is built.
+struct FuseFilter {
+    uint64_t seed;
+    uint32_t bits; // Bits per fingerprint, 8 or 16.
+    uint32_t keys; // Number of distinct keys the filter was built over.
+    uint32_t size; // Number of slots.
+    uint32_t segment_length;
+    uint32_t segment_count_length; // Number of slots the first of a key's three slots can fall in.
+    uint8_t *fingerprints8; // The slots when bits is 8, or NULL.
+    uint16_t *fingerprints16; // The slots when bits is 16, or NULL.
+};
+
+// This function is a helper function that mixes 64 bits (the MurmurHash3 finalizer).
+static inline uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccd;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53;
+    x ^= x >> 33;
+    return x;
+}
+
+// This function is a helper function that draws the next seed from the sequence at state (SplitMix64).
+static uint64_t next_seed(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+// This function is a helper function that folds a digest into the 64-bit key the filter is built over.
+static inline uint64_t key_of(Digest d) {
+    return d.lo ^ d.hi;
+}
+
+// This function is a helper function that returns the fingerprint of a hash, before it is cut down to bits.
+static inline uint32_t fingerprint(uint64_t hash) {
+    return (uint32_t) (hash ^ (hash >> 32));
+}
+
+// This function is a helper function that finds the three slots of a hash. The first slot is picked from the
+// segments the high bits of the hash fall in, and the other two lie one and two segments further on, at offsets
+// within their segments taken from the low bits.
+static inline void slots_of(FuseFilter *f, uint64_t hash, uint32_t h[ARITY]) {
+    uint32_t mask = f->segment_length - 1;
+    uint32_t h0 = (uint32_t) (((hash >> 32) * f->segment_count_length) >> 32);
+    h[0] = h0;
+    h[1] = (h0 + f->segment_length) ^ (uint32_t) ((hash >> 18) & mask);
+    h[2] = (h0 + 2 * f->segment_length) ^ (uint32_t) (hash & mask);
+}
+
+// This function is a helper function that orders keys from smallest to largest.
+static int compare_key(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+// This function is a helper function that sets slot i to value.
+static inline void set_slot(FuseFilter *f, uint32_t i, uint32_t value) {
+    if (f->bits == 8) {
+        f->fingerprints8[i] = (uint8_t) value;
+    } else {
+        f->fingerprints16[i] = (uint16_t) value;
+    }
+}
+
+// This function is a helper function that returns the fingerprint in slot i.
+static inline uint32_t get_slot(FuseFilter *f, uint32_t i) {
+    return f->bits == 8 ? f->fingerprints8[i] : f->fingerprints16[i];
+}
+
+// This function is a helper function that builds the fingerprints of f over its n distinct keys. Keys are hashed
+// into the slots, then peeled: a slot only one key still maps to is set last for that key, which frees the key's
+// other two slots to be peeled in turn. If every key peels, the fingerprints are assigned in the reverse order of
+// the peeling. Otherwise, another seed is tried.
+// Returns false if memory could not be allocated or no seed of MAX_ATTEMPTS let every key peel.
+static bool populate(FuseFilter *f, const uint64_t *keys, uint32_t n) {
+    uint32_t block_bits = 1;
+    while ((UINT32_C(1) << block_bits) < f->segment_count_length / f->segment_length) {
+        block_bits = block_bits + 1;
+    }
+    uint32_t blocks = UINT32_C(1) << block_bits;
+    uint64_t *order = (uint64_t *) calloc((size_t) n + 1, sizeof(uint64_t));
+    uint8_t *peeled_slot = (uint8_t *) malloc((size_t) n + 1);
+    uint32_t *alone = (uint32_t *) malloc((size_t) f->size * sizeof(uint32_t));
+    uint8_t *counts = (uint8_t *) calloc(f->size, 1);
+    uint64_t *hashes = (uint64_t *) calloc(f->size, sizeof(uint64_t));
+    uint32_t *starts = (uint32_t *) malloc((size_t) blocks * sizeof(uint32_t));
+    bool built = order && peeled_slot && alone && counts && hashes && starts;
+
+    uint64_t state = SEED_SEQUENCE;
+    uint32_t peeled = 0;
+    for (uint32_t attempt = 0; built && attempt < MAX_ATTEMPTS; attempt++) {
+        f->seed = next_seed(&state);
+        memset(order, 0, (size_t) n * sizeof(uint64_t));
+        memset(counts, 0, f->size);
+        memset(hashes, 0, (size_t) f->size * sizeof(uint64_t));
+        order[n] = 1; // Never empty, so that placing a key does not run past the end.
+
+        // Placing the hashes roughly sorted by their first slot, so the slots are updated in order
+        for (uint32_t b = 0; b < blocks; b++) {
+            starts[b] = (uint32_t) (((uint64_t) b * n) >> block_bits);
+        }
+        bool empty = false;
+        for (uint32_t i = 0; i < n; i++) {
+            uint64_t hash = mix(keys[i] + f->seed);
+            empty = empty || hash == 0;
+            uint64_t b = hash >> (64 - block_bits);
+            while (order[starts[b]] != 0) {
+                b = (b + 1) & (blocks - 1);
+            }
+            order[starts[b]] = hash;
+            starts[b] = starts[b] + 1;
+        }
+
+        if (empty) {
+            continue; // A hash of 0 would be taken for a free place and overwritten.
+        }
+
+        // Counting the keys of each slot, and the slot's index among the key's three in the low two bits, and
+        // XORing their hashes, so the last key left in a slot can be read off
+        bool overflow = false;
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t h[ARITY];
+            slots_of(f, order[i], h);
+            for (uint32_t j = 0; j < ARITY; j++) {
+                counts[h[j]] = (uint8_t) ((counts[h[j]] + 4) ^ j);
+                hashes[h[j]] ^= order[i];
+                overflow = overflow || counts[h[j]] < 4;
+            }
+        }
+        if (overflow) {
+            continue;
+        }
+
+        // Peeling the keys alone in a slot
+        uint32_t queued = 0;
+        for (uint32_t i = 0; i < f->size; i++) {
+            alone[queued] = i;
+            queued = queued + ((counts[i] >> 2) == 1);
+        }
+        peeled = 0;
+        while (queued > 0) {
+            queued = queued - 1;
+            uint32_t index = alone[queued];
+            if ((counts[index] >> 2) != 1) {
+                continue;
+            }
+            uint64_t hash = hashes[index];
+            uint32_t found = counts[index] & 3;
+            uint32_t h[ARITY];
+            slots_of(f, hash, h);
+            peeled_slot[peeled] = (uint8_t) found;
+            order[peeled] = hash;
+            peeled = peeled + 1;
+            for (uint32_t j = 0; j < ARITY; j++) {
+                if (j != found) {
+                    alone[queued] = h[j];
+                    queued = queued + ((counts[h[j]] >> 2) == 2);
+                    counts[h[j]] = (uint8_t) ((counts[h[j]] - 4) ^ j);
+                    hashes[h[j]] ^= hash;
+                }
+            }
+        }
+        if (peeled == n) {
+            break;
+        }
+    }
+    built = built && peeled == n;
+
+    // Assigning the fingerprints, each key to the slot it was peeled from, which no key peeled before it uses
+    for (uint32_t i = n; built && i > 0; i--) {
+        uint64_t hash = order[i - 1];
+        uint32_t h[ARITY];
+        slots_of(f, hash, h);
+        uint32_t found = peeled_slot[i - 1];
+        uint32_t value = fingerprint(hash);
+        for (uint32_t j = 0; j < ARITY; j++) {
+            value ^= j != found ? get_slot(f, h[j]) : 0;
+        }
+        set_slot(f, h[found], value);
+    }
+    free(order);
+    free(peeled_slot);
+    free(alone);
+    free(counts);
+    free(hashes);
+    free(starts);
+    return built;
+}
+
+// This function is the constructor for a binary fuse filter over n keys. Keys given more than once are only
+// inserted once. About 1.125 slots are used per key for large n, and more for small n, where the segments are
+// shorter.
+// This function takes in as parameters the Digests keys, the uint32_t number n of them, and the uint32_t bits per
+// fingerprint, which must be 8 or 16.
+// This function returns the created FuseFilter, or NULL if memory could not be allocated or the filter could not be
+// built.
+FuseFilter *fuse_create(const Digest *keys, uint32_t n, uint32_t bits) {
+    if (bits != 8 && bits != 16) {
+        return NULL;
+    }
+    uint64_t *distinct = (uint64_t *) malloc(((size_t) n + 1) * sizeof(uint64_t));
+    FuseFilter *f = (FuseFilter *) calloc(1, sizeof(FuseFilter));
+    if (!distinct || !f) {
+        free(distinct);
+        free(f);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        distinct[i] = key_of(keys[i]);
+    }
+    qsort(distinct, n, sizeof(uint64_t), compare_key);
+    uint32_t unique = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (unique == 0 || distinct[i] != distinct[unique - 1]) {
+            distinct[unique++] = distinct[i];
+        }
+    }
+
+    // Sizing the segments, which are longer and fewer slots per key are needed the more keys there are
+    f->bits = bits;
+    f->keys = unique;
+    uint32_t length = unique == 0 ? 4 : UINT32_C(1) << (int) floor(log((double) unique) / log(3.33) + 2.25);
+    f->segment_length = length < MAX_SEGMENT ? length : MAX_SEGMENT;
+    double factor = unique <= 1 ? 0.0 : fmax(1.125, 0.875 + 0.25 * log(1000000.0) / log((double) unique));
+    uint64_t capacity = (uint64_t) round((double) unique * factor);
+    uint64_t segments = (capacity + f->segment_length - 1) / f->segment_length;
+    segments = segments <= ARITY - 1 ? 1 : segments - (ARITY - 1);
+    uint64_t size = (segments + ARITY - 1) * f->segment_length;
+    if (size > UINT32_MAX) {
+        free(distinct);
+        free(f);
+        return NULL;
+    }
+    f->size = (uint32_t) size;
+    f->segment_count_length = (uint32_t) (segments * f->segment_length);
+
+    if (bits == 8) {
+        f->fingerprints8 = (uint8_t *) calloc(f->size, sizeof(uint8_t));
+    } else {
+        f->fingerprints16 = (uint16_t *) calloc(f->size, sizeof(uint16_t));
+    }
+    if ((!f->fingerprints8 && !f->fingerprints16) || !populate(f, distinct, unique)) {
+        fuse_delete(&f);
+    }
+    free(distinct);
+    return f;
+}
+
+// This function is the destructor for a binary fuse filter.
+// This function takes in as a parameter a double pointer to the FuseFilter f.
+void fuse_delete(FuseFilter **f) {
+    free((*f)->fingerprints8);
+    free((*f)->fingerprints16);
+    free(*f);
+    *f = NULL;
+}
+
+// This function returns the number of slots of the filter.
+// This function takes in as a parameter a FuseFilter f.
+uint32_t fuse_size(FuseFilter *f) {
+    return f->size;
+}
+
+// This function returns the number of bits per fingerprint.
+// This function takes in as a parameter a FuseFilter f.
+uint32_t fuse_bits(FuseFilter *f) {
+    return f->bits;
+}
+
+// This function returns the number of distinct keys the filter was built over.
+// This function takes in as a parameter a FuseFilter f.
+uint32_t fuse_keys(FuseFilter *f) {
+    return f->keys;
+}
+
+// This function returns the number of bits of the filter per key it was built over.
+// This function takes in as a parameter a FuseFilter f.
+double fuse_bits_per_key(FuseFilter *f) {
+    return f->keys > 0 ? (double) f->size * f->bits / f->keys : 0.0;
+}
+
+// This function returns the theoretical false positive rate of the filter, 2^-bits whatever the number of keys.
+// This function takes in as a parameter a FuseFilter f.
+double fuse_fpr(FuseFilter *f) {
+    return ldexp(1.0, -(int) f->bits);
+}
+
+// This function probes the filter for a key. It returns true if the key was most likely one the filter was built
+// over, and always does if it was. Else, it returns false.
+// This function takes in as parameters a FuseFilter f and the Digest d of the key.
+bool fuse_probe(FuseFilter *f, Digest d) {
+    uint64_t hash = mix(key_of(d) + f->seed);
+    uint32_t h[ARITY];
+    slots_of(f, hash, h);
+    if (f->bits == 8) {
+        return (uint8_t) (fingerprint(hash) ^ f->fingerprints8[h[0]] ^ f->fingerprints8[h[1]] ^ f->fingerprints8[h[2]])
+            == 0;
+    }
+    return (uint16_t) (fingerprint(hash) ^ f->fingerprints16[h[0]] ^ f->fingerprints16[h[1]]
+               ^ f->fingerprints16[h[2]])
+        == 0;
+}
+
+// This function probes the filter for n keys at once. The three slots of every key are prefetched before any key
+// is tested, so the cache misses of the keys overlap instead of following one another.
+// This function takes in as parameters a FuseFilter f, the Digests d of the n keys, the uint32_t n, and the n bools
+// present which are set to what fuse_probe() would return for each key.
+void fuse_probe_many(FuseFilter *f, const Digest *d, uint32_t n, bool *present) {
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t h[ARITY];
+        slots_of(f, mix(key_of(d[i]) + f->seed), h);
+        for (uint32_t j = 0; j < ARITY; j++) {
+            if (f->bits == 8) {
+                __builtin_prefetch(&f->fingerprints8[h[j]]);
+            } else {
+                __builtin_prefetch(&f->fingerprints16[h[j]]);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        present[i] = fuse_probe(f, d[i]);
+    }
+}
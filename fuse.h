@@ -0,0 +1,26 @@
+#pragma once
+
+#include "hc.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct FuseFilter FuseFilter;
+
+FuseFilter *fuse_create(const Digest *keys, uint32_t n, uint32_t bits);
+
+void fuse_delete(FuseFilter **f);
+
+uint32_t fuse_size(FuseFilter *f);
+
+uint32_t fuse_bits(FuseFilter *f);
+
+uint32_t fuse_keys(FuseFilter *f);
+
+double fuse_bits_per_key(FuseFilter *f);
+
+double fuse_fpr(FuseFilter *f);
+
+bool fuse_probe(FuseFilter *f, Digest d);
+
+void fuse_probe_many(FuseFilter *f, const Digest *d, uint32_t n, bool *present);
@@ -0,0 +1,123 @@
+#include "hc.h"
+#include "salts.h"
+#include "speck.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Constants from Wang Yi's wyhash, used by the fast engine.
+#define WY_P0 0xa0761d6478bd642f
+#define WY_P1 0xe7037ed1a0b428db
+#define WY_P2 0x8ebc6af09c88c6e3
+#define WY_P3 0x589965cc75374cc3
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+struct HashContext {
+    HashEngine engine;
+    uint64_t round_keys[SPECK_ROUNDS]; // Expanded primary salt for the SPECK engine.
+    uint64_t seed[2]; // Seeds for the fast engine.
+};
+
+// This function is the constructor for a hash context. The SPECK key schedule is run once here so that hashing a
+// token only pays for the block encryptions.
+// This function takes in as a parameter the HashEngine engine that digests are computed with.
+// This function returns the created HashContext, or NULL if memory could not be allocated.
+HashContext *hc_create(HashEngine engine) {
+    HashContext *hc = (HashContext *) malloc(sizeof(HashContext));
+    if (hc) {
+        uint64_t salt[2] = { SALT_PRIMARY_LO, SALT_PRIMARY_HI };
+        hc->engine = engine;
+        speck_expand_key(salt, hc->round_keys);
+        hc->seed[0] = SALT_PRIMARY_LO ^ SALT_HASHTABLE_LO;
+        hc->seed[1] = SALT_PRIMARY_HI ^ SALT_HASHTABLE_HI;
+    }
+    return hc;
+}
+
+// This function is the destructor for a hash context.
+// This function takes in as a parameter a double pointer to the HashContext hc.
+void hc_delete(HashContext **hc) {
+    free(*hc);
+    *hc = NULL;
+}
+
+// This function returns the engine that a hash context computes digests with.
+// This function takes in as a parameter a HashContext hc.
+HashEngine hc_engine(HashContext *hc) {
+    return hc->engine;
+}
+
+// This function returns the printable name of a hash engine.
+// This function takes in as a parameter a HashEngine engine.
+const char *hc_engine_name(HashEngine engine) {
+    return engine == HASH_FAST ? "fast" : "speck";
+}
+
+// Multiplies a and b and folds the 128-bit product into 64 bits.
+static inline uint64_t mum(uint64_t a, uint64_t b) {
+    uint128_t r = (uint128_t) a * b;
+    return (uint64_t) r ^ (uint64_t) (r >> 64);
+}
+
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// A keyed wyhash-style hash. It is not cryptographic, but it mixes well enough for a Bloom filter and a hash table
+// and costs a handful of multiplies per token.
+static uint64_t fast_hash(const char *key, uint32_t length, uint64_t seed) {
+    const uint8_t *p = (const uint8_t *) key;
+    uint64_t a, b;
+
+    seed ^= mum(seed ^ WY_P0, WY_P1);
+    if (length <= 16) {
+        if (length >= 4) {
+            a = (read32(p) << 32) | read32(p + ((length >> 3) << 2));
+            b = (read32(p + length - 4) << 32) | read32(p + length - 4 - ((length >> 3) << 2));
+        } else if (length > 0) {
+            a = ((uint64_t) p[0] << 16) | ((uint64_t) p[length >> 1] << 8) | p[length - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        uint32_t i = length;
+        while (i > 16) {
+            seed = mum(read64(p) ^ WY_P1, read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+
+    uint128_t r = (uint128_t) (a ^ WY_P1) * (b ^ seed);
+    return mum((uint64_t) r ^ WY_P0 ^ length, (uint64_t) (r >> 64) ^ WY_P1);
+}
+
+// This function computes the digest of length bytes of key. This is the only hash computed per token; the Bloom
+// filter indices and the hash table bucket are all derived from it.
+// This function takes in as parameters a HashContext hc, a char key, and its uint32_t length.
+Digest hc_digest(HashContext *hc, const char *key, uint32_t length) {
+    Digest d;
+    if (hc->engine == HASH_FAST) {
+        d.lo = fast_hash(key, length, hc->seed[0]);
+        d.hi = mum(d.lo ^ WY_P2, hc->seed[1] ^ WY_P3);
+    } else {
+        uint64_t digest[2];
+        speck_keyed_hash(key, length, hc->round_keys, digest);
+        d.lo = digest[0];
+        d.hi = digest[1];
+    }
+    return d;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef enum { HASH_SPECK, HASH_FAST } HashEngine;
+
+// A 128-bit token digest. Every Bloom filter index and the hash table bucket are derived from it.
+typedef struct {
+    uint64_t lo;
+    uint64_t hi;
+} Digest;
+
+typedef struct HashContext HashContext;
+
+HashContext *hc_create(HashEngine engine);
+
+void hc_delete(HashContext **hc);
+
+HashEngine hc_engine(HashContext *hc);
+
+const char *hc_engine_name(HashEngine engine);
+
+Digest hc_digest(HashContext *hc, const char *key, uint32_t length);
+
+// Returns the ith index in [0, size) derived from a digest through double hashing.
+static inline uint32_t hc_index(Digest d, uint32_t i, uint32_t size) {
+    return (uint32_t) ((d.lo + i * (d.hi | 1)) % size);
+}
+
+// Returns the hash table bucket in [0, size) for a digest.
+static inline uint32_t hc_bucket(Digest d, uint32_t size) {
+    return (uint32_t) ((d.hi ^ (d.lo >> 32)) % size);
+}
@@ -0,0 +1,91 @@
+#include "hs.h"
+#include "bv.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// A set of dictionary entry ids. A bit vector over every id answers membership with one bit test, and the ids in
+// the set are also kept in the order they were first inserted, so the size is known without counting and clearing
+// the set only touches the ids it holds.
+struct HitSet {
+    BitVector *seen;
+    uint32_t *ids;
+    uint32_t size;
+    uint32_t capacity;
+};
+
+// This function is the constructor for an empty set of ids.
+// This function takes in as a parameter the uint32_t universe, which is one more than the largest id the set holds.
+// This function returns the created HitSet, or NULL if memory could not be allocated.
+HitSet *hs_create(uint32_t universe) {
+    HitSet *hs = (HitSet *) calloc(1, sizeof(HitSet));
+    if (hs) {
+        hs->seen = bv_create(universe > 0 ? universe : 1);
+        if (!hs->seen) {
+            free(hs);
+            return NULL;
+        }
+    }
+    return hs;
+}
+
+// This function is the destructor for a set of ids.
+// This function takes in as a parameter a double pointer to the HitSet hs.
+void hs_delete(HitSet **hs) {
+    bv_delete(&(*hs)->seen);
+    free((*hs)->ids);
+    free(*hs);
+    *hs = NULL;
+}
+
+// This function inserts an id into the set.
+// Returns true if the id was not in the set before.
+// This function takes in as parameters a HitSet hs and the uint32_t id.
+bool hs_insert(HitSet *hs, uint32_t id) {
+    if (bv_get_bit(hs->seen, id)) {
+        return false;
+    }
+    if (hs->size == hs->capacity) {
+        hs->capacity = hs->capacity ? 2 * hs->capacity : 16;
+        hs->ids = (uint32_t *) realloc(hs->ids, (size_t) hs->capacity * sizeof(uint32_t));
+        if (!hs->ids) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    bv_set_bit(hs->seen, id);
+    hs->ids[hs->size] = id;
+    hs->size = hs->size + 1;
+    return true;
+}
+
+// This function returns the number of ids in the set.
+// This function takes in as a parameter a HitSet hs.
+uint32_t hs_size(HitSet *hs) {
+    return hs->size;
+}
+
+// This function returns the ids in the set, in the order they were first inserted.
+// This function takes in as a parameter a HitSet hs.
+const uint32_t *hs_ids(HitSet *hs) {
+    return hs->ids;
+}
+
+// This function inserts every id of other into hs.
+// This function takes in as parameters the HitSet hs and the HitSet other, which must have the same universe.
+void hs_merge(HitSet *hs, HitSet *other) {
+    for (uint32_t i = 0; i < other->size; i++) {
+        hs_insert(hs, other->ids[i]);
+    }
+}
+
+// This function removes every id from the set. It costs time in the number of ids in the set, not in its universe.
+// This function takes in as a parameter a HitSet hs.
+void hs_clear(HitSet *hs) {
+    for (uint32_t i = 0; i < hs->size; i++) {
+        bv_clr_bit(hs->seen, hs->ids[i]);
+    }
+    hs->size = 0;
+}
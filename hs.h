@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct HitSet HitSet;
+
+HitSet *hs_create(uint32_t universe);
+
+void hs_delete(HitSet **hs);
+
+bool hs_insert(HitSet *hs, uint32_t id);
+
+uint32_t hs_size(HitSet *hs);
+
+const uint32_t *hs_ids(HitSet *hs);
+
+void hs_merge(HitSet *hs, HitSet *other);
+
+void hs_clear(HitSet *hs);
@@ -1,42 +1,124 @@
 #include "ht.h"
+#include "arena.h"
 #include "bst.h"
-#include "salts.h"
-#include "speck.h"
+#include "hc.h"
+#include "mph.h"
+#include "stats.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
-uint64_t lookups = 0;
+#define EMPTY     0 // Node of an empty slot, so that zeroed slots are empty.
+#define NOT_FOUND UINT32_MAX // Slot index of a word that is not in the table.
+
+#define MOVE_PER_INSERT 8 // Old trees or slots whose entries move to the new ones on each insert while resizing.
+
+// A slot of the open addressing table. Everything needed to reject a key is stored inline, so a lookup reads the
+// slots of its probe sequence and then compares the key with a single memcmp().
+typedef struct {
+    uint32_t fingerprint; // 32 bits of the digest. The low bits are the slot the entry hashes to.
+    uint32_t length; // Length of oldspeak.
+    uint32_t offset; // Offset of oldspeak in the string pool.
+    uint32_t node; // One more than the index of the entry's Node, or EMPTY.
+} Slot;
 
 struct HashTable {
-    uint64_t salt[2];
-    uint32_t size;
+    TableEngine engine;
+    uint32_t size; // Number of binary search trees, or number of slots for open addressing.
     Node **trees;
+    Arena *arena; // Nodes and strings of the binary search trees.
+    Node **index; // Nodes of the binary search trees, by id.
+    uint32_t *heights; // Height of each binary search tree, kept up to date as nodes are linked in.
+    uint32_t trees_used; // Number of non-empty binary search trees, old ones included while resizing.
+    uint64_t combined_heights;
+    // The trees or slots of a table being resized, whose entries move to the new ones a few at a time on each insert.
+    // A lookup searches the old ones whose entries have not moved yet too.
+    Node **old_trees;
+    uint32_t *old_heights;
+    Slot *old_slots;
+    uint32_t old_size; // Number of old trees or slots, or 0 if the table is not being resized.
+    uint32_t moved; // Number of old trees or slots whose entries have moved.
+    Slot *slots;
+    uint32_t count; // Number of entries, which are numbered by id in insertion order.
+    Node *nodes; // Entries of the slots, by id.
+    uint32_t nodes_capacity; // Number of entries that nodes, or index, has room for.
+    char *pool; // Null-terminated oldspeak and newspeak strings of the slots.
+    size_t pool_length;
+    size_t pool_capacity;
+    Digest *digests; // Digests of the nodes, kept until the minimal perfect hash is built.
+    Mph *mph; // Minimal perfect hash ordering the slots once the table is frozen.
 };
 
+// This function is a helper function that returns the smallest power of two that is at least n.
+static uint32_t power_of_two(uint32_t n) {
+    uint32_t p = 1;
+    while (p < n && p < (UINT32_C(1) << 31)) {
+        p <<= 1;
+    }
+    return p;
+}
+
+// This function is a helper function that returns the fingerprint of a digest. It matches hc_bucket(), so with
+// a power of two number of slots an entry hashes to the same index as it would with hc_bucket().
+static inline uint32_t fingerprint(Digest d) {
+    return (uint32_t) (d.hi ^ (d.lo >> 32));
+}
+
 // This function is the constructor for a hash table.
-// This function takes in as a parameter uint32_t size which represents the number of indices, or binary search trees,
-// the hash table can index up to.
-// This function returns the created HashTable ht.
-HashTable *ht_create(uint32_t size) {
-    HashTable *ht = (HashTable *) malloc(sizeof(HashTable));
-    ht->salt[0] = SALT_HASHTABLE_LO;
-    ht->salt[1] = SALT_HASHTABLE_HI;
-    ht->size = size;
-    ht->trees = (Node **) calloc(size, sizeof(Node *));
+// This function takes in as parameters uint32_t size which represents the number of indices, or binary search trees,
+// the hash table can index up to, and the TableEngine engine that stores the entries. With open addressing the size
+// is rounded up to a power of two and is the initial number of slots. A perfect table is an open addressing table
+// until ht_freeze() is called.
+// This function returns the created HashTable ht, or NULL if memory could not be allocated.
+HashTable *ht_create(uint32_t size, TableEngine engine) {
+    HashTable *ht = (HashTable *) calloc(1, sizeof(HashTable));
+    if (!ht) {
+        return NULL;
+    }
+    ht->engine = engine;
+    if (engine != TABLE_BST) {
+        ht->size = power_of_two(size);
+        ht->slots = (Slot *) calloc(ht->size, sizeof(Slot));
+        if (!ht->slots) {
+            free(ht);
+            return NULL;
+        }
+    } else {
+        ht->size = size;
+        ht->trees = (Node **) calloc(size, sizeof(Node *));
+        ht->heights = (uint32_t *) calloc(size, sizeof(uint32_t));
+        ht->arena = arena_create();
+        if (!ht->trees || !ht->heights || !ht->arena) {
+            ht_delete(&ht);
+            return NULL;
+        }
+    }
     return ht;
 }
 
-// This function is the destructor for a hash table.
+// This function is the destructor for a hash table. The nodes of the binary search trees all live in one arena, so
+// they are freed together without walking the trees.
 // This function takes in as a parameter a double pointer to HashTable ht.
 void ht_delete(HashTable **ht) {
-    for (uint32_t i = 0; i < (*ht)->size; i++) {
-        if ((*ht)->trees[i] != NULL) {
-            bst_delete(&(*ht)->trees[i]);
-        }
+    if ((*ht)->arena) {
+        arena_delete(&(*ht)->arena);
     }
     free((*ht)->trees);
+    free((*ht)->heights);
+    free((*ht)->old_trees);
+    free((*ht)->old_heights);
+    free((*ht)->old_slots);
+    free((*ht)->index);
+    free((*ht)->slots);
+    free((*ht)->nodes);
+    free((*ht)->pool);
+    free((*ht)->digests);
+    if ((*ht)->mph) {
+        mph_delete(&(*ht)->mph);
+    }
     free(*ht);
     *ht = NULL;
 }
@@ -47,53 +129,477 @@ uint32_t ht_size(HashTable *ht) {
     return ht->size;
 }
 
+// This function returns the engine that stores the hash table's entries.
+// This function takes in as a parameter a HashTable ht.
+TableEngine ht_engine(HashTable *ht) {
+    return ht->engine;
+}
+
+// This function is a helper function that returns how far the entry in slot i of size slots is from the slot it
+// hashes to.
+static inline uint32_t distance(const Slot *slots, uint32_t size, uint32_t i) {
+    return (i - slots[i].fingerprint) & (size - 1);
+}
+
+// This function is a helper function that finds the slot holding oldspeak among size slots. Robin Hood insertion
+// keeps every probe sequence ordered by distance, so the search stops at the first entry that is closer to its own
+// slot than oldspeak would be.
+// Returns the index of the slot, or NOT_FOUND if oldspeak is not in the slots, and adds the number of slots probed
+// past the first to steps.
+static uint32_t probe(HashTable *ht, const Slot *slots, uint32_t size, const char *oldspeak, uint32_t length,
+    uint32_t fp, uint32_t *steps) {
+    uint32_t mask = size - 1;
+    uint32_t i = fp & mask;
+    for (uint32_t dist = 0;; dist++) {
+        const Slot *s = &slots[i];
+        if (s->node == EMPTY || distance(slots, size, i) < dist) {
+            *steps = *steps + dist;
+            return NOT_FOUND;
+        }
+        if (s->fingerprint == fp && s->length == length && memcmp(ht->pool + s->offset, oldspeak, length) == 0) {
+            *steps = *steps + dist;
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+// This function is a helper function that finds the entry holding oldspeak with open addressing. While the table
+// is being resized an entry that has not moved yet is only in the old slots, which are never changed, so they are
+// searched if the new slots do not hold it.
+// Returns the node of the entry, or NULL if oldspeak is not in the table, and adds the number of slots probed past
+// the first to steps.
+static Node *find(HashTable *ht, const char *oldspeak, uint32_t length, uint32_t fp, uint32_t *steps) {
+    uint32_t i = probe(ht, ht->slots, ht->size, oldspeak, length, fp, steps);
+    if (i != NOT_FOUND) {
+        return &ht->nodes[ht->slots[i].node - 1];
+    }
+    if (ht->old_size > 0 && (i = probe(ht, ht->old_slots, ht->old_size, oldspeak, length, fp, steps)) != NOT_FOUND) {
+        return &ht->nodes[ht->old_slots[i].node - 1];
+    }
+    return NULL;
+}
+
+// This function is a helper function that returns the binary search tree the entry with the given hash is in, or
+// belongs in: its old tree while the table is being resized and the entries of that tree have not moved yet, and
+// otherwise its tree. If height is not NULL, it is set to where the height of the tree is kept.
+static Node **tree_of(HashTable *ht, uint32_t hash, uint32_t **height) {
+    uint32_t index = hash % ht->size;
+    Node **trees = ht->trees;
+    uint32_t *heights = ht->heights;
+    if (ht->old_size > 0 && hash % ht->old_size >= ht->moved) {
+        index = hash % ht->old_size;
+        trees = ht->old_trees;
+        heights = ht->old_heights;
+    }
+    if (height != NULL) {
+        *height = &heights[index];
+    }
+    return &trees[index];
+}
+
+// This function is a helper function that links the node n into a binary search tree at link, which is depth
+// branches below the root, and keeps the height of the tree and the number of trees in use up to date.
+static void attach(HashTable *ht, Node **link, uint32_t depth, uint32_t *height, Node *n) {
+    *link = n;
+    ht->trees_used = ht->trees_used + (depth == 0);
+    if (depth + 1 > *height) {
+        ht->combined_heights = ht->combined_heights + depth + 1 - *height;
+        *height = depth + 1;
+    }
+}
+
+// This function is a helper function that places a slot with Robin Hood insertion: an entry that has probed
+// further than the resident of a slot takes that slot, and the resident moves on.
+static void place(HashTable *ht, Slot s) {
+    uint32_t mask = ht->size - 1;
+    uint32_t i = s.fingerprint & mask;
+    for (uint32_t dist = 0;; dist++) {
+        if (ht->slots[i].node == EMPTY) {
+            ht->slots[i] = s;
+            return;
+        }
+        uint32_t resident = distance(ht->slots, ht->size, i);
+        if (resident < dist) {
+            Slot displaced = ht->slots[i];
+            ht->slots[i] = s;
+            s = displaced;
+            dist = resident;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+// This function is a helper function that starts doubling the number of trees or slots. No entry moves yet: the
+// old trees or slots are kept, and their entries move a few at a time on the inserts that follow, so that no
+// insert waits for the whole table to be rehashed.
+// Returns false if memory could not be allocated.
+static bool grow(HashTable *ht) {
+    uint32_t size = ht->size * 2;
+    if (ht->engine == TABLE_BST) {
+        Node **trees = (Node **) calloc(size, sizeof(Node *));
+        uint32_t *heights = (uint32_t *) calloc(size, sizeof(uint32_t));
+        if (!trees || !heights) {
+            free(trees);
+            free(heights);
+            return false;
+        }
+        ht->old_trees = ht->trees;
+        ht->old_heights = ht->heights;
+        ht->trees = trees;
+        ht->heights = heights;
+    } else {
+        Slot *slots = (Slot *) calloc(size, sizeof(Slot));
+        if (!slots) {
+            return false;
+        }
+        ht->old_slots = ht->slots;
+        ht->slots = slots;
+    }
+    ht->old_size = ht->size;
+    ht->size = size;
+    ht->moved = 0;
+    return true;
+}
+
+// This function is a helper function that moves the nodes of the old binary search tree rooted at n into the new
+// trees, each into the one its hash picks. The nodes are linked in preorder, so each new tree keeps the shape the
+// nodes had in the old one.
+static void rehome(HashTable *ht, Node *n) {
+    if (n == NULL) {
+        return;
+    }
+    Node *left = n->left;
+    Node *right = n->right;
+    n->left = NULL;
+    n->right = NULL;
+    uint32_t index = n->hash % ht->size;
+    uint32_t depth = 0;
+    Node **link = bst_slot(&ht->trees[index], n->oldspeak, &depth);
+    attach(ht, link, depth, &ht->heights[index], n);
+    rehome(ht, left);
+    rehome(ht, right);
+}
+
+// This function is a helper function that moves the entries of up to count more old trees or slots to the new ones,
+// and frees the old ones once every entry has moved. Each old tree splits into two new ones, since an entry in old
+// tree i hashes to new tree i or i plus the old size. An old slot is copied rather than moved, since lookups may
+// still search the old slots.
+static void migrate(HashTable *ht, uint32_t count) {
+    for (; count > 0 && ht->moved < ht->old_size; count--) {
+        uint32_t i = ht->moved;
+        ht->moved = i + 1;
+        if (ht->engine == TABLE_BST) {
+            Node *root = ht->old_trees[i];
+            ht->old_trees[i] = NULL;
+            ht->trees_used = ht->trees_used - (root != NULL);
+            ht->combined_heights = ht->combined_heights - ht->old_heights[i];
+            rehome(ht, root);
+        } else if (ht->old_slots[i].node != EMPTY) {
+            place(ht, ht->old_slots[i]);
+        }
+    }
+    if (ht->old_size > 0 && ht->moved == ht->old_size) {
+        free(ht->old_trees);
+        free(ht->old_heights);
+        free(ht->old_slots);
+        ht->old_trees = NULL;
+        ht->old_heights = NULL;
+        ht->old_slots = NULL;
+        ht->old_size = 0;
+        ht->moved = 0;
+    }
+}
+
+// This function is a helper function that copies a string into the pool and returns its offset. The pool grows with
+// realloc(), which can usually remap a large pool rather than copy it. The nodes point into the pool, so if it
+// moves they are pointed at where it moved to.
+static uint32_t intern(HashTable *ht, const char *s, size_t length) {
+    if (ht->pool_length + length + 1 > ht->pool_capacity) {
+        size_t capacity = ht->pool_capacity ? 2 * ht->pool_capacity : 4096;
+        while (capacity < ht->pool_length + length + 1) {
+            capacity *= 2;
+        }
+        uintptr_t old = (uintptr_t) ht->pool;
+        char *pool = (char *) realloc(ht->pool, capacity);
+        if (!pool) {
+            perror("realloc");
+            exit(1);
+        }
+        for (uint32_t n = 0; n < ht->count && (uintptr_t) pool != old; n++) {
+            Node *node = &ht->nodes[n];
+            node->oldspeak = pool + ((uintptr_t) node->oldspeak - old);
+            node->newspeak = node->newspeak ? pool + ((uintptr_t) node->newspeak - old) : NULL;
+        }
+        ht->pool = pool;
+        ht->pool_capacity = capacity;
+    }
+    uint32_t offset = (uint32_t) ht->pool_length;
+    memcpy(ht->pool + offset, s, length);
+    ht->pool[offset + length] = '\0';
+    ht->pool_length += length + 1;
+    return offset;
+}
+
 // This function searches for an entry, a node, in the hash table that contains oldspeak, If the node is found, the
 // pointer to the node is returned. Else, a NULL pointer is returned.
-// This function takes in as parameters a HashTable ht and a char oldspeak.
-Node *ht_lookup(HashTable *ht, char *oldspeak) {
-    lookups = lookups + 1;
-    uint32_t index = hash(ht->salt, oldspeak) % ht->size;
-    return bst_find(ht->trees[index], oldspeak);
+// This function takes in as parameters a HashTable ht, a char oldspeak, its uint32_t length, and the Digest d of
+// oldspeak.
+Node *ht_lookup(HashTable *ht, char *oldspeak, uint32_t length, Digest d) {
+    stats_add(STAT_LOOKUPS, 1);
+    if (ht->mph) {
+        Slot *s = &ht->slots[mph_index(ht->mph, d)];
+        bool found = s->fingerprint == fingerprint(d) && s->length == length
+                     && memcmp(ht->pool + s->offset, oldspeak, length) == 0;
+        return found ? &ht->nodes[s->node - 1] : NULL;
+    }
+    if (ht->engine != TABLE_BST) {
+        uint32_t steps = 0;
+        Node *n = find(ht, oldspeak, length, fingerprint(d), &steps);
+        stats_add(STAT_BRANCHES, steps);
+        return n;
+    }
+    return bst_find(*tree_of(ht, fingerprint(d), NULL), oldspeak);
+}
+
+// This function looks up n words at once, like n calls to ht_lookup(). The first memory each lookup reads, the root
+// of a binary search tree or the first slot of a probe sequence, is prefetched for every word before any word is
+// looked up, so the cache misses overlap. A perfect table reads a pilot and then a slot, so the pilots are
+// prefetched first and the slots once the pilots are in.
+// This function takes in as parameters a HashTable ht, the n chars words, their uint32_t lengths, their Digests d,
+// the uint32_t n, and the n Nodes nodes which are set to the node of each word or NULL.
+void ht_lookup_many(HashTable *ht, char **words, const uint32_t *lengths, const Digest *d, uint32_t n, Node **nodes) {
+    for (uint32_t i = 0; i < n; i++) {
+        if (ht->mph) {
+            mph_prefetch(ht->mph, d[i]);
+        } else if (ht->engine != TABLE_BST) {
+            __builtin_prefetch(&ht->slots[fingerprint(d[i]) & (ht->size - 1)]);
+        } else {
+            __builtin_prefetch(tree_of(ht, fingerprint(d[i]), NULL));
+        }
+    }
+    if (ht->mph) {
+        for (uint32_t i = 0; i < n; i++) {
+            __builtin_prefetch(&ht->slots[mph_index(ht->mph, d[i])]);
+        }
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        nodes[i] = ht_lookup(ht, words[i], lengths[i], d[i]);
+    }
+}
+
+// This function is a helper function that returns whether the table should start doubling before an entry is
+// inserted: once there are as many entries as binary search trees, or once the slots are seven-eighths full.
+static bool overloaded(HashTable *ht) {
+    if (ht->old_size > 0 || ht->size >= (UINT32_C(1) << 31)) {
+        return false;
+    }
+    if (ht->engine == TABLE_BST) {
+        return ht->count >= ht->size;
+    }
+    return (uint64_t) (ht->count + 1) * 8 > (uint64_t) ht->size * 7;
 }
 
 // This function inserts the specified oldspeak and its corresponding newspeak translation into the hash table.
-// This function takes in as parameters a HashTable ht, a char oldspeak, and a char newspeak.
-void ht_insert(HashTable *ht, char *oldspeak, char *newspeak) {
-    lookups = lookups + 1;
-    uint32_t index = hash(ht->salt, oldspeak) % ht->size;
-    ht->trees[index] = bst_insert(ht->trees[index], oldspeak, newspeak);
+// The table doubles once there are as many entries as binary search trees, or once the slots are seven-eighths
+// full. The entries move to the new trees or slots MOVE_PER_INSERT old ones at a time on each insert, which keeps
+// ahead of the inserts, so the resize is done before the new table fills up. A frozen perfect table cannot be
+// inserted into.
+// This function takes in as parameters a HashTable ht, a char oldspeak, a char newspeak, and the Digest d of oldspeak.
+void ht_insert(HashTable *ht, char *oldspeak, char *newspeak, Digest d) {
+    stats_add(STAT_LOOKUPS, 1);
+    if (ht->mph) {
+        fprintf(stderr, "Cannot insert %s into a frozen hash table.\n", oldspeak);
+        return;
+    }
+    migrate(ht, MOVE_PER_INSERT);
+    if (overloaded(ht) && !grow(ht)) {
+        perror("malloc");
+        exit(1);
+    }
+    if (ht->engine == TABLE_BST) {
+        // Finding where oldspeak belongs, and counting the branches to it only if it is not a duplicate
+        uint32_t *height = NULL;
+        uint32_t depth = 0;
+        Node **link = bst_slot(tree_of(ht, fingerprint(d), &height), oldspeak, &depth);
+        if (*link != NULL) {
+            return;
+        }
+        if (ht->count == ht->nodes_capacity) {
+            ht->nodes_capacity = ht->nodes_capacity ? 2 * ht->nodes_capacity : 1024;
+            ht->index = (Node **) realloc(ht->index, (size_t) ht->nodes_capacity * sizeof(Node *));
+            if (!ht->index) {
+                perror("realloc");
+                exit(1);
+            }
+        }
+        Node *n = node_create_arena(ht->arena, oldspeak, newspeak);
+        if (!n) {
+            perror("malloc");
+            exit(1);
+        }
+        n->id = ht->count;
+        n->hash = fingerprint(d);
+        ht->index[ht->count] = n;
+        ht->count = ht->count + 1;
+        attach(ht, link, depth, height, n);
+        stats_add(STAT_BRANCHES, depth);
+        return;
+    }
+
+    uint32_t fp = fingerprint(d);
+    uint32_t length = strlen(oldspeak);
+    uint32_t steps = 0;
+    if (find(ht, oldspeak, length, fp, &steps) != NULL) {
+        return;
+    }
+    if (ht->count == ht->nodes_capacity) {
+        ht->nodes_capacity = ht->nodes_capacity ? 2 * ht->nodes_capacity : 1024;
+        ht->nodes = (Node *) realloc(ht->nodes, (size_t) ht->nodes_capacity * sizeof(Node));
+        if (!ht->nodes) {
+            perror("realloc");
+            exit(1);
+        }
+        if (ht->engine == TABLE_PERFECT) {
+            ht->digests = (Digest *) realloc(ht->digests, (size_t) ht->nodes_capacity * sizeof(Digest));
+            if (!ht->digests) {
+                perror("realloc");
+                exit(1);
+            }
+        }
+    }
+    if (ht->digests) {
+        ht->digests[ht->count] = d;
+    }
+
+    Slot s;
+    s.fingerprint = fp;
+    s.length = length;
+    s.offset = intern(ht, oldspeak, length);
+    s.node = ht->count + 1;
+    uint32_t translation = newspeak ? intern(ht, newspeak, strlen(newspeak)) : 0;
+
+    Node *n = &ht->nodes[ht->count];
+    n->oldspeak = ht->pool + s.offset;
+    n->newspeak = newspeak ? ht->pool + translation : NULL;
+    n->left = NULL;
+    n->right = NULL;
+    n->id = ht->count;
+    n->hash = fp;
+    ht->count = ht->count + 1;
+    place(ht, s);
+}
+
+// This function freezes a hash table once every entry is inserted. A resize still in progress is finished, since
+// no insert will finish it, so lookups never search the old trees or slots. A perfect table then builds a minimal
+// perfect hash over the entries and puts each one in the slot the hash gives it, so there are exactly as many slots
+// as entries and a lookup reads a single slot. The table is left as it was if no minimal perfect hash could be
+// built.
+// This function takes in as a parameter a HashTable ht.
+void ht_freeze(HashTable *ht) {
+    migrate(ht, UINT32_MAX);
+    if (ht->engine != TABLE_PERFECT || ht->mph || ht->count == 0) {
+        return;
+    }
+    Mph *mph = mph_create(ht->digests, ht->count);
+    Slot *slots = mph ? (Slot *) malloc((size_t) ht->count * sizeof(Slot)) : NULL;
+    if (!slots) {
+        fprintf(stderr, "Failed to build a minimal perfect hash, using open addressing.\n");
+        if (mph) {
+            mph_delete(&mph);
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < ht->size; i++) {
+        if (ht->slots[i].node != EMPTY) {
+            slots[mph_index(mph, ht->digests[ht->slots[i].node - 1])] = ht->slots[i];
+        }
+    }
+    free(ht->slots);
+    free(ht->digests);
+    ht->slots = slots;
+    ht->size = ht->count;
+    ht->digests = NULL;
+    ht->mph = mph;
 }
 
-// This function returns the number of non-NULL binary search trees in the hash table.
+// This function returns the number of non-NULL binary search trees in the hash table. With open addressing it
+// returns the number of occupied slots.
 // This function takes in as a parameter a HashTable ht.
 uint32_t ht_count(HashTable *ht) {
-    uint32_t count = 0;
+    if (ht->engine != TABLE_BST) {
+        return ht->count;
+    }
+    return ht->trees_used;
+}
+
+// This function returns the number of entries in the hash table. Entries are numbered by id from 0 up to it.
+// This function takes in as a parameter a HashTable ht.
+uint32_t ht_entries(HashTable *ht) {
+    return ht->count;
+}
+
+// This function returns the entry, or node, with the given id.
+// This function takes in as parameters a HashTable ht and the uint32_t id, which must be less than ht_entries().
+Node *ht_node(HashTable *ht, uint32_t id) {
+    return ht->engine == TABLE_BST ? ht->index[id] : &ht->nodes[id];
+}
+
+// This function is a helper function that returns the average number of slots probed to find an entry stored with
+// open addressing. A probe sequence plays the part of a binary search tree, so it is reported as both the average
+// tree size and height. A frozen perfect table reads exactly one slot.
+static double avg_probe_length(HashTable *ht) {
+    if (ht->mph) {
+        return 1.0;
+    }
+    uint64_t combined_lengths = 0;
     for (uint32_t i = 0; i < ht->size; i++) {
-        if (ht->trees[i] != NULL) {
-            count = count + 1;
+        if (ht->slots[i].node != EMPTY) {
+            combined_lengths = combined_lengths + distance(ht->slots, ht->size, i) + 1;
+        }
+    }
+    for (uint32_t i = ht->moved; i < ht->old_size; i++) {
+        if (ht->old_slots[i].node != EMPTY) {
+            combined_lengths = combined_lengths + distance(ht->old_slots, ht->old_size, i) + 1;
         }
     }
-    return count;
+    return (double) combined_lengths / ht->count;
 }
 
-// This function returns the average binary search tree size.
+// This function returns the average binary search tree size. Every entry is in one of the trees, so the trees
+// are not walked.
 // This function takes in as a parameter a HashTable ht.
 double ht_avg_bst_size(HashTable *ht) {
-    uint32_t combined_tree_sizes = 0;
-    for (uint32_t i = 0; i < ht->size; i++) {
-        combined_tree_sizes = combined_tree_sizes + bst_size(ht->trees[i]);
+    if (ht->engine != TABLE_BST) {
+        return avg_probe_length(ht);
     }
-    return (double) combined_tree_sizes / ht_count(ht);
+    return (double) ht->count / ht->trees_used;
 }
 
-// This function returns the average binary search tree height.
+// This function returns the average binary search tree height, from the heights kept as the trees grow.
 // This function takes in as a parameter a HashTable ht.
 double ht_avg_bst_height(HashTable *ht) {
-    uint32_t combined_tree_heights = 0;
+    if (ht->engine != TABLE_BST) {
+        return avg_probe_length(ht);
+    }
+    return (double) ht->combined_heights / ht->trees_used;
+}
+
+// This function calls visit on every node in the hash table.
+// This function takes in as parameters a HashTable ht, the function visit, and a void arg which is passed on to visit.
+void ht_walk(HashTable *ht, void (*visit)(Node *n, void *arg), void *arg) {
+    if (ht->engine != TABLE_BST) {
+        for (uint32_t n = 0; n < ht->count; n++) {
+            visit(&ht->nodes[n], arg);
+        }
+        return;
+    }
     for (uint32_t i = 0; i < ht->size; i++) {
-        combined_tree_heights = combined_tree_heights + bst_height(ht->trees[i]);
+        bst_walk(ht->trees[i], visit, arg);
+    }
+    for (uint32_t i = ht->moved; i < ht->old_size; i++) {
+        bst_walk(ht->old_trees[i], visit, arg);
     }
-    return (double) combined_tree_heights / ht_count(ht);
 }
 
 // This function is a debug function to print out the contents of a hash table.
@@ -101,6 +607,22 @@ double ht_avg_bst_height(HashTable *ht) {
 void ht_print(HashTable *ht) {
     for (uint32_t i = 0; i < ht->size; i++) {
         printf("Contents at index %d:\n", i);
-        bst_print(ht->trees[i]);
+        if (ht->engine != TABLE_BST) {
+            if (ht->slots[i].node != EMPTY) {
+                node_print(&ht->nodes[ht->slots[i].node - 1]);
+            }
+        } else {
+            bst_print(ht->trees[i]);
+        }
+    }
+    for (uint32_t i = ht->moved; i < ht->old_size; i++) {
+        printf("Contents at old index %d:\n", i);
+        if (ht->engine != TABLE_BST) {
+            if (ht->old_slots[i].node != EMPTY) {
+                node_print(&ht->nodes[ht->old_slots[i].node - 1]);
+            }
+        } else {
+            bst_print(ht->old_trees[i]);
+        }
     }
 }
@@ -1,27 +1,40 @@
 #pragma once
 
 #include "bst.h"
+#include "hc.h"
 
 #include <stdint.h>
 
-extern uint64_t lookups;
+typedef enum { TABLE_BST, TABLE_OPEN, TABLE_PERFECT } TableEngine;
 
 typedef struct HashTable HashTable;
 
-HashTable *ht_create(uint32_t size);
+HashTable *ht_create(uint32_t size, TableEngine engine);
 
 void ht_delete(HashTable **ht);
 
 uint32_t ht_size(HashTable *ht);
 
-Node *ht_lookup(HashTable *ht, char *oldspeak);
+TableEngine ht_engine(HashTable *ht);
 
-void ht_insert(HashTable *ht, char *oldspeak, char *newspeak);
+Node *ht_lookup(HashTable *ht, char *oldspeak, uint32_t length, Digest d);
+
+void ht_lookup_many(HashTable *ht, char **words, const uint32_t *lengths, const Digest *d, uint32_t n, Node **nodes);
+
+void ht_insert(HashTable *ht, char *oldspeak, char *newspeak, Digest d);
+
+void ht_freeze(HashTable *ht);
 
 uint32_t ht_count(HashTable *ht);
 
+uint32_t ht_entries(HashTable *ht);
+
+Node *ht_node(HashTable *ht, uint32_t id);
+
 double ht_avg_bst_size(HashTable *ht);
 
 double ht_avg_bst_height(HashTable *ht);
 
+void ht_walk(HashTable *ht, void (*visit)(Node *n, void *arg), void *arg);
+
 void ht_print(HashTable *ht);
@@ -0,0 +1,251 @@
+#include "json.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// This function prints length bytes of s to out as a quoted JSON string.
+// This function takes in as parameters a FILE out, a char s, and the size_t length of s.
+void json_print_string(FILE *out, const char *s, size_t length) {
+    fputc('"', out);
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char) s[i];
+        switch (c) {
+        case '"': fputs("\\\"", out); break;
+        case '\\': fputs("\\\\", out); break;
+        case '\n': fputs("\\n", out); break;
+        case '\r': fputs("\\r", out); break;
+        case '\t': fputs("\\t", out); break;
+        default:
+            if (c < 0x20) {
+                fprintf(out, "\\u%04x", c);
+            } else {
+                fputc(c, out);
+            }
+        }
+    }
+    fputc('"', out);
+}
+
+// A cursor over the JSON text being read.
+typedef struct {
+    const char *s;
+    size_t length;
+    size_t i;
+} Reader;
+
+static void skip_space(Reader *r) {
+    while (r->i < r->length
+           && (r->s[r->i] == ' ' || r->s[r->i] == '\t' || r->s[r->i] == '\n' || r->s[r->i] == '\r')) {
+        r->i += 1;
+    }
+}
+
+// This function is a helper function that appends a byte to the decoded string.
+static bool append(char **value, size_t *value_length, size_t *capacity, char c) {
+    if (*value_length + 1 >= *capacity) {
+        size_t grown = *capacity ? 2 * *capacity : 64;
+        char *bigger = (char *) realloc(*value, grown);
+        if (!bigger) {
+            return false;
+        }
+        *value = bigger;
+        *capacity = grown;
+    }
+    (*value)[(*value_length)++] = c;
+    (*value)[*value_length] = '\0';
+    return true;
+}
+
+// This function is a helper function that reads four hex digits of a \u escape.
+static bool read_hex(Reader *r, uint32_t *code) {
+    *code = 0;
+    for (int n = 0; n < 4; n++) {
+        if (r->i >= r->length) {
+            return false;
+        }
+        char c = r->s[r->i++];
+        *code <<= 4;
+        if (c >= '0' && c <= '9') {
+            *code |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            *code |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            *code |= c - 'A' + 10;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// This function is a helper function that reads a JSON string at the cursor. If value is not NULL the decoded
+// string, encoded as UTF-8, is stored in it. Returns false if the string is malformed.
+static bool read_string(Reader *r, char **value, size_t *value_length, size_t *capacity) {
+    if (r->i >= r->length || r->s[r->i] != '"') {
+        return false;
+    }
+    r->i += 1;
+    if (value) {
+        *value_length = 0;
+        if (!append(value, value_length, capacity, '\0')) {
+            return false;
+        }
+        *value_length = 0;
+    }
+    while (r->i < r->length) {
+        char c = r->s[r->i++];
+        if (c == '"') {
+            return true;
+        }
+        if (c == '\\') {
+            if (r->i >= r->length) {
+                return false;
+            }
+            char e = r->s[r->i++];
+            uint32_t code = 0;
+            switch (e) {
+            case 'n': c = '\n'; break;
+            case 't': c = '\t'; break;
+            case 'r': c = '\r'; break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case '"':
+            case '\\':
+            case '/': c = e; break;
+            case 'u':
+                if (!read_hex(r, &code)) {
+                    return false;
+                }
+                // Combining a surrogate pair into one code point. A surrogate that is not part of a pair is
+                // replaced with U+FFFD, and the escape after it is read on its own.
+                if (code >= 0xd800 && code < 0xdc00 && r->i + 1 < r->length && r->s[r->i] == '\\'
+                    && r->s[r->i + 1] == 'u') {
+                    uint32_t low = 0;
+                    size_t start = r->i;
+                    r->i += 2;
+                    if (!read_hex(r, &low)) {
+                        return false;
+                    }
+                    if (low >= 0xdc00 && low < 0xe000) {
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    } else {
+                        r->i = start;
+                    }
+                }
+                if (code >= 0xd800 && code < 0xe000) {
+                    code = 0xfffd;
+                }
+                if (value) {
+                    char utf8[4];
+                    int bytes = 0;
+                    if (code < 0x80) {
+                        utf8[bytes++] = (char) code;
+                    } else if (code < 0x800) {
+                        utf8[bytes++] = (char) (0xc0 | (code >> 6));
+                        utf8[bytes++] = (char) (0x80 | (code & 0x3f));
+                    } else if (code < 0x10000) {
+                        utf8[bytes++] = (char) (0xe0 | (code >> 12));
+                        utf8[bytes++] = (char) (0x80 | ((code >> 6) & 0x3f));
+                        utf8[bytes++] = (char) (0x80 | (code & 0x3f));
+                    } else {
+                        utf8[bytes++] = (char) (0xf0 | (code >> 18));
+                        utf8[bytes++] = (char) (0x80 | ((code >> 12) & 0x3f));
+                        utf8[bytes++] = (char) (0x80 | ((code >> 6) & 0x3f));
+                        utf8[bytes++] = (char) (0x80 | (code & 0x3f));
+                    }
+                    for (int b = 0; b < bytes; b++) {
+                        if (!append(value, value_length, capacity, utf8[b])) {
+                            return false;
+                        }
+                    }
+                }
+                continue;
+            default: return false;
+            }
+        }
+        if (value && !append(value, value_length, capacity, c)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// This function is a helper function that skips over any JSON value at the cursor. Returns false if the value is
+// malformed.
+static bool skip_value(Reader *r) {
+    skip_space(r);
+    if (r->i >= r->length) {
+        return false;
+    }
+    if (r->s[r->i] == '"') {
+        return read_string(r, NULL, NULL, NULL);
+    }
+    if (r->s[r->i] == '{' || r->s[r->i] == '[') {
+        uint32_t depth = 0;
+        while (r->i < r->length) {
+            char c = r->s[r->i];
+            if (c == '"') {
+                if (!read_string(r, NULL, NULL, NULL)) {
+                    return false;
+                }
+                continue;
+            }
+            r->i += 1;
+            if (c == '{' || c == '[') {
+                depth += 1;
+            } else if ((c == '}' || c == ']') && --depth == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+    while (r->i < r->length && r->s[r->i] != ',' && r->s[r->i] != '}' && r->s[r->i] != ']') {
+        r->i += 1; // Numbers, true, false and null.
+    }
+    return true;
+}
+
+// This function finds the string member named field of the JSON object held in length bytes of object and decodes
+// it into value. Returns false if the object is malformed or has no such string member.
+// This function takes in as parameters a char object, its size_t length, a char field, and pointers to the
+// growable value buffer, its length, and its capacity.
+bool json_string_field(const char *object, size_t length, const char *field, char **value, size_t *value_length,
+    size_t *capacity) {
+    Reader r = { object, length, 0 };
+    size_t field_length = strlen(field);
+
+    skip_space(&r);
+    if (r.i >= r.length || r.s[r.i] != '{') {
+        return false;
+    }
+    r.i += 1;
+    for (;;) {
+        skip_space(&r);
+        size_t key = r.i + 1;
+        if (!read_string(&r, NULL, NULL, NULL)) {
+            return false;
+        }
+        bool match = r.i - key - 1 == field_length && memcmp(r.s + key, field, field_length) == 0;
+        skip_space(&r);
+        if (r.i >= r.length || r.s[r.i] != ':') {
+            return false;
+        }
+        r.i += 1;
+        skip_space(&r);
+        if (match && r.i < r.length && r.s[r.i] == '"') {
+            return read_string(&r, value, value_length, capacity);
+        }
+        if (!skip_value(&r)) {
+            return false;
+        }
+        skip_space(&r);
+        if (r.i >= r.length || r.s[r.i] != ',') {
+            return false;
+        }
+        r.i += 1;
+    }
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+void json_print_string(FILE *out, const char *s, size_t length);
+
+bool json_string_field(const char *object, size_t length, const char *field, char **value, size_t *value_length,
+    size_t *capacity);
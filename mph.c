@@ -0,0 +1,175 @@
+#include "mph.h"
+#include "hc.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LAMBDA 4 // Average number of keys per bucket.
+
+// A minimal perfect hash in the style of PTHash. Keys are split into buckets by the low half of their digest, and
+// every bucket stores a pilot. A key's position is the high half of its digest mixed with the pilot of its bucket,
+// and the pilots are chosen when the hash is built so that every key lands on its own position in [0, n).
+struct Mph {
+    uint32_t n;
+    uint32_t buckets;
+    uint32_t *pilots;
+};
+
+// This function is a helper function that maps x onto [0, n) without a division.
+static inline uint32_t reduce(uint64_t x, uint32_t n) {
+    return (uint32_t) (((x >> 32) * n) >> 32);
+}
+
+// This function is a helper function that mixes 64 bits (the MurmurHash3 finalizer).
+static inline uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccd;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint32_t bucket_of(Mph *m, Digest d) {
+    return reduce(d.lo, m->buckets);
+}
+
+static inline uint32_t position(Mph *m, Digest d, uint32_t pilot) {
+    return reduce(mix(d.hi ^ pilot * 0x9e3779b97f4a7c15), m->n);
+}
+
+// This function is the constructor for a minimal perfect hash over n keys. Buckets are placed from the largest to
+// the smallest, while the table is still empty enough for the large ones to find a pilot quickly.
+// This function takes in as parameters the Digest keys, which must be distinct, and the uint32_t number n of them.
+// This function returns the created Mph, or NULL if memory could not be allocated or no pilot could be found for
+// a bucket (for example because two keys share a digest).
+Mph *mph_create(const Digest *keys, uint32_t n) {
+    Mph *m = (Mph *) calloc(1, sizeof(Mph));
+    if (!m) {
+        return NULL;
+    }
+    m->n = n;
+    m->buckets = n / LAMBDA + 1;
+    m->pilots = (uint32_t *) calloc(m->buckets, sizeof(uint32_t));
+    uint32_t *starts = (uint32_t *) calloc((size_t) m->buckets + 1, sizeof(uint32_t));
+    uint32_t *members = (uint32_t *) malloc(((size_t) n + 1) * sizeof(uint32_t));
+    uint32_t *order = (uint32_t *) malloc((size_t) m->buckets * sizeof(uint32_t));
+    uint64_t *taken = (uint64_t *) calloc((size_t) n / 64 + 1, sizeof(uint64_t));
+    uint32_t *by_size = NULL;
+    bool built = m->pilots && starts && members && order && taken;
+
+    // Grouping the keys by bucket
+    uint32_t largest = 0;
+    if (built) {
+        for (uint32_t k = 0; k < n; k++) {
+            starts[bucket_of(m, keys[k]) + 1] += 1;
+        }
+        for (uint32_t b = 0; b < m->buckets; b++) {
+            largest = starts[b + 1] > largest ? starts[b + 1] : largest;
+            starts[b + 1] += starts[b];
+        }
+        uint32_t *fill = (uint32_t *) malloc((size_t) m->buckets * sizeof(uint32_t));
+        by_size = (uint32_t *) calloc((size_t) largest + 2, sizeof(uint32_t));
+        built = fill && by_size;
+        if (built) {
+            memcpy(fill, starts, (size_t) m->buckets * sizeof(uint32_t));
+            for (uint32_t k = 0; k < n; k++) {
+                members[fill[bucket_of(m, keys[k])]++] = k;
+            }
+        }
+        free(fill);
+    }
+
+    // Ordering the buckets from largest to smallest with a counting sort
+    if (built) {
+        for (uint32_t b = 0; b < m->buckets; b++) {
+            by_size[largest - (starts[b + 1] - starts[b]) + 1] += 1;
+        }
+        for (uint32_t s = 0; s <= largest; s++) {
+            by_size[s + 1] += by_size[s];
+        }
+        for (uint32_t b = 0; b < m->buckets; b++) {
+            order[by_size[largest - (starts[b + 1] - starts[b])]++] = b;
+        }
+    }
+
+    // Searching for a pilot that sends every key of the bucket to a free position
+    uint32_t positions[64];
+    uint64_t limit = (uint64_t) n * 64 + 1024;
+    for (uint32_t i = 0; built && i < m->buckets; i++) {
+        uint32_t b = order[i];
+        uint32_t size = starts[b + 1] - starts[b];
+        if (size == 0) {
+            break;
+        }
+        if (size > sizeof(positions) / sizeof(positions[0])) {
+            built = false;
+            break;
+        }
+        bool placed = false;
+        for (uint64_t pilot = 0; !placed && pilot < limit && pilot <= UINT32_MAX; pilot++) {
+            placed = true;
+            for (uint32_t j = 0; placed && j < size; j++) {
+                uint32_t p = position(m, keys[members[starts[b] + j]], (uint32_t) pilot);
+                if (taken[p / 64] >> (p % 64) & 1) {
+                    placed = false;
+                }
+                for (uint32_t other = 0; placed && other < j; other++) {
+                    placed = positions[other] != p;
+                }
+                positions[j] = p;
+            }
+            if (placed) {
+                m->pilots[b] = (uint32_t) pilot;
+                for (uint32_t j = 0; j < size; j++) {
+                    taken[positions[j] / 64] |= UINT64_C(1) << (positions[j] % 64);
+                }
+            }
+        }
+        built = placed;
+    }
+
+    free(starts);
+    free(members);
+    free(order);
+    free(taken);
+    free(by_size);
+    if (!built) {
+        mph_delete(&m);
+    }
+    return m;
+}
+
+// This function is the destructor for a minimal perfect hash.
+// This function takes in as a parameter a double pointer to the Mph m.
+void mph_delete(Mph **m) {
+    free((*m)->pilots);
+    free(*m);
+    *m = NULL;
+}
+
+// This function returns the number of keys, and positions, of a minimal perfect hash.
+// This function takes in as a parameter a Mph m.
+uint32_t mph_size(Mph *m) {
+    return m->n;
+}
+
+// This function returns the number of buckets, and pilots, of a minimal perfect hash.
+// This function takes in as a parameter a Mph m.
+uint32_t mph_buckets(Mph *m) {
+    return m->buckets;
+}
+
+// This function prefetches the pilot that mph_index() reads for a key.
+// This function takes in as parameters a Mph m and the Digest d of the key.
+void mph_prefetch(Mph *m, Digest d) {
+    __builtin_prefetch(&m->pilots[bucket_of(m, d)]);
+}
+
+// This function returns the position of a key.
+// This function takes in as parameters a Mph m and the Digest d of the key.
+uint32_t mph_index(Mph *m, Digest d) {
+    return position(m, d, m->pilots[bucket_of(m, d)]);
+}
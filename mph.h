@@ -0,0 +1,22 @@
+#pragma once
+
+#include "hc.h"
+
+#include <stdint.h>
+
+typedef struct Mph Mph;
+
+Mph *mph_create(const Digest *keys, uint32_t n);
+
+void mph_delete(Mph **m);
+
+uint32_t mph_size(Mph *m);
+
+uint32_t mph_buckets(Mph *m);
+
+// Returns the position in [0, n) of a key the minimal perfect hash was built over. Keys it was not built over map
+// to an arbitrary position, so the key stored there must be checked.
+uint32_t mph_index(Mph *m, Digest d);
+
+// Prefetches the memory mph_index() reads first for a key, so several lookups can overlap their cache misses.
+void mph_prefetch(Mph *m, Digest d);
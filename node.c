@@ -1,4 +1,5 @@
 #include "node.h"
+#include "arena.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,6 +25,28 @@ Node *node_create(char *oldspeak, char *newspeak) {
         }
         n->left = NULL;
         n->right = NULL;
+        n->id = 0;
+        n->hash = 0;
+    }
+    return n;
+}
+
+// This function is the constructor for a node that lives in an arena. The node and copies of its strings are
+// placed together in a single allocation, and are freed with the arena rather than with node_delete().
+// This function takes in as parameters an Arena a, a char oldspeak and another char newspeak.
+// This function returns the created node, or NULL if memory could not be allocated.
+Node *node_create_arena(Arena *a, char *oldspeak, char *newspeak) {
+    size_t old_length = oldspeak ? strlen(oldspeak) + 1 : 0;
+    size_t new_length = newspeak ? strlen(newspeak) + 1 : 0;
+    Node *n = (Node *) arena_alloc(a, sizeof(Node) + old_length + new_length);
+    if (n) {
+        char *strings = (char *) (n + 1);
+        n->oldspeak = oldspeak ? memcpy(strings, oldspeak, old_length) : NULL;
+        n->newspeak = newspeak ? memcpy(strings + old_length, newspeak, new_length) : NULL;
+        n->left = NULL;
+        n->right = NULL;
+        n->id = 0;
+        n->hash = 0;
     }
     return n;
 }
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "arena.h"
+
+#include <stdint.h>
+
 typedef struct Node Node;
 
 struct Node {
@@ -7,10 +11,14 @@ struct Node {
     char *newspeak;
     Node *left;
     Node *right;
+    uint32_t id; // Dense index of a dictionary entry.
+    uint32_t hash; // Hash of oldspeak that picks its binary search tree, kept so it can move when the table grows.
 };
 
 Node *node_create(char *oldspeak, char *newspeak);
 
+Node *node_create_arena(Arena *a, char *oldspeak, char *newspeak);
+
 void node_delete(Node **n);
 
 void node_print(Node *n);
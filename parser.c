@@ -1,82 +1,810 @@
 #include "parser.h"
-#include <regex.h>
+#include "utf8.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define CHUNK        (1 << 20) // Bytes read from a stream at a time.
+#define ASCII_BLOCK  4096 // Bytes of input checked for multibyte characters at a time.
+#define ASCII_MARGIN 64 // Bytes of ASCII ahead of a word below which more input is checked.
+
+#define W 0x1 // ASCII word character.
+#define J 0x2 // Joins two runs of word characters.
+#define U 0x4 // Part of a multibyte UTF-8 character, which is classified once it is decoded.
 
-#define BLOCK 4096
+#define CUT -1 // A multibyte character that the buffered input ends inside.
 
-static char *words[BLOCK] = { NULL }; // Stores a block of words maximum.
+// Character classes indexed by byte.
+static const uint8_t classes[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, J, 0, 0, 0, 0, 0, J, 0, 0,
+    W, W, W, W, W, W, W, W, W, W, 0, 0, 0, 0, 0, 0,
+    0, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,
+    W, W, W, W, W, W, W, W, W, W, W, 0, 0, 0, 0, W,
+    0, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,
+    W, W, W, W, W, W, W, W, W, W, W, 0, 0, 0, 0, 0,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+};
+
+struct Parser {
+    int fd;
+    bool mapped; // Whether data is a mapping of the whole file.
+    bool eof; // Whether everything the input holds is in data.
+    char *data;
+    size_t length; // Bytes of input in data.
+    size_t capacity; // Bytes allocated for data when streaming.
+    size_t position; // Where scanning resumes in data.
+    char *folded; // The words scanned by the last call to next_words_lower().
+    size_t folded_capacity;
+    size_t folded_length; // Where the word being scanned is folded to.
+    uint64_t discarded; // Bytes of input discarded before data.
+    void (*drain)(void *arg); // Called before scanned input is discarded, or NULL.
+    void *drain_arg;
+    size_t ascii_end; // Where the input from position on is known to be ASCII up to.
+};
 
 //
-// Returns the next word that matches the specified regular expression.
-// Words are buffered and returned as they are read from the input file.
+// Creates a parser that scans words from the specified file descriptor.
+// Regular files are mapped into memory and scanned in place. Anything else
+// (pipes, terminals, sockets) is read in large chunks.
 //
-// infile:      The input file to read from.
-// word_regex:  The compiled regular expression for a word.
-// returns:     The next word if it exists, a null pointer otherwise.
+// fd:          The file descriptor to read from.
+// returns:     The parser, or a null pointer if memory could not be allocated.
 //
-char *next_word(FILE *infile, regex_t *word_regex) {
-    static uint32_t index = 0; // Track the word to return.
-    static uint32_t count = 0; // How many words have we stored?
+Parser *parser_create(int fd) {
+    Parser *p = (Parser *) calloc(1, sizeof(Parser));
+    if (!p) {
+        return NULL;
+    }
+    p->fd = fd;
 
-    if (!index) {
-        clear_words();
+    struct stat st;
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && offset >= 0 && st.st_size > 0) {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            p->mapped = true;
+            p->eof = true;
+            p->data = (char *) data;
+            p->length = st.st_size;
+            p->position = offset < st.st_size ? offset : st.st_size; // Start where the descriptor is at.
+            return p;
+        }
+    }
 
-        regmatch_t match;
-        uint32_t matches = 0;
-        char buffer[BLOCK] = { 0 };
+    p->capacity = CHUNK;
+    p->data = (char *) malloc(p->capacity);
+    if (!p->data) {
+        free(p);
+        return NULL;
+    }
+    return p;
+}
 
-        while (!matches) {
-            if (!fgets(buffer, BLOCK, infile)) {
-                return NULL;
+//
+// Creates a parser that scans words from a block of memory. The memory is
+// not copied and must outlive the parser.
+//
+// data:        The input to scan.
+// length:      The number of bytes of input.
+// returns:     The parser, or a null pointer if memory could not be allocated.
+//
+Parser *parser_create_buffer(const char *data, size_t length) {
+    Parser *p = (Parser *) calloc(1, sizeof(Parser));
+    if (p) {
+        p->fd = -1;
+        p->eof = true;
+        p->data = (char *) data;
+        p->length = length;
+    }
+    return p;
+}
+
+//
+// Deletes a parser. The file descriptor is not closed.
+//
+// p:           The parser to delete.
+//
+void parser_delete(Parser **p) {
+    if ((*p)->mapped) {
+        munmap((*p)->data, (*p)->length);
+    } else if ((*p)->capacity) {
+        free((*p)->data);
+    }
+    free((*p)->folded);
+    free(*p);
+    *p = NULL;
+}
+
+//
+// Returns the offset of a word from the start of the input, which is the
+// start of the file for a mapped file.
+//
+// p:           The parser the word was scanned by.
+// word:        A word returned by next_word() that is still valid.
+// returns:     The offset of the first byte of the word.
+//
+uint64_t parser_offset(Parser *p, const char *word) {
+    return p->discarded + (uint64_t) (word - p->data);
+}
+
+//
+// Sets a function that the parser calls whenever it is about to discard the
+// input scanned so far and read more, which may wait for the input to
+// arrive. Until it returns, the words returned by next_word() are still
+// valid, so words held back to be handled together can be handled before
+// the parser waits.
+//
+// p:           The parser to watch.
+// drain:       The function to call, or a null pointer for none.
+// arg:         The argument to call drain with.
+//
+void parser_set_drain(Parser *p, void (*drain)(void *arg), void *arg) {
+    p->drain = drain;
+    p->drain_arg = arg;
+}
+
+//
+// Discards the input before keep and reads another chunk after what is left.
+// The buffer grows when a single word fills all of it.
+//
+// p:           The parser to refill.
+// keep:        The first byte of input that must be kept.
+// returns:     True if more input was read, false at the end of the input.
+//
+static bool refill(Parser *p, size_t keep) {
+    if (p->eof) {
+        return false;
+    }
+    if (p->drain) {
+        p->drain(p->drain_arg);
+    }
+
+    size_t kept = p->length - keep;
+    memmove(p->data, p->data + keep, kept);
+    p->length = kept;
+    p->position -= keep;
+    p->discarded += keep;
+    p->ascii_end = p->ascii_end > keep ? p->ascii_end - keep : 0;
+
+    if (p->length == p->capacity) {
+        p->capacity *= 2;
+        p->data = (char *) realloc(p->data, p->capacity);
+        if (!p->data) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+
+    for (;;) {
+        ssize_t bytes = read(p->fd, p->data + p->length, p->capacity - p->length);
+        if (bytes > 0) {
+            p->length += bytes;
+            return true;
+        }
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes < 0) {
+            perror("read");
+        }
+        p->eof = true;
+        return false;
+    }
+}
+
+//
+// Grows the buffer that folded words are written to so that it holds at
+// least size bytes.
+//
+// p:           The parser whose buffer to grow.
+// size:        The number of bytes needed.
+//
+static void reserve(Parser *p, size_t size) {
+    if (size > p->folded_capacity) {
+        size_t capacity = p->folded_capacity ? 2 * p->folded_capacity : 256;
+        while (capacity < size) {
+            capacity *= 2;
+        }
+        p->folded = (char *) realloc(p->folded, capacity);
+        if (!p->folded) {
+            perror("realloc");
+            exit(1);
+        }
+        p->folded_capacity = capacity;
+    }
+}
+
+#if defined(__SSE2__)
+//
+// Returns a mask of the bytes of v that lie in [lo, hi]. The bytes are
+// shifted so that the range starts at the smallest signed byte, which turns
+// the two comparisons into one.
+//
+static inline __m128i in_range(__m128i v, char lo, char hi) {
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char) (0x80 - lo)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char) (-128 + (hi - lo) + 1)));
+}
+
+//
+// Classifies 16 bytes at once.
+//
+// data:        The 16 bytes to classify.
+// out:         If not a null pointer, set to the 16 bytes folded to lowercase.
+// wide:        If not a null pointer, set to a mask with bit i set if data[i]
+//              is part of a multibyte character.
+// returns:     A mask with bit i set if data[i] is an ASCII word character.
+//
+static inline uint32_t word_mask(const uint8_t *data, char *out, uint32_t *wide) {
+    __m128i v = _mm_loadu_si128((const __m128i *) data);
+    __m128i upper = in_range(v, 'A', 'Z');
+    __m128i letters = _mm_or_si128(upper, in_range(v, 'a', 'z'));
+    __m128i others = _mm_or_si128(in_range(v, '0', '9'), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    if (out) {
+        _mm_storeu_si128((__m128i *) out, _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20))));
+    }
+    if (wide) {
+        *wide = (uint32_t) _mm_movemask_epi8(v);
+    }
+    return (uint32_t) _mm_movemask_epi8(_mm_or_si128(letters, others));
+}
+#endif
+
+//
+// Returns the first ASCII word character at or after cursor, or end if there
+// is none. Sixteen bytes are skipped at a time where SSE2 is available.
+//
+static size_t skip_ascii_gap(const uint8_t *data, size_t cursor, size_t end) {
+#if defined(__SSE2__)
+    while (cursor + 16 <= end) {
+        uint32_t mask = word_mask(data + cursor, NULL, NULL);
+        if (mask) {
+            return cursor + __builtin_ctz(mask);
+        }
+        cursor += 16;
+    }
+#endif
+    while (cursor < end && !(classes[data[cursor]] & W)) {
+        cursor += 1;
+    }
+    return cursor;
+}
+
+//
+// Returns the end of the run of ASCII word characters at cursor. If fold is
+// true, the run is also written to the folded buffer in lowercase, at its
+// offset from the start of the word past the words folded before it, in the
+// same pass.
+//
+static size_t skip_ascii_run(Parser *p, size_t start, size_t cursor, size_t end, bool fold) {
+    const uint8_t *data = (const uint8_t *) p->data;
+#if defined(__SSE2__)
+    while (cursor + 16 <= end) {
+        char *out = NULL;
+        if (fold) {
+            reserve(p, p->folded_length + cursor - start + 16);
+            out = p->folded + p->folded_length + (cursor - start);
+        }
+        uint32_t mask = word_mask(data + cursor, out, NULL);
+        if (mask != 0xffff) {
+            return cursor + __builtin_ctz(~mask);
+        }
+        cursor += 16;
+    }
+#endif
+    while (cursor < end && (classes[data[cursor]] & W)) {
+        if (fold) {
+            reserve(p, p->folded_length + cursor - start + 1);
+            uint8_t c = data[cursor];
+            p->folded[p->folded_length + cursor - start] = (char) (c >= 'A' && c <= 'Z' ? c | 0x20 : c);
+        }
+        cursor += 1;
+    }
+    return cursor;
+}
+
+//
+// Scans the next word in the input known to be ASCII, which is the common
+// case, so no character has to be decoded. The word must end before
+// ascii_end, since what follows may continue it.
+//
+// p:           The parser to read from.
+// length:      Set to the length of the word.
+// fold:        Whether to write the word to the folded buffer in lowercase.
+// returns:     The next word, or a null pointer if it does not end before
+//              ascii_end, in which case scan_utf8() scans it.
+//
+static inline const char *scan_ascii(Parser *p, uint32_t *length, bool fold) {
+    const uint8_t *data = (const uint8_t *) p->data;
+    size_t end = p->ascii_end;
+    size_t cursor = skip_ascii_gap(data, p->position, end);
+    if (cursor == end) {
+        return NULL;
+    }
+
+    size_t start = cursor;
+    for (;;) {
+        cursor = skip_ascii_run(p, start, cursor, end, fold);
+        if (cursor + 1 < end && (classes[data[cursor]] & J) && (classes[data[cursor + 1]] & W)) {
+            if (fold) {
+                reserve(p, p->folded_length + cursor - start + 1);
+                p->folded[p->folded_length + cursor - start] = (char) data[cursor];
             }
+            cursor += 1;
+            continue;
+        }
+        break;
+    }
+    if (cursor == end || (cursor + 1 == end && (classes[data[cursor]] & J))) {
+        return NULL;
+    }
 
-            char *cursor = buffer;
+    *length = (uint32_t) (cursor - start);
+    p->position = cursor;
+    return p->data + start;
+}
 
-            for (uint16_t i = 0; i < BLOCK; i += 1) {
-                if (regexec(word_regex, cursor, 1, &match, 0)) {
-                    break; // Couldn't find a match.
-                }
+//
+// Classifies the multibyte character at cursor.
+//
+// p:           The parser whose input to read.
+// cursor:      Where the character starts, on a byte past ASCII.
+// end:         The end of the buffered input.
+// size:        Set to the length of the character.
+// c:           Set to the character.
+// returns:     The class of the character, or CUT if the buffered input ends
+//              inside it and more can be read. A byte that does not start a
+//              well-formed character is a character of its own that is not
+//              part of any word.
+//
+static int classify(const Parser *p, size_t cursor, size_t end, size_t *size, uint32_t *c) {
+    *size = utf8_decode(p->data + cursor, end - cursor, c);
+    if (*size == 0) {
+        if (!p->eof) {
+            return CUT;
+        }
+        *size = 1;
+        return CHAR_OTHER;
+    }
+    return *size == 1 ? CHAR_OTHER : (int) utf8_class(*c);
+}
 
-                if (match.rm_so < 0) {
-                    break; // No more matches.
+//
+// Returns the first character at or after cursor that starts a word, or end
+// if there is none. Sixteen bytes of ASCII are skipped at a time where SSE2
+// is available, and only multibyte characters are decoded.
+//
+static size_t skip_gap(const Parser *p, size_t cursor, size_t end) {
+    const uint8_t *data = (const uint8_t *) p->data;
+    for (;;) {
+#if defined(__SSE2__)
+        while (cursor + 16 <= end) {
+            uint32_t wide = 0;
+            uint32_t mask = word_mask(data + cursor, NULL, &wide);
+            if (mask | wide) {
+                uint32_t gap = (uint32_t) __builtin_ctz(mask | wide);
+                cursor += gap;
+                if (mask & (1u << gap)) {
+                    return cursor;
                 }
+                break;
+            }
+            cursor += 16;
+        }
+#endif
+        while (cursor < end && !(classes[data[cursor]] & (W | U))) {
+            cursor += 1;
+        }
+        if (cursor == end || (classes[data[cursor]] & W)) {
+            return cursor;
+        }
+        size_t size = 0;
+        uint32_t c = 0;
+        if (classify(p, cursor, end, &size, &c) != CHAR_OTHER) {
+            return cursor;
+        }
+        cursor += size;
+    }
+}
 
-                uint32_t start = (uint32_t) match.rm_so;
-                uint32_t end = (uint32_t) match.rm_eo;
-                uint32_t length = end - start;
+//
+// Writes the character c to the folded buffer in lowercase, at folded bytes
+// past the start of the word past the words folded before it.
+//
+// returns:     The number of bytes written.
+//
+static size_t fold_char(Parser *p, size_t folded, uint32_t c) {
+    reserve(p, p->folded_length + folded + 4);
+    return utf8_encode(utf8_fold(c), p->folded + p->folded_length + folded);
+}
 
-                words[i] = (char *) calloc(length + 1, sizeof(char));
-                if (!words[i]) {
-                    perror("calloc");
-                    exit(1);
+//
+// Returns the end of the run of word characters at cursor. If fold is true,
+// the run is also written to the folded buffer in lowercase, at folded bytes
+// past the start of the word past the words folded before it, in the same
+// pass, and folded is advanced past it. Folding a multibyte character may
+// change its length, so folded need not keep up with cursor.
+//
+// cut:         Set to true if the run stops at a character the buffered
+//              input ends inside.
+//
+static size_t skip_run(Parser *p, size_t cursor, size_t end, bool fold, size_t *folded, bool *cut) {
+    const uint8_t *data = (const uint8_t *) p->data;
+    size_t out = *folded; // Kept in a local, since the folded bytes written could alias *folded.
+    for (;;) {
+#if defined(__SSE2__)
+        while (cursor + 16 <= end) {
+            char *to = NULL;
+            if (fold) {
+                reserve(p, p->folded_length + out + 16);
+                to = p->folded + p->folded_length + out;
+            }
+            uint32_t wide = 0;
+            uint32_t mask = word_mask(data + cursor, to, &wide);
+            if (mask != 0xffff) {
+                uint32_t run = (uint32_t) __builtin_ctz(~mask);
+                cursor += run;
+                out += run;
+                if (!(wide & (1u << run))) {
+                    *folded = out;
+                    return cursor;
                 }
+                break;
+            }
+            cursor += 16;
+            out += 16;
+        }
+#endif
+        while (cursor < end && (classes[data[cursor]] & W)) {
+            if (fold) {
+                reserve(p, p->folded_length + out + 1);
+                uint8_t c = data[cursor];
+                p->folded[p->folded_length + out] = (char) (c >= 'A' && c <= 'Z' ? c | 0x20 : c);
+            }
+            cursor += 1;
+            out += 1;
+        }
+        if (cursor == end || data[cursor] < 0x80) {
+            break;
+        }
+        size_t size = 0;
+        uint32_t c = 0;
+        int kind = classify(p, cursor, end, &size, &c);
+        if (kind == CUT) {
+            *cut = true;
+        }
+        if (kind != CHAR_WORD) {
+            break;
+        }
+        if (fold) {
+            out += fold_char(p, out, c);
+        }
+        cursor += size;
+    }
+    *folded = out;
+    return cursor;
+}
 
-                memcpy(words[i], cursor + start, length);
-                cursor += end;
-                matches += 1;
+//
+// Returns whether the character at cursor can continue a word after a
+// joining ' or -, setting cut to true if the buffered input ends inside it.
+//
+static bool continues(const Parser *p, size_t cursor, size_t end, bool *cut) {
+    uint8_t b = (uint8_t) p->data[cursor];
+    if (b < 0x80) {
+        return classes[b] & W;
+    }
+    size_t size = 0;
+    uint32_t c = 0;
+    int kind = classify(p, cursor, end, &size, &c);
+    *cut = kind == CUT;
+    return kind == CHAR_WORD;
+}
+
+//
+// Scans the next word in the input, which may hold multibyte characters. The
+// input is scanned in place with the character class table, so no memory is
+// allocated per word, and only the multibyte characters of UTF-8 are
+// decoded. A word that runs into the end of the buffered input is kept and
+// scanned again once the next chunk has been read, so words are never split
+// across chunks.
+//
+// p:           The parser to read from.
+// length:      Set to the length of the word, or of the word as folded if
+//              fold is true.
+// fold:        Whether to write the word to the folded buffer in lowercase.
+// returns:     The next word if it exists, a null pointer otherwise.
+//
+__attribute__((noinline)) static const char *scan_utf8(Parser *p, uint32_t *length, bool fold) {
+    for (;;) {
+        const uint8_t *data = (const uint8_t *) p->data;
+        size_t end = p->length;
+        size_t cursor = skip_gap(p, p->position, end);
+        if (cursor == end) {
+            p->position = cursor;
+            if (!refill(p, cursor)) {
+                return NULL;
             }
+            continue;
+        }
 
-            count = matches; // Words stored is number of matches.
+        size_t start = cursor;
+        size_t folded = 0;
+        bool cut = false;
+        size_t size = 0;
+        uint32_t c = 0;
+        if (data[cursor] >= 0x80 && classify(p, cursor, end, &size, &c) == CHAR_ALONE) {
+            // A character that stands alone is a word by itself
+            if (fold) {
+                folded += fold_char(p, folded, c);
+            }
+            cursor += size;
+        } else {
+            for (;;) {
+                cursor = skip_run(p, cursor, end, fold, &folded, &cut);
+                if (!cut && cursor + 1 < end && (classes[data[cursor]] & J) && continues(p, cursor + 1, end, &cut)) {
+                    if (fold) {
+                        reserve(p, p->folded_length + folded + 1);
+                        p->folded[p->folded_length + folded] = (char) data[cursor];
+                    }
+                    cursor += 1;
+                    folded += 1;
+                    continue;
+                }
+                break;
+            }
         }
+
+        // The word may continue in input that has not been read yet.
+        if (!p->eof && (cut || cursor == end || (cursor + 1 == end && (classes[data[cursor]] & J)))) {
+            p->position = start;
+            refill(p, start);
+            continue;
+        }
+
+        *length = (uint32_t) (fold ? folded : cursor - start);
+        p->position = cursor;
+        return p->data + start;
+    }
+}
+
+//
+// Scans the next word in the input. Ahead of the word, the input is checked
+// ASCII_BLOCK bytes at a time for multibyte characters, and a word that ends
+// within the ASCII checked is scanned by scan_ascii(), so text that is mostly
+// ASCII is scanned as fast as if the parser only knew ASCII.
+//
+// p:           The parser to read from.
+// length:      Set to the length of the word, or of the word as folded if
+//              fold is true.
+// fold:        Whether to write the word to the folded buffer in lowercase.
+// returns:     The next word if it exists, a null pointer otherwise.
+//
+static inline const char *scan(Parser *p, uint32_t *length, bool fold) {
+    if (p->ascii_end < p->position + ASCII_MARGIN) {
+        size_t from = p->ascii_end > p->position ? p->ascii_end : p->position;
+        size_t limit = p->length - from < ASCII_BLOCK ? p->length : from + ASCII_BLOCK;
+        p->ascii_end = from + utf8_ascii_prefix(p->data + from, limit - from);
+    }
+    const char *word = scan_ascii(p, length, fold);
+    return word != NULL ? word : scan_utf8(p, length, fold);
+}
+
+//
+// Returns the next word in the input as a view into the input.
+//
+// p:           The parser to read from.
+// length:      Set to the length of the word.
+// returns:     The next word if it exists, a null pointer otherwise.
+//
+const char *next_word(Parser *p, uint32_t *length) {
+    return scan(p, length, false);
+}
+
+//
+// Returns the next word in the input folded to lowercase.
+//
+// p:           The parser to read from.
+// length:      Set to the length of the word.
+// returns:     The next word if it exists, a null pointer otherwise.
+//
+const char *next_word_lower(Parser *p, uint32_t *length) {
+    const char *word = NULL;
+    return next_words_lower(p, 1, &word, length) ? word : NULL;
+}
+
+//
+// Returns up to n of the next words in the input folded to lowercase. The
+// words are folded one after another into the same buffer, so a batch of
+// words is never copied.
+//
+// p:           The parser to read from.
+// n:           The number of words wanted.
+// words:       Set to the words.
+// lengths:     Set to the lengths of the words.
+// returns:     The number of words, which is less than n only at the end of
+//              the input.
+//
+uint32_t next_words_lower(Parser *p, uint32_t n, const char **words, uint32_t *lengths) {
+    uint32_t count = 0;
+    p->folded_length = 0;
+    while (count < n && scan(p, &lengths[count], true)) {
+        reserve(p, p->folded_length + lengths[count] + 1);
+        p->folded[p->folded_length + lengths[count]] = '\0';
+        p->folded_length += (size_t) lengths[count] + 1;
+        count += 1;
+    }
+    // The buffer may have moved while it grew, so the words are found once it is done.
+    size_t offset = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        words[i] = p->folded + offset;
+        offset += (size_t) lengths[i] + 1;
     }
+    return count;
+}
 
-    char *word = words[index];
-    index = (index + 1) % count;
-    return word;
+//
+// Returns whether more of the input can be read from fd without waiting.
+//
+static bool ready(int fd) {
+    struct pollfd fds = { fd, POLLIN, 0 };
+    return poll(&fds, 1, 0) != 0;
 }
 
 //
-// Clears out the static word buffer.
+// Returns the offset just past the last byte in data[0, length) that cannot
+// be part of a word, or 0 if every byte can.
 //
-void clear_words(void) {
-    for (uint16_t i = 0; i < BLOCK; i += 1) {
-        if (words[i]) {
-            free(words[i]);
-            words[i] = NULL;
+static size_t last_boundary(const char *data, size_t length) {
+    for (size_t i = length; i > 0; i -= 1) {
+        if (!classes[(uint8_t) data[i - 1]]) {
+            return i;
         }
     }
+    return 0;
+}
 
-    return;
+//
+// Returns the next chunk of input. Mapped input is cut at the first word
+// boundary after size bytes. Streamed input is read into a new buffer until
+// it holds size bytes, or until no more of it has arrived and the buffer
+// holds a word boundary, and the bytes after the last word boundary are kept
+// back for the next chunk.
+//
+// p:           The parser to read from.
+// size:        The number of bytes wanted.
+// length:      Set to the length of the chunk.
+// owned:       Set to the buffer to free, or a null pointer for a view.
+// returns:     The next chunk if it exists, a null pointer otherwise.
+//
+const char *next_chunk(Parser *p, size_t size, size_t *length, char **owned) {
+    if (p->eof && !p->capacity) {
+        if (p->position == p->length) {
+            return NULL;
+        }
+        size_t start = p->position;
+        size_t cut = start + size < p->length ? start + size : p->length;
+        while (cut < p->length && classes[(uint8_t) p->data[cut - 1]]) {
+            cut += 1;
+        }
+        p->position = cut;
+        *length = cut - start;
+        *owned = NULL;
+        return p->data + start;
+    }
+
+    size_t kept = p->length - p->position;
+    size_t capacity = size > 2 * kept ? size : 2 * kept;
+    char *chunk = (char *) malloc(capacity);
+    if (!chunk) {
+        perror("malloc");
+        exit(1);
+    }
+    memcpy(chunk, p->data + p->position, kept);
+    size_t filled = kept;
+    p->position = p->length = 0;
+
+    for (;;) {
+        while (!p->eof && filled < size) {
+            ssize_t bytes = read(p->fd, chunk + filled, capacity - filled);
+            if (bytes > 0) {
+                filled += bytes;
+                // Input that trickles in, such as from a pipe, is handed on as it arrives rather than waited for.
+                if (filled < size && !ready(p->fd) && last_boundary(chunk, filled) > 0) {
+                    break;
+                }
+            } else if (bytes < 0 && errno == EINTR) {
+                continue;
+            } else {
+                if (bytes < 0) {
+                    perror("read");
+                }
+                p->eof = true;
+            }
+        }
+
+        size_t cut = p->eof ? filled : last_boundary(chunk, filled);
+        if (cut == 0 && filled > 0 && !p->eof) {
+            // A single word fills the whole chunk, so read more of it.
+            capacity *= 2;
+            size = capacity;
+            chunk = (char *) realloc(chunk, capacity);
+            if (!chunk) {
+                perror("realloc");
+                exit(1);
+            }
+            continue;
+        }
+        if (filled == 0) {
+            free(chunk);
+            return NULL;
+        }
+
+        // Keep what follows the cut for the next chunk.
+        if (filled - cut > p->capacity) {
+            p->capacity = filled - cut;
+            p->data = (char *) realloc(p->data, p->capacity);
+            if (!p->data) {
+                perror("realloc");
+                exit(1);
+            }
+        }
+        memcpy(p->data, chunk + cut, filled - cut);
+        p->length = filled - cut;
+        *length = cut;
+        *owned = chunk;
+        return chunk;
+    }
+}
+
+//
+// Returns the next record of input. A record that runs into the end of the
+// buffered input is kept and searched again once more input has been read.
+//
+// p:           The parser to read from.
+// delimiter:   The byte that ends a record.
+// length:      Set to the length of the record.
+// returns:     The next record if it exists, a null pointer otherwise.
+//
+const char *next_record(Parser *p, char delimiter, size_t *length) {
+    for (;;) {
+        size_t start = p->position;
+        const char *end = p->length > start ? memchr(p->data + start, delimiter, p->length - start) : NULL;
+        if (end) {
+            *length = end - (p->data + start);
+            p->position = end - p->data + 1;
+            return p->data + start;
+        }
+        if (refill(p, start)) {
+            continue;
+        }
+        if (p->position == p->length) {
+            return NULL;
+        }
+        *length = p->length - p->position;
+        start = p->position;
+        p->position = p->length;
+        return p->data + start;
+    }
 }
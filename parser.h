@@ -1,19 +1,137 @@
 #pragma once
 
-#include <regex.h>
-#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
 
+typedef struct Parser Parser;
+
+//
+// Creates a parser that scans words from the specified file descriptor.
+// Regular files are mapped into memory and scanned in place. Anything else
+// (pipes, terminals, sockets) is read in large chunks.
+//
+// fd:          The file descriptor to read from.
+// returns:     The parser, or a null pointer if memory could not be allocated.
+//
+Parser *parser_create(int fd);
+
+//
+// Creates a parser that scans words from a block of memory. The memory is
+// not copied and must outlive the parser.
+//
+// data:        The input to scan.
+// length:      The number of bytes of input.
+// returns:     The parser, or a null pointer if memory could not be allocated.
+//
+Parser *parser_create_buffer(const char *data, size_t length);
+
+//
+// Deletes a parser. The file descriptor is not closed.
+//
+// p:           The parser to delete.
+//
+void parser_delete(Parser **p);
+
+//
+// Returns the offset of a word from the start of the input, which is the
+// start of the file for a mapped file.
+//
+// p:           The parser the word was scanned by.
+// word:        A word returned by next_word() that is still valid.
+// returns:     The offset of the first byte of the word.
+//
+uint64_t parser_offset(Parser *p, const char *word);
+
+//
+// Sets a function that the parser calls whenever it is about to discard the
+// input scanned so far and read more, which may wait for the input to
+// arrive. Until it returns, the words returned by next_word() are still
+// valid, so words held back to be handled together can be handled before
+// the parser waits.
+//
+// p:           The parser to watch.
+// drain:       The function to call, or a null pointer for none.
+// arg:         The argument to call drain with.
 //
-// Returns the next word that matches the specified regular expression.
-// Words are buffered and returned as they are read from the input file.
+void parser_set_drain(Parser *p, void (*drain)(void *arg), void *arg);
+
+//
+// Returns the next word in the input, which is read as UTF-8. A word is a
+// run of word characters, those of the Unicode categories L, M, Nd, Nl and
+// Pc, optionally joined to further runs by single ' or - characters. For
+// ASCII input this is the language of the regular expression
+//
+//     [A-Za-z0-9_]+(('|-)[A-Za-z0-9_]+)*
+//
+// Ideographs and hiragana are words of a single character each, and are
+// never joined to the characters around them. A byte that is not part of
+// valid UTF-8 is read as U+FFFD, which is not a word character.
+//
+// The word is a view into the parser's buffer or the mapped file and is not
+// copied or null terminated. It stays valid until the next call.
+//
+// p:           The parser to read from.
+// length:      Set to the length of the word.
+// returns:     The next word if it exists, a null pointer otherwise.
+//
+const char *next_word(Parser *p, uint32_t *length);
+
+//
+// Returns the next word in the input, like next_word(), with Unicode simple
+// case folding applied to its characters, so a character is never folded to
+// more than one. The word is found and folded in the same pass over the
+// input, sixteen bytes at a time where SSE2 is available, and is written to
+// a null terminated buffer owned by the parser that stays valid until the
+// next call.
 //
-// infile:      The input file to read from.
-// word_regex:  The compiled regular expression for a word.
+// p:           The parser to read from.
+// length:      Set to the length of the folded word, which may differ from
+//              its length in the input.
 // returns:     The next word if it exists, a null pointer otherwise.
 //
-char *next_word(FILE *infile, regex_t *word_regex);
+const char *next_word_lower(Parser *p, uint32_t *length);
 
 //
-// Clears out the static word buffer.
+// Returns up to n of the next words in the input, like n calls to
+// next_word_lower(), so that they can be looked up together. The words are
+// null terminated, are in a buffer owned by the parser, and stay valid until
+// the next call.
+//
+// p:           The parser to read from.
+// n:           The number of words wanted.
+// words:       Set to the words.
+// lengths:     Set to the lengths of the words.
+// returns:     The number of words, which is less than n only at the end of
+//              the input.
+//
+uint32_t next_words_lower(Parser *p, uint32_t n, const char **words, uint32_t *lengths);
+
+//
+// Returns the next chunk of input. A chunk holds at least size bytes unless
+// the input ends first or has stopped arriving for now, and it always ends on a byte that cannot be part of
+// a word, so chunks can be scanned independently of each other. Chunks of a
+// mapped file are views into the mapping. Otherwise the chunk is read into a
+// new buffer that the caller must free. A parser should be read either by
+// word or by chunk, not both.
+//
+// p:           The parser to read from.
+// size:        The number of bytes wanted.
+// length:      Set to the length of the chunk.
+// owned:       Set to the buffer to free, or a null pointer for a view.
+// returns:     The next chunk if it exists, a null pointer otherwise.
+//
+const char *next_chunk(Parser *p, size_t size, size_t *length, char **owned);
+
+//
+// Returns the next record of input. Records are separated by the delimiter,
+// which is not part of the record, and the last record need not end with
+// one. The record is a view into the parser's buffer or the mapped file and
+// stays valid until the next call. A parser should be read either by record
+// or by word, not both.
+//
+// p:           The parser to read from.
+// delimiter:   The byte that ends a record.
+// length:      Set to the length of the record.
+// returns:     The next record if it exists, a null pointer otherwise.
 //
-void clear_words(void);
+const char *next_record(Parser *p, char delimiter, size_t *length);
@@ -0,0 +1,101 @@
+#include "queue.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+struct Queue {
+    uint32_t capacity;
+    uint32_t head; // Index of the next item to pop.
+    uint32_t size;
+    bool closed;
+    void **items;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+};
+
+// This function is the constructor for a bounded queue that is safe to share between threads.
+// This function takes in as a parameter a uint32_t capacity which is the number of items the queue holds before
+// queue_push() blocks.
+// This function returns the created Queue, or NULL if memory could not be allocated.
+Queue *queue_create(uint32_t capacity) {
+    Queue *q = (Queue *) malloc(sizeof(Queue));
+    if (q) {
+        q->capacity = capacity;
+        q->head = 0;
+        q->size = 0;
+        q->closed = false;
+        q->items = (void **) calloc(capacity, sizeof(void *));
+        if (!q->items) {
+            free(q);
+            return NULL;
+        }
+        pthread_mutex_init(&q->lock, NULL);
+        pthread_cond_init(&q->not_empty, NULL);
+        pthread_cond_init(&q->not_full, NULL);
+    }
+    return q;
+}
+
+// This function is the destructor for a queue. Items still in the queue are not freed.
+// This function takes in as a parameter a double pointer to the Queue q.
+void queue_delete(Queue **q) {
+    pthread_mutex_destroy(&(*q)->lock);
+    pthread_cond_destroy(&(*q)->not_empty);
+    pthread_cond_destroy(&(*q)->not_full);
+    free((*q)->items);
+    free(*q);
+    *q = NULL;
+}
+
+// This function adds item to the back of the queue, waiting while the queue is full. Returns false if the queue
+// has been closed. Otherwise, returns true.
+// This function takes in as parameters a Queue q and a void item.
+bool queue_push(Queue *q, void *item) {
+    pthread_mutex_lock(&q->lock);
+    while (q->size == q->capacity && !q->closed) {
+        pthread_cond_wait(&q->not_full, &q->lock);
+    }
+    if (q->closed) {
+        pthread_mutex_unlock(&q->lock);
+        return false;
+    }
+    q->items[(q->head + q->size) % q->capacity] = item;
+    q->size = q->size + 1;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return true;
+}
+
+// This function removes the item at the front of the queue, waiting while the queue is empty. Returns false once
+// the queue has been closed and emptied. Otherwise, returns true.
+// This function takes in as parameters a Queue q and a double pointer to the void item to fill in.
+bool queue_pop(Queue *q, void **item) {
+    pthread_mutex_lock(&q->lock);
+    while (q->size == 0 && !q->closed) {
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    }
+    if (q->size == 0) {
+        pthread_mutex_unlock(&q->lock);
+        return false;
+    }
+    *item = q->items[q->head];
+    q->head = (q->head + 1) % q->capacity;
+    q->size = q->size - 1;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return true;
+}
+
+// This function closes the queue. Waiting threads are woken up, queue_push() fails from now on, and queue_pop()
+// fails once the items left in the queue have been removed.
+// This function takes in as a parameter a Queue q.
+void queue_close(Queue *q) {
+    pthread_mutex_lock(&q->lock);
+    q->closed = true;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+}
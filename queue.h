@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct Queue Queue;
+
+Queue *queue_create(uint32_t capacity);
+
+void queue_delete(Queue **q);
+
+bool queue_push(Queue *q, void *item);
+
+bool queue_pop(Queue *q, void **item);
+
+void queue_close(Queue *q);
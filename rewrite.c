@@ -0,0 +1,265 @@
+#include "rewrite.h"
+#include "dict.h"
+#include "parser.h"
+#include "stats.h"
+#include "utf8.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define REWRITE_CHUNK (1 << 20) // Bytes of input rewritten at a time.
+#define REWRITE_IOV   1024 // Spans written by one writev(), which is the least IOV_MAX Linux allows.
+#define SCRATCH_SIZE  (1 << 16) // Bytes of replacements held until they are written.
+
+// The output of a rewrite. Spans of the input that are copied unchanged are not copied at all: they are gathered
+// as iovecs pointing into the input, next to the replacements written into the scratch buffer, and written with a
+// single writev() per REWRITE_IOV spans or per chunk of input.
+typedef struct {
+    int fd;
+    struct iovec iov[REWRITE_IOV];
+    int count; // Number of spans gathered.
+    char *scratch;
+    size_t used; // Bytes of the scratch buffer the gathered spans use.
+    size_t capacity;
+    bool failed;
+} Output;
+
+// This function is a helper function that writes the spans gathered so far, however many calls to writev() that
+// takes, and then forgets them.
+// Returns false if the output could not be written.
+static bool flush(Output *o) {
+    struct iovec *iov = o->iov;
+    int count = o->count;
+    while (count > 0 && !o->failed) {
+        ssize_t written = writev(o->fd, iov, count);
+        if (written < 0) {
+            o->failed = errno != EINTR;
+            continue;
+        }
+        while (count > 0 && (size_t) written >= iov->iov_len) {
+            written -= (ssize_t) iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *) iov->iov_base + written;
+            iov->iov_len -= (size_t) written;
+        }
+    }
+    o->count = 0;
+    o->used = 0;
+    return !o->failed;
+}
+
+// This function is a helper function that gathers length bytes of data, which must stay valid until the next
+// flush(), to be written.
+static void emit(Output *o, const char *data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    if (o->count == REWRITE_IOV) {
+        flush(o);
+    }
+    o->iov[o->count].iov_base = (void *) data;
+    o->iov[o->count].iov_len = length;
+    o->count = o->count + 1;
+}
+
+// This function is a helper function that reserves length bytes of the scratch buffer for a replacement and
+// gathers them to be written. The buffer is only grown once the spans pointing into it are written.
+// Returns the bytes to fill in, or NULL if memory could not be allocated.
+static char *reserve(Output *o, size_t length) {
+    if (o->used + length > o->capacity || o->count == REWRITE_IOV) {
+        flush(o);
+    }
+    if (length > o->capacity) {
+        char *grown = (char *) realloc(o->scratch, length);
+        if (grown == NULL) {
+            return NULL;
+        }
+        o->scratch = grown;
+        o->capacity = length;
+    }
+    char *out = o->scratch + o->used;
+    o->used += length;
+    emit(o, out, length);
+    return out;
+}
+
+// This function is a helper function that gives back the end of the replacement last reserved, keeping only its
+// first length bytes.
+static void settle(Output *o, size_t length) {
+    size_t reserved = o->iov[o->count - 1].iov_len;
+    o->iov[o->count - 1].iov_len = length;
+    o->used = o->used - reserved + length;
+    if (length == 0) {
+        o->count = o->count - 1;
+    }
+}
+
+// This function is a helper function that writes the replacement of a word of the input found in the dictionary.
+// Oldspeak becomes its newspeak, cased like the word: in capitals if every cased letter of the word is, which takes
+// two letters or more, or else with a capital first letter if the word starts with one. Badspeak is masked as mask
+// says, a character at a time, however many bytes the character takes.
+// Returns false if memory could not be allocated.
+static bool replace(Output *o, const char *word, uint32_t length, const Entry *e, RewriteMask mask) {
+    if (mask == MASK_KEEP && e->newspeak == NULL) {
+        emit(o, word, length);
+        return true;
+    }
+    if (mask == MASK_DROP && e->newspeak == NULL) {
+        return true;
+    }
+
+    // Counting the characters of the word, its cased letters and the capitals among them
+    uint32_t characters = 0;
+    uint32_t letters = 0;
+    uint32_t capitals = 0;
+    size_t first = 0; // Bytes of the first character.
+    bool initial = false; // Whether the first character is a capital.
+    for (size_t i = 0; i < length; characters++) {
+        uint32_t c = 0;
+        size_t size = utf8_decode(word + i, length - i, &c);
+        size = size > 0 ? size : length - i;
+        bool capital = utf8_fold(c) != c;
+        letters = letters + (capital || utf8_upper(c) != c);
+        capitals = capitals + capital;
+        if (i == 0) {
+            first = size;
+            initial = capital;
+        }
+        i += size;
+    }
+
+    if (e->newspeak != NULL) {
+        // Casing the newspeak a character at a time, which uppercasing can lengthen by half
+        size_t n = strlen(e->newspeak);
+        char *out = reserve(o, 2 * n);
+        if (out == NULL) {
+            return false;
+        }
+        bool shout = letters > 1 && capitals == letters;
+        size_t written = 0;
+        for (size_t i = 0; i < n;) {
+            uint32_t c = 0;
+            size_t size = utf8_decode(e->newspeak + i, n - i, &c);
+            bool valid = size > 1 || (size == 1 && (unsigned char) e->newspeak[i] < 0x80);
+            if (!valid || !(shout || (initial && i == 0))) {
+                size = size > 0 ? size : n - i;
+                memcpy(out + written, e->newspeak + i, size);
+                written += size;
+            } else {
+                written += utf8_encode(utf8_upper(c), out + written);
+            }
+            i += size;
+        }
+        settle(o, written);
+        return true;
+    }
+
+    char *out = reserve(o, length);
+    if (out == NULL) {
+        return false;
+    }
+    size_t kept = mask == MASK_FIRST ? first : 0;
+    memcpy(out, word, kept);
+    memset(out + kept, '*', characters - (kept > 0));
+    settle(o, kept + characters - (kept > 0));
+    return true;
+}
+
+// This function is a helper function that rewrites a chunk of input, which must end on a byte that cannot be part
+// of a word. The words are scanned and looked up DICT_BATCH at a time, like filter_words() in banhammer.c, and the
+// bytes between the words found are gathered unchanged.
+// Returns false if memory could not be allocated.
+static bool rewrite_chunk(Output *o, const char *chunk, size_t length, Dictionary *dict, RewriteMask mask,
+    char **folded, size_t *capacity) {
+    Parser *parser = parser_create_buffer(chunk, length);
+    if (parser == NULL) {
+        return false;
+    }
+    const char *words[DICT_BATCH];
+    uint32_t lengths[DICT_BATCH];
+    Entry e[DICT_BATCH];
+    bool found[DICT_BATCH];
+    uint32_t count = DICT_BATCH;
+    const char *copied = chunk; // End of the input gathered so far.
+    bool rewritten = true;
+    bool timed = stats_enabled();
+    uint64_t start = timed ? stats_now() : 0;
+    while (rewritten && count == DICT_BATCH) {
+        // Scanning a batch of words, and looking up case folded copies of them
+        count = 0;
+        while (count < DICT_BATCH && (words[count] = next_word(parser, &lengths[count])) != NULL) {
+            count = count + 1;
+        }
+        if (count == 0) {
+            break;
+        }
+        uint64_t scanned = timed ? stats_now() : 0;
+        stats_add(STAT_TOKENS, count);
+        if (!dict_lookup_views(dict, words, lengths, count, folded, capacity, e, found)) {
+            rewritten = false;
+            break;
+        }
+
+        // Gathering the input up to each word found, and then its replacement
+        for (uint32_t i = 0; i < count && rewritten; i++) {
+            if (found[i]) {
+                emit(o, copied, (size_t) (words[i] - copied));
+                rewritten = replace(o, words[i], lengths[i], &e[i], mask);
+                copied = words[i] + lengths[i];
+            }
+        }
+        if (timed) {
+            uint64_t looked_up = stats_now();
+            stats_add(STAT_SCAN_NS, scanned - start);
+            stats_add(STAT_LOOKUP_NS, looked_up - scanned);
+            stats_record(STAT_BATCH_NS, looked_up - scanned);
+            start = looked_up;
+        }
+    }
+    emit(o, copied, (size_t) (chunk + length - copied));
+    parser_delete(&parser);
+    return rewritten;
+}
+
+// This function streams the input of parser to the file descriptor fd with every word found in the dictionary
+// replaced: oldspeak by its newspeak, and badspeak masked as mask says. Every other byte of the input is written as
+// it is. The input is read a chunk at a time, and each chunk is written once it is rewritten, with the unchanged
+// spans written straight from the input rather than copied.
+// Returns false after printing why if the input could not be rewritten or the output could not be written.
+// This function takes in as parameters a Parser parser, the Dictionary dict, the RewriteMask mask, and the int fd
+// to write to.
+bool rewrite_text(Parser *parser, Dictionary *dict, RewriteMask mask, int fd) {
+    Output o;
+    memset(&o, 0, sizeof(o));
+    o.fd = fd;
+    o.scratch = (char *) malloc(SCRATCH_SIZE);
+    o.capacity = SCRATCH_SIZE;
+    char *folded = NULL;
+    size_t capacity = 0;
+    bool rewritten = o.scratch != NULL;
+    const char *chunk = NULL;
+    size_t length = 0;
+    char *owned = NULL;
+    while (rewritten && !o.failed && (chunk = next_chunk(parser, REWRITE_CHUNK, &length, &owned)) != NULL) {
+        rewritten = rewrite_chunk(&o, chunk, length, dict, mask, &folded, &capacity);
+        flush(&o);
+        free(owned);
+    }
+    if (!rewritten) {
+        fprintf(stderr, "Failed to allocate memory.\n");
+    } else if (o.failed) {
+        perror("write");
+    }
+    free(folded);
+    free(o.scratch);
+    return rewritten && !o.failed;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "dict.h"
+#include "parser.h"
+
+#include <stdbool.h>
+
+// How rewrite_text() masks a badspeak word, which has no newspeak to replace it with.
+typedef enum {
+    MASK_STARS, // Every character becomes *.
+    MASK_FIRST, // The first character is kept and the rest become *.
+    MASK_DROP, // The word is removed.
+    MASK_KEEP // The word is left as it is.
+} RewriteMask;
+
+bool rewrite_text(Parser *parser, Dictionary *dict, RewriteMask mask, int fd);
@@ -14,20 +14,28 @@
 // Core SPECK operation
 #define R(x, y, k) (x = RCS(x, 8), x += y, x ^= k, y = LCS(y, 3), y ^= x)
 
-void speck_expand_key_and_encrypt(uint64_t pt[], uint64_t ct[], uint64_t K[]) {
+// Runs the SPECK key schedule once so that the round keys can be reused for every block hashed with the key.
+void speck_expand_key(uint64_t K[], uint64_t rk[]) {
     uint64_t B = K[1], A = K[0];
-    ct[0] = pt[0];
-    ct[1] = pt[1];
 
-    for (size_t i = 0; i < 32; i += 1) {
-        R(ct[1], ct[0], A);
+    for (size_t i = 0; i < SPECK_ROUNDS; i += 1) {
+        rk[i] = A;
         R(B, A, i);
     }
 }
 
-static uint64_t keyed_hash(const char *s, uint32_t length, uint64_t key[]) {
-    uint64_t accum = 0;
+// Encrypts one 128-bit block with round keys produced by speck_expand_key().
+void speck_encrypt(uint64_t pt[], uint64_t ct[], uint64_t rk[]) {
+    ct[0] = pt[0];
+    ct[1] = pt[1];
+
+    for (size_t i = 0; i < SPECK_ROUNDS; i += 1) {
+        R(ct[1], ct[0], rk[i]);
+    }
+}
 
+// Hashes length bytes of s into a 128-bit digest using the expanded key rk.
+void speck_keyed_hash(const char *s, uint32_t length, uint64_t rk[], uint64_t digest[]) {
     union {
         char b[2 * sizeof(uint64_t)]; // 16 bytes fit into the same space as
         uint64_t ll[2]; // 2 64 bit numbers.
@@ -36,6 +44,9 @@ static uint64_t keyed_hash(const char *s, uint32_t length, uint64_t key[]) {
     uint64_t out[2]; // Speck results in 128 bits of ciphertext
     uint32_t count;
 
+    digest[0] = 0x0;
+    digest[1] = 0x0;
+
     count = 0; // Reset buffer counter
     in.ll[0] = 0x0;
     in.ll[1] = 0x0; // Reset the input buffer (zero fill)
@@ -44,8 +55,9 @@ static uint64_t keyed_hash(const char *s, uint32_t length, uint64_t key[]) {
         in.b[count++] = s[i]; // Load the bytes
 
         if (count % (2 * sizeof(uint64_t)) == 0) {
-            speck_expand_key_and_encrypt(in.ll, out, key); // Encrypt 16 bytes
-            accum ^= out[0] ^ out[1]; // Add (XOR) them in for a 64 bit result
+            speck_encrypt(in.ll, out, rk); // Encrypt 16 bytes
+            digest[0] ^= out[0]; // Add (XOR) them in
+            digest[1] ^= out[1];
             count = 0; // Reset buffer counter
             in.ll[0] = 0x0;
             in.ll[1] = 0x0; // Reset the input buffer
@@ -54,11 +66,10 @@ static uint64_t keyed_hash(const char *s, uint32_t length, uint64_t key[]) {
 
     // There may be some bytes left over, we should use them.
     if (length % (2 * sizeof(uint64_t)) != 0) {
-        speck_expand_key_and_encrypt(in.ll, out, key);
-        accum ^= out[0] ^ out[1];
+        speck_encrypt(in.ll, out, rk);
+        digest[0] ^= out[0];
+        digest[1] ^= out[1];
     }
-
-    return accum;
 }
 
 uint32_t hash(uint64_t *salt, char *key) {
@@ -67,7 +78,12 @@ uint32_t hash(uint64_t *salt, char *key) {
         uint32_t half[2];
     } value;
 
-    value.full = keyed_hash(key, strlen(key), salt);
+    uint64_t rk[SPECK_ROUNDS];
+    uint64_t digest[2];
+
+    speck_expand_key(salt, rk);
+    speck_keyed_hash(key, strlen(key), rk, digest);
+    value.full = digest[0] ^ digest[1];
 
     return value.half[0] ^ value.half[1];
 }
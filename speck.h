@@ -2,4 +2,12 @@
 
 #include <stdint.h>
 
+#define SPECK_ROUNDS 32
+
+void speck_expand_key(uint64_t K[], uint64_t rk[]);
+
+void speck_encrypt(uint64_t pt[], uint64_t ct[], uint64_t rk[]);
+
+void speck_keyed_hash(const char *s, uint32_t length, uint64_t rk[], uint64_t digest[]);
+
 uint32_t hash(uint64_t *salt, char *key);
@@ -0,0 +1,231 @@
+#include "stats.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Histograms are HDR style: each value below HIST_SUB has a bucket of its own, and every power of two above that is
+// split into HIST_SUB buckets, so a value is recorded to within 1/HIST_SUB of itself whatever its magnitude, in a
+// fixed number of buckets.
+#define HIST_SUB_BITS 5
+#define HIST_SUB      (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS  ((64 - HIST_SUB_BITS + 1) << HIST_SUB_BITS)
+
+typedef struct {
+    _Atomic uint64_t buckets[HIST_BUCKETS];
+    _Atomic uint64_t sum;
+    _Atomic uint64_t max;
+} Histogram;
+
+// The statistics of one thread. Only the thread writes them, with relaxed atomics, so that stats_total() can read
+// them at any time without a lock on the hot path.
+struct Stats {
+    _Atomic uint64_t counters[STAT_COUNTERS];
+    Histogram histograms[STAT_HISTOGRAMS];
+    Stats *next; // Next block of the registry.
+};
+
+_Thread_local _Atomic uint64_t *stats_counters = NULL;
+
+static _Thread_local Stats *self = NULL;
+
+static atomic_bool enabled = false;
+
+// Every block handed out, including those of threads that have exited, so their counts are not lost.
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static Stats *registry = NULL;
+
+static const char *counter_names[STAT_COUNTERS] = { "tokens", "bf_negatives", "bf_positives", "table_hits",
+    "lookups", "branches", "scan_ns", "lookup_ns", "automaton_ns" };
+
+static const char *histogram_names[STAT_HISTOGRAMS] = { "batch_ns", "record_ns", "request_ns" };
+
+// This function is a helper function that adds n to a value only the calling thread writes.
+static inline void bump(_Atomic uint64_t *x, uint64_t n) {
+    atomic_store_explicit(x, atomic_load_explicit(x, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// This function turns on the collection of statistics for the program and attaches the calling thread. Statistics
+// are off until it is called, and cost a test of a thread-local pointer per update while they are.
+void stats_enable(void) {
+    atomic_store(&enabled, true);
+    stats_attach();
+}
+
+// This function gives the calling thread a block of its own to count into, if statistics are enabled. Every thread
+// that should be counted calls it once when it starts; threads that do not are not counted.
+void stats_attach(void) {
+    if (!atomic_load(&enabled) || self != NULL) {
+        return;
+    }
+    Stats *s = (Stats *) calloc(1, sizeof(Stats));
+    if (s == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&registry_lock);
+    s->next = registry;
+    registry = s;
+    pthread_mutex_unlock(&registry_lock);
+    self = s;
+    stats_counters = s->counters;
+}
+
+// This function returns the time of the monotonic clock in nanoseconds.
+uint64_t stats_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + (uint64_t) t.tv_nsec;
+}
+
+// This function is a helper function that returns the bucket of a histogram that value is recorded in.
+static uint32_t bucket_of(uint64_t value) {
+    if (value < HIST_SUB) {
+        return (uint32_t) value;
+    }
+    uint32_t e = 63 - (uint32_t) __builtin_clzll(value);
+    return ((e - HIST_SUB_BITS + 1) << HIST_SUB_BITS) + (uint32_t) ((value >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+// This function is a helper function that returns the largest value recorded in bucket b of a histogram.
+static uint64_t bucket_top(uint32_t b) {
+    if (b < HIST_SUB) {
+        return b;
+    }
+    uint32_t shift = (b >> HIST_SUB_BITS) - 1;
+    return (((uint64_t) (HIST_SUB + (b & (HIST_SUB - 1)))) << shift) + ((UINT64_C(1) << shift) - 1);
+}
+
+// This function records value, usually a latency in nanoseconds, in a histogram of the calling thread, if it
+// collects statistics.
+// This function takes in as parameters the StatHistogram h and the uint64_t value.
+void stats_record(StatHistogram h, uint64_t value) {
+    if (self == NULL) {
+        return;
+    }
+    Histogram *histogram = &self->histograms[h];
+    bump(&histogram->buckets[bucket_of(value)], 1);
+    bump(&histogram->sum, value);
+    if (value > atomic_load_explicit(&histogram->max, memory_order_relaxed)) {
+        atomic_store_explicit(&histogram->max, value, memory_order_relaxed);
+    }
+}
+
+// This function adds up the statistics of every thread counted so far. It can be called at any time, from any
+// thread, while the other threads keep counting; each value read is one the thread wrote.
+// This function returns the totals, which must be deleted with stats_delete(), or NULL if memory could not be
+// allocated.
+Stats *stats_total(void) {
+    Stats *total = (Stats *) calloc(1, sizeof(Stats));
+    if (total == NULL) {
+        return NULL;
+    }
+    pthread_mutex_lock(&registry_lock);
+    for (Stats *s = registry; s != NULL; s = s->next) {
+        for (uint32_t c = 0; c < STAT_COUNTERS; c++) {
+            bump(&total->counters[c], atomic_load_explicit(&s->counters[c], memory_order_relaxed));
+        }
+        for (uint32_t h = 0; h < STAT_HISTOGRAMS; h++) {
+            Histogram *from = &s->histograms[h];
+            Histogram *into = &total->histograms[h];
+            for (uint32_t b = 0; b < HIST_BUCKETS; b++) {
+                bump(&into->buckets[b], atomic_load_explicit(&from->buckets[b], memory_order_relaxed));
+            }
+            bump(&into->sum, atomic_load_explicit(&from->sum, memory_order_relaxed));
+            uint64_t max = atomic_load_explicit(&from->max, memory_order_relaxed);
+            if (max > atomic_load_explicit(&into->max, memory_order_relaxed)) {
+                atomic_store_explicit(&into->max, max, memory_order_relaxed);
+            }
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return total;
+}
+
+// This function is the destructor for totals returned by stats_total().
+// This function takes in as a parameter a double pointer to the Stats s.
+void stats_delete(Stats **s) {
+    free(*s);
+    *s = NULL;
+}
+
+// This function frees the block of every thread and turns statistics off. No thread but the caller may be counting.
+void stats_clear(void) {
+    pthread_mutex_lock(&registry_lock);
+    while (registry != NULL) {
+        Stats *next = registry->next;
+        free(registry);
+        registry = next;
+    }
+    pthread_mutex_unlock(&registry_lock);
+    atomic_store(&enabled, false);
+    self = NULL;
+    stats_counters = NULL;
+}
+
+// This function returns a counter of the totals s.
+uint64_t stats_get(Stats *s, StatCounter c) {
+    return atomic_load_explicit(&s->counters[c], memory_order_relaxed);
+}
+
+// This function returns the number of values recorded in a histogram of the totals s.
+uint64_t stats_count(Stats *s, StatHistogram h) {
+    uint64_t count = 0;
+    for (uint32_t b = 0; b < HIST_BUCKETS; b++) {
+        count += atomic_load_explicit(&s->histograms[h].buckets[b], memory_order_relaxed);
+    }
+    return count;
+}
+
+// This function returns the p-th percentile, for p from 0 to 100, of a histogram of the totals s: the largest value
+// of the bucket that holds it, but never more than the largest value recorded. Returns 0 if the histogram is empty.
+uint64_t stats_percentile(Stats *s, StatHistogram h, double p) {
+    Histogram *histogram = &s->histograms[h];
+    uint64_t count = stats_count(s, h);
+    uint64_t rank = (uint64_t) ceil(p / 100 * (double) count);
+    rank = rank < 1 ? 1 : rank;
+    uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < HIST_BUCKETS && count > 0; b++) {
+        seen += atomic_load_explicit(&histogram->buckets[b], memory_order_relaxed);
+        if (seen >= rank) {
+            return bucket_top(b) < max ? bucket_top(b) : max;
+        }
+    }
+    return count > 0 ? max : 0;
+}
+
+// This function returns the false positive rate of the Bloom filter measured on the words looked up: the fraction
+// of the words the table does not hold that the filter let through anyway. Returns 0 if no such word was looked up.
+double stats_bf_fpr(Stats *s) {
+    uint64_t passed = stats_get(s, STAT_BF_POSITIVES) - stats_get(s, STAT_TABLE_HITS);
+    uint64_t absent = stats_get(s, STAT_BF_NEGATIVES) + passed;
+    return absent > 0 ? (double) passed / absent : 0.0;
+}
+
+// This function prints the totals s as a JSON object of the counters, the measured false positive rate of the Bloom
+// filter, and the count, mean, percentiles and maximum of each histogram.
+// This function takes in as parameters the FILE out to print to and the Stats s.
+void stats_print_json(FILE *out, Stats *s) {
+    fprintf(out, "{\"counters\":{");
+    for (uint32_t c = 0; c < STAT_COUNTERS; c++) {
+        fprintf(out, "%s\"%s\":%" PRIu64, c == 0 ? "" : ",", counter_names[c], stats_get(s, c));
+    }
+    fprintf(out, "},\"bf_false_positive_rate\":%.6g,\"histograms\":{", stats_bf_fpr(s));
+    for (uint32_t h = 0; h < STAT_HISTOGRAMS; h++) {
+        uint64_t count = stats_count(s, h);
+        uint64_t sum = atomic_load_explicit(&s->histograms[h].sum, memory_order_relaxed);
+        fprintf(out, "%s\"%s\":{\"count\":%" PRIu64 ",\"mean\":%.1f", h == 0 ? "" : ",", histogram_names[h], count,
+            count > 0 ? (double) sum / count : 0.0);
+        fprintf(out, ",\"p50\":%" PRIu64 ",\"p90\":%" PRIu64 ",\"p99\":%" PRIu64 ",\"p999\":%" PRIu64,
+            stats_percentile(s, h, 50), stats_percentile(s, h, 90), stats_percentile(s, h, 99),
+            stats_percentile(s, h, 99.9));
+        fprintf(out, ",\"max\":%" PRIu64 "}", atomic_load_explicit(&s->histograms[h].max, memory_order_relaxed));
+    }
+    fprintf(out, "}}");
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum {
+    STAT_TOKENS, // Words scanned.
+    STAT_BF_NEGATIVES, // Words the Bloom filter ruled out.
+    STAT_BF_POSITIVES, // Words the Bloom filter let through to the table.
+    STAT_TABLE_HITS, // Words the table holds.
+    STAT_LOOKUPS, // Hash table lookups and inserts, and entries matched by the automaton.
+    STAT_BRANCHES, // Tree branches or probe steps taken by the lookups and inserts.
+    STAT_SCAN_NS, // Time spent scanning words.
+    STAT_LOOKUP_NS, // Time spent looking words up.
+    STAT_AUTOMATON_NS, // Time spent running the automaton.
+    STAT_COUNTERS
+} StatCounter;
+
+typedef enum {
+    STAT_BATCH_NS, // Latency of looking up a batch of words.
+    STAT_RECORD_NS, // Latency of filtering a record.
+    STAT_REQUEST_NS, // Latency of answering a request.
+    STAT_HISTOGRAMS
+} StatHistogram;
+
+typedef struct Stats Stats;
+
+extern _Thread_local _Atomic uint64_t *stats_counters;
+
+// Adds n to a counter of the calling thread, if it collects statistics. Only the thread writes its counters, so a
+// relaxed load and store is enough for stats_total() to read them from another thread.
+static inline void stats_add(StatCounter c, uint64_t n) {
+    _Atomic uint64_t *counters = stats_counters;
+    if (counters != NULL) {
+        atomic_store_explicit(
+            &counters[c], atomic_load_explicit(&counters[c], memory_order_relaxed) + n, memory_order_relaxed);
+    }
+}
+
+// Returns whether the calling thread collects statistics, so that callers only read the clock when they do.
+static inline bool stats_enabled(void) {
+    return stats_counters != NULL;
+}
+
+void stats_enable(void);
+
+void stats_attach(void);
+
+uint64_t stats_now(void);
+
+void stats_record(StatHistogram h, uint64_t value);
+
+Stats *stats_total(void);
+
+void stats_delete(Stats **s);
+
+void stats_clear(void);
+
+uint64_t stats_get(Stats *s, StatCounter c);
+
+uint64_t stats_count(Stats *s, StatHistogram h);
+
+uint64_t stats_percentile(Stats *s, StatHistogram h, double p);
+
+double stats_bf_fpr(Stats *s);
+
+void stats_print_json(FILE *out, Stats *s);
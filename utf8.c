@@ -0,0 +1,548 @@
+#include "utf8.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define REPLACEMENT 0xFFFD // What a byte that does not start a valid character decodes to.
+
+// A range of code points, from first to last.
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+} Span;
+
+// A range of code points mapped to other code points by adding delta to every stride-th one from first.
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+    int32_t delta;
+    uint32_t stride;
+} Mapping;
+
+// The characters that stand alone: ideographs and iteration marks, and hiragana.
+static const Span alone_spans[] = {
+    { 0x3005, 0x3007 }, { 0x3041, 0x3096 }, { 0x309D, 0x309F }, { 0x3400, 0x4DBF },
+    { 0x4E00, 0x9FFF }, { 0xF900, 0xFAFF }, { 0x1B001, 0x1B11F }, { 0x20000, 0x2FA1F },
+    { 0x30000, 0x323AF },
+};
+
+// The other word characters past ASCII: the letters (L), marks (M), decimal and letter numbers (Nd and Nl) and
+// connector punctuation (Pc) of Unicode 14.0, which are the characters Unicode word boundaries keep inside words.
+static const Span word_spans[] = {
+    { 0x00AA, 0x00AA }, { 0x00B5, 0x00B5 }, { 0x00BA, 0x00BA }, { 0x00C0, 0x00D6 },
+    { 0x00D8, 0x00F6 }, { 0x00F8, 0x02C1 }, { 0x02C6, 0x02D1 }, { 0x02E0, 0x02E4 },
+    { 0x02EC, 0x02EC }, { 0x02EE, 0x02EE }, { 0x0300, 0x0374 }, { 0x0376, 0x0377 },
+    { 0x037A, 0x037D }, { 0x037F, 0x037F }, { 0x0386, 0x0386 }, { 0x0388, 0x038A },
+    { 0x038C, 0x038C }, { 0x038E, 0x03A1 }, { 0x03A3, 0x03F5 }, { 0x03F7, 0x0481 },
+    { 0x0483, 0x052F }, { 0x0531, 0x0556 }, { 0x0559, 0x0559 }, { 0x0560, 0x0588 },
+    { 0x0591, 0x05BD }, { 0x05BF, 0x05BF }, { 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 },
+    { 0x05C7, 0x05C7 }, { 0x05D0, 0x05EA }, { 0x05EF, 0x05F2 }, { 0x0610, 0x061A },
+    { 0x0620, 0x0669 }, { 0x066E, 0x06D3 }, { 0x06D5, 0x06DC }, { 0x06DF, 0x06E8 },
+    { 0x06EA, 0x06FC }, { 0x06FF, 0x06FF }, { 0x0710, 0x074A }, { 0x074D, 0x07B1 },
+    { 0x07C0, 0x07F5 }, { 0x07FA, 0x07FA }, { 0x07FD, 0x07FD }, { 0x0800, 0x082D },
+    { 0x0840, 0x085B }, { 0x0860, 0x086A }, { 0x0870, 0x0887 }, { 0x0889, 0x088E },
+    { 0x0898, 0x08E1 }, { 0x08E3, 0x0963 }, { 0x0966, 0x096F }, { 0x0971, 0x0983 },
+    { 0x0985, 0x098C }, { 0x098F, 0x0990 }, { 0x0993, 0x09A8 }, { 0x09AA, 0x09B0 },
+    { 0x09B2, 0x09B2 }, { 0x09B6, 0x09B9 }, { 0x09BC, 0x09C4 }, { 0x09C7, 0x09C8 },
+    { 0x09CB, 0x09CE }, { 0x09D7, 0x09D7 }, { 0x09DC, 0x09DD }, { 0x09DF, 0x09E3 },
+    { 0x09E6, 0x09F1 }, { 0x09FC, 0x09FC }, { 0x09FE, 0x09FE }, { 0x0A01, 0x0A03 },
+    { 0x0A05, 0x0A0A }, { 0x0A0F, 0x0A10 }, { 0x0A13, 0x0A28 }, { 0x0A2A, 0x0A30 },
+    { 0x0A32, 0x0A33 }, { 0x0A35, 0x0A36 }, { 0x0A38, 0x0A39 }, { 0x0A3C, 0x0A3C },
+    { 0x0A3E, 0x0A42 }, { 0x0A47, 0x0A48 }, { 0x0A4B, 0x0A4D }, { 0x0A51, 0x0A51 },
+    { 0x0A59, 0x0A5C }, { 0x0A5E, 0x0A5E }, { 0x0A66, 0x0A75 }, { 0x0A81, 0x0A83 },
+    { 0x0A85, 0x0A8D }, { 0x0A8F, 0x0A91 }, { 0x0A93, 0x0AA8 }, { 0x0AAA, 0x0AB0 },
+    { 0x0AB2, 0x0AB3 }, { 0x0AB5, 0x0AB9 }, { 0x0ABC, 0x0AC5 }, { 0x0AC7, 0x0AC9 },
+    { 0x0ACB, 0x0ACD }, { 0x0AD0, 0x0AD0 }, { 0x0AE0, 0x0AE3 }, { 0x0AE6, 0x0AEF },
+    { 0x0AF9, 0x0AFF }, { 0x0B01, 0x0B03 }, { 0x0B05, 0x0B0C }, { 0x0B0F, 0x0B10 },
+    { 0x0B13, 0x0B28 }, { 0x0B2A, 0x0B30 }, { 0x0B32, 0x0B33 }, { 0x0B35, 0x0B39 },
+    { 0x0B3C, 0x0B44 }, { 0x0B47, 0x0B48 }, { 0x0B4B, 0x0B4D }, { 0x0B55, 0x0B57 },
+    { 0x0B5C, 0x0B5D }, { 0x0B5F, 0x0B63 }, { 0x0B66, 0x0B6F }, { 0x0B71, 0x0B71 },
+    { 0x0B82, 0x0B83 }, { 0x0B85, 0x0B8A }, { 0x0B8E, 0x0B90 }, { 0x0B92, 0x0B95 },
+    { 0x0B99, 0x0B9A }, { 0x0B9C, 0x0B9C }, { 0x0B9E, 0x0B9F }, { 0x0BA3, 0x0BA4 },
+    { 0x0BA8, 0x0BAA }, { 0x0BAE, 0x0BB9 }, { 0x0BBE, 0x0BC2 }, { 0x0BC6, 0x0BC8 },
+    { 0x0BCA, 0x0BCD }, { 0x0BD0, 0x0BD0 }, { 0x0BD7, 0x0BD7 }, { 0x0BE6, 0x0BEF },
+    { 0x0C00, 0x0C0C }, { 0x0C0E, 0x0C10 }, { 0x0C12, 0x0C28 }, { 0x0C2A, 0x0C39 },
+    { 0x0C3C, 0x0C44 }, { 0x0C46, 0x0C48 }, { 0x0C4A, 0x0C4D }, { 0x0C55, 0x0C56 },
+    { 0x0C58, 0x0C5A }, { 0x0C5D, 0x0C5D }, { 0x0C60, 0x0C63 }, { 0x0C66, 0x0C6F },
+    { 0x0C80, 0x0C83 }, { 0x0C85, 0x0C8C }, { 0x0C8E, 0x0C90 }, { 0x0C92, 0x0CA8 },
+    { 0x0CAA, 0x0CB3 }, { 0x0CB5, 0x0CB9 }, { 0x0CBC, 0x0CC4 }, { 0x0CC6, 0x0CC8 },
+    { 0x0CCA, 0x0CCD }, { 0x0CD5, 0x0CD6 }, { 0x0CDD, 0x0CDE }, { 0x0CE0, 0x0CE3 },
+    { 0x0CE6, 0x0CEF }, { 0x0CF1, 0x0CF2 }, { 0x0D00, 0x0D0C }, { 0x0D0E, 0x0D10 },
+    { 0x0D12, 0x0D44 }, { 0x0D46, 0x0D48 }, { 0x0D4A, 0x0D4E }, { 0x0D54, 0x0D57 },
+    { 0x0D5F, 0x0D63 }, { 0x0D66, 0x0D6F }, { 0x0D7A, 0x0D7F }, { 0x0D81, 0x0D83 },
+    { 0x0D85, 0x0D96 }, { 0x0D9A, 0x0DB1 }, { 0x0DB3, 0x0DBB }, { 0x0DBD, 0x0DBD },
+    { 0x0DC0, 0x0DC6 }, { 0x0DCA, 0x0DCA }, { 0x0DCF, 0x0DD4 }, { 0x0DD6, 0x0DD6 },
+    { 0x0DD8, 0x0DDF }, { 0x0DE6, 0x0DEF }, { 0x0DF2, 0x0DF3 }, { 0x0E01, 0x0E3A },
+    { 0x0E40, 0x0E4E }, { 0x0E50, 0x0E59 }, { 0x0E81, 0x0E82 }, { 0x0E84, 0x0E84 },
+    { 0x0E86, 0x0E8A }, { 0x0E8C, 0x0EA3 }, { 0x0EA5, 0x0EA5 }, { 0x0EA7, 0x0EBD },
+    { 0x0EC0, 0x0EC4 }, { 0x0EC6, 0x0EC6 }, { 0x0EC8, 0x0ECD }, { 0x0ED0, 0x0ED9 },
+    { 0x0EDC, 0x0EDF }, { 0x0F00, 0x0F00 }, { 0x0F18, 0x0F19 }, { 0x0F20, 0x0F29 },
+    { 0x0F35, 0x0F35 }, { 0x0F37, 0x0F37 }, { 0x0F39, 0x0F39 }, { 0x0F3E, 0x0F47 },
+    { 0x0F49, 0x0F6C }, { 0x0F71, 0x0F84 }, { 0x0F86, 0x0F97 }, { 0x0F99, 0x0FBC },
+    { 0x0FC6, 0x0FC6 }, { 0x1000, 0x1049 }, { 0x1050, 0x109D }, { 0x10A0, 0x10C5 },
+    { 0x10C7, 0x10C7 }, { 0x10CD, 0x10CD }, { 0x10D0, 0x10FA }, { 0x10FC, 0x1248 },
+    { 0x124A, 0x124D }, { 0x1250, 0x1256 }, { 0x1258, 0x1258 }, { 0x125A, 0x125D },
+    { 0x1260, 0x1288 }, { 0x128A, 0x128D }, { 0x1290, 0x12B0 }, { 0x12B2, 0x12B5 },
+    { 0x12B8, 0x12BE }, { 0x12C0, 0x12C0 }, { 0x12C2, 0x12C5 }, { 0x12C8, 0x12D6 },
+    { 0x12D8, 0x1310 }, { 0x1312, 0x1315 }, { 0x1318, 0x135A }, { 0x135D, 0x135F },
+    { 0x1380, 0x138F }, { 0x13A0, 0x13F5 }, { 0x13F8, 0x13FD }, { 0x1401, 0x166C },
+    { 0x166F, 0x167F }, { 0x1681, 0x169A }, { 0x16A0, 0x16EA }, { 0x16EE, 0x16F8 },
+    { 0x1700, 0x1715 }, { 0x171F, 0x1734 }, { 0x1740, 0x1753 }, { 0x1760, 0x176C },
+    { 0x176E, 0x1770 }, { 0x1772, 0x1773 }, { 0x1780, 0x17D3 }, { 0x17D7, 0x17D7 },
+    { 0x17DC, 0x17DD }, { 0x17E0, 0x17E9 }, { 0x180B, 0x180D }, { 0x180F, 0x1819 },
+    { 0x1820, 0x1878 }, { 0x1880, 0x18AA }, { 0x18B0, 0x18F5 }, { 0x1900, 0x191E },
+    { 0x1920, 0x192B }, { 0x1930, 0x193B }, { 0x1946, 0x196D }, { 0x1970, 0x1974 },
+    { 0x1980, 0x19AB }, { 0x19B0, 0x19C9 }, { 0x19D0, 0x19D9 }, { 0x1A00, 0x1A1B },
+    { 0x1A20, 0x1A5E }, { 0x1A60, 0x1A7C }, { 0x1A7F, 0x1A89 }, { 0x1A90, 0x1A99 },
+    { 0x1AA7, 0x1AA7 }, { 0x1AB0, 0x1ACE }, { 0x1B00, 0x1B4C }, { 0x1B50, 0x1B59 },
+    { 0x1B6B, 0x1B73 }, { 0x1B80, 0x1BF3 }, { 0x1C00, 0x1C37 }, { 0x1C40, 0x1C49 },
+    { 0x1C4D, 0x1C7D }, { 0x1C80, 0x1C88 }, { 0x1C90, 0x1CBA }, { 0x1CBD, 0x1CBF },
+    { 0x1CD0, 0x1CD2 }, { 0x1CD4, 0x1CFA }, { 0x1D00, 0x1F15 }, { 0x1F18, 0x1F1D },
+    { 0x1F20, 0x1F45 }, { 0x1F48, 0x1F4D }, { 0x1F50, 0x1F57 }, { 0x1F59, 0x1F59 },
+    { 0x1F5B, 0x1F5B }, { 0x1F5D, 0x1F5D }, { 0x1F5F, 0x1F7D }, { 0x1F80, 0x1FB4 },
+    { 0x1FB6, 0x1FBC }, { 0x1FBE, 0x1FBE }, { 0x1FC2, 0x1FC4 }, { 0x1FC6, 0x1FCC },
+    { 0x1FD0, 0x1FD3 }, { 0x1FD6, 0x1FDB }, { 0x1FE0, 0x1FEC }, { 0x1FF2, 0x1FF4 },
+    { 0x1FF6, 0x1FFC }, { 0x203F, 0x2040 }, { 0x2054, 0x2054 }, { 0x2071, 0x2071 },
+    { 0x207F, 0x207F }, { 0x2090, 0x209C }, { 0x20D0, 0x20F0 }, { 0x2102, 0x2102 },
+    { 0x2107, 0x2107 }, { 0x210A, 0x2113 }, { 0x2115, 0x2115 }, { 0x2119, 0x211D },
+    { 0x2124, 0x2124 }, { 0x2126, 0x2126 }, { 0x2128, 0x2128 }, { 0x212A, 0x212D },
+    { 0x212F, 0x2139 }, { 0x213C, 0x213F }, { 0x2145, 0x2149 }, { 0x214E, 0x214E },
+    { 0x2160, 0x2188 }, { 0x2C00, 0x2CE4 }, { 0x2CEB, 0x2CF3 }, { 0x2D00, 0x2D25 },
+    { 0x2D27, 0x2D27 }, { 0x2D2D, 0x2D2D }, { 0x2D30, 0x2D67 }, { 0x2D6F, 0x2D6F },
+    { 0x2D7F, 0x2D96 }, { 0x2DA0, 0x2DA6 }, { 0x2DA8, 0x2DAE }, { 0x2DB0, 0x2DB6 },
+    { 0x2DB8, 0x2DBE }, { 0x2DC0, 0x2DC6 }, { 0x2DC8, 0x2DCE }, { 0x2DD0, 0x2DD6 },
+    { 0x2DD8, 0x2DDE }, { 0x2DE0, 0x2DFF }, { 0x2E2F, 0x2E2F }, { 0x3021, 0x302F },
+    { 0x3031, 0x3035 }, { 0x3038, 0x303C }, { 0x3099, 0x309A }, { 0x30A1, 0x30FA },
+    { 0x30FC, 0x30FF }, { 0x3105, 0x312F }, { 0x3131, 0x318E }, { 0x31A0, 0x31BF },
+    { 0x31F0, 0x31FF }, { 0xA000, 0xA48C }, { 0xA4D0, 0xA4FD }, { 0xA500, 0xA60C },
+    { 0xA610, 0xA62B }, { 0xA640, 0xA672 }, { 0xA674, 0xA67D }, { 0xA67F, 0xA6F1 },
+    { 0xA717, 0xA71F }, { 0xA722, 0xA788 }, { 0xA78B, 0xA7CA }, { 0xA7D0, 0xA7D1 },
+    { 0xA7D3, 0xA7D3 }, { 0xA7D5, 0xA7D9 }, { 0xA7F2, 0xA827 }, { 0xA82C, 0xA82C },
+    { 0xA840, 0xA873 }, { 0xA880, 0xA8C5 }, { 0xA8D0, 0xA8D9 }, { 0xA8E0, 0xA8F7 },
+    { 0xA8FB, 0xA8FB }, { 0xA8FD, 0xA92D }, { 0xA930, 0xA953 }, { 0xA960, 0xA97C },
+    { 0xA980, 0xA9C0 }, { 0xA9CF, 0xA9D9 }, { 0xA9E0, 0xA9FE }, { 0xAA00, 0xAA36 },
+    { 0xAA40, 0xAA4D }, { 0xAA50, 0xAA59 }, { 0xAA60, 0xAA76 }, { 0xAA7A, 0xAAC2 },
+    { 0xAADB, 0xAADD }, { 0xAAE0, 0xAAEF }, { 0xAAF2, 0xAAF6 }, { 0xAB01, 0xAB06 },
+    { 0xAB09, 0xAB0E }, { 0xAB11, 0xAB16 }, { 0xAB20, 0xAB26 }, { 0xAB28, 0xAB2E },
+    { 0xAB30, 0xAB5A }, { 0xAB5C, 0xAB69 }, { 0xAB70, 0xABEA }, { 0xABEC, 0xABED },
+    { 0xABF0, 0xABF9 }, { 0xAC00, 0xD7A3 }, { 0xD7B0, 0xD7C6 }, { 0xD7CB, 0xD7FB },
+    { 0xFB00, 0xFB06 }, { 0xFB13, 0xFB17 }, { 0xFB1D, 0xFB28 }, { 0xFB2A, 0xFB36 },
+    { 0xFB38, 0xFB3C }, { 0xFB3E, 0xFB3E }, { 0xFB40, 0xFB41 }, { 0xFB43, 0xFB44 },
+    { 0xFB46, 0xFBB1 }, { 0xFBD3, 0xFD3D }, { 0xFD50, 0xFD8F }, { 0xFD92, 0xFDC7 },
+    { 0xFDF0, 0xFDFB }, { 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F }, { 0xFE33, 0xFE34 },
+    { 0xFE4D, 0xFE4F }, { 0xFE70, 0xFE74 }, { 0xFE76, 0xFEFC }, { 0xFF10, 0xFF19 },
+    { 0xFF21, 0xFF3A }, { 0xFF3F, 0xFF3F }, { 0xFF41, 0xFF5A }, { 0xFF66, 0xFFBE },
+    { 0xFFC2, 0xFFC7 }, { 0xFFCA, 0xFFCF }, { 0xFFD2, 0xFFD7 }, { 0xFFDA, 0xFFDC },
+    { 0x10000, 0x1000B }, { 0x1000D, 0x10026 }, { 0x10028, 0x1003A }, { 0x1003C, 0x1003D },
+    { 0x1003F, 0x1004D }, { 0x10050, 0x1005D }, { 0x10080, 0x100FA }, { 0x10140, 0x10174 },
+    { 0x101FD, 0x101FD }, { 0x10280, 0x1029C }, { 0x102A0, 0x102D0 }, { 0x102E0, 0x102E0 },
+    { 0x10300, 0x1031F }, { 0x1032D, 0x1034A }, { 0x10350, 0x1037A }, { 0x10380, 0x1039D },
+    { 0x103A0, 0x103C3 }, { 0x103C8, 0x103CF }, { 0x103D1, 0x103D5 }, { 0x10400, 0x1049D },
+    { 0x104A0, 0x104A9 }, { 0x104B0, 0x104D3 }, { 0x104D8, 0x104FB }, { 0x10500, 0x10527 },
+    { 0x10530, 0x10563 }, { 0x10570, 0x1057A }, { 0x1057C, 0x1058A }, { 0x1058C, 0x10592 },
+    { 0x10594, 0x10595 }, { 0x10597, 0x105A1 }, { 0x105A3, 0x105B1 }, { 0x105B3, 0x105B9 },
+    { 0x105BB, 0x105BC }, { 0x10600, 0x10736 }, { 0x10740, 0x10755 }, { 0x10760, 0x10767 },
+    { 0x10780, 0x10785 }, { 0x10787, 0x107B0 }, { 0x107B2, 0x107BA }, { 0x10800, 0x10805 },
+    { 0x10808, 0x10808 }, { 0x1080A, 0x10835 }, { 0x10837, 0x10838 }, { 0x1083C, 0x1083C },
+    { 0x1083F, 0x10855 }, { 0x10860, 0x10876 }, { 0x10880, 0x1089E }, { 0x108E0, 0x108F2 },
+    { 0x108F4, 0x108F5 }, { 0x10900, 0x10915 }, { 0x10920, 0x10939 }, { 0x10980, 0x109B7 },
+    { 0x109BE, 0x109BF }, { 0x10A00, 0x10A03 }, { 0x10A05, 0x10A06 }, { 0x10A0C, 0x10A13 },
+    { 0x10A15, 0x10A17 }, { 0x10A19, 0x10A35 }, { 0x10A38, 0x10A3A }, { 0x10A3F, 0x10A3F },
+    { 0x10A60, 0x10A7C }, { 0x10A80, 0x10A9C }, { 0x10AC0, 0x10AC7 }, { 0x10AC9, 0x10AE6 },
+    { 0x10B00, 0x10B35 }, { 0x10B40, 0x10B55 }, { 0x10B60, 0x10B72 }, { 0x10B80, 0x10B91 },
+    { 0x10C00, 0x10C48 }, { 0x10C80, 0x10CB2 }, { 0x10CC0, 0x10CF2 }, { 0x10D00, 0x10D27 },
+    { 0x10D30, 0x10D39 }, { 0x10E80, 0x10EA9 }, { 0x10EAB, 0x10EAC }, { 0x10EB0, 0x10EB1 },
+    { 0x10F00, 0x10F1C }, { 0x10F27, 0x10F27 }, { 0x10F30, 0x10F50 }, { 0x10F70, 0x10F85 },
+    { 0x10FB0, 0x10FC4 }, { 0x10FE0, 0x10FF6 }, { 0x11000, 0x11046 }, { 0x11066, 0x11075 },
+    { 0x1107F, 0x110BA }, { 0x110C2, 0x110C2 }, { 0x110D0, 0x110E8 }, { 0x110F0, 0x110F9 },
+    { 0x11100, 0x11134 }, { 0x11136, 0x1113F }, { 0x11144, 0x11147 }, { 0x11150, 0x11173 },
+    { 0x11176, 0x11176 }, { 0x11180, 0x111C4 }, { 0x111C9, 0x111CC }, { 0x111CE, 0x111DA },
+    { 0x111DC, 0x111DC }, { 0x11200, 0x11211 }, { 0x11213, 0x11237 }, { 0x1123E, 0x1123E },
+    { 0x11280, 0x11286 }, { 0x11288, 0x11288 }, { 0x1128A, 0x1128D }, { 0x1128F, 0x1129D },
+    { 0x1129F, 0x112A8 }, { 0x112B0, 0x112EA }, { 0x112F0, 0x112F9 }, { 0x11300, 0x11303 },
+    { 0x11305, 0x1130C }, { 0x1130F, 0x11310 }, { 0x11313, 0x11328 }, { 0x1132A, 0x11330 },
+    { 0x11332, 0x11333 }, { 0x11335, 0x11339 }, { 0x1133B, 0x11344 }, { 0x11347, 0x11348 },
+    { 0x1134B, 0x1134D }, { 0x11350, 0x11350 }, { 0x11357, 0x11357 }, { 0x1135D, 0x11363 },
+    { 0x11366, 0x1136C }, { 0x11370, 0x11374 }, { 0x11400, 0x1144A }, { 0x11450, 0x11459 },
+    { 0x1145E, 0x11461 }, { 0x11480, 0x114C5 }, { 0x114C7, 0x114C7 }, { 0x114D0, 0x114D9 },
+    { 0x11580, 0x115B5 }, { 0x115B8, 0x115C0 }, { 0x115D8, 0x115DD }, { 0x11600, 0x11640 },
+    { 0x11644, 0x11644 }, { 0x11650, 0x11659 }, { 0x11680, 0x116B8 }, { 0x116C0, 0x116C9 },
+    { 0x11700, 0x1171A }, { 0x1171D, 0x1172B }, { 0x11730, 0x11739 }, { 0x11740, 0x11746 },
+    { 0x11800, 0x1183A }, { 0x118A0, 0x118E9 }, { 0x118FF, 0x11906 }, { 0x11909, 0x11909 },
+    { 0x1190C, 0x11913 }, { 0x11915, 0x11916 }, { 0x11918, 0x11935 }, { 0x11937, 0x11938 },
+    { 0x1193B, 0x11943 }, { 0x11950, 0x11959 }, { 0x119A0, 0x119A7 }, { 0x119AA, 0x119D7 },
+    { 0x119DA, 0x119E1 }, { 0x119E3, 0x119E4 }, { 0x11A00, 0x11A3E }, { 0x11A47, 0x11A47 },
+    { 0x11A50, 0x11A99 }, { 0x11A9D, 0x11A9D }, { 0x11AB0, 0x11AF8 }, { 0x11C00, 0x11C08 },
+    { 0x11C0A, 0x11C36 }, { 0x11C38, 0x11C40 }, { 0x11C50, 0x11C59 }, { 0x11C72, 0x11C8F },
+    { 0x11C92, 0x11CA7 }, { 0x11CA9, 0x11CB6 }, { 0x11D00, 0x11D06 }, { 0x11D08, 0x11D09 },
+    { 0x11D0B, 0x11D36 }, { 0x11D3A, 0x11D3A }, { 0x11D3C, 0x11D3D }, { 0x11D3F, 0x11D47 },
+    { 0x11D50, 0x11D59 }, { 0x11D60, 0x11D65 }, { 0x11D67, 0x11D68 }, { 0x11D6A, 0x11D8E },
+    { 0x11D90, 0x11D91 }, { 0x11D93, 0x11D98 }, { 0x11DA0, 0x11DA9 }, { 0x11EE0, 0x11EF6 },
+    { 0x11FB0, 0x11FB0 }, { 0x12000, 0x12399 }, { 0x12400, 0x1246E }, { 0x12480, 0x12543 },
+    { 0x12F90, 0x12FF0 }, { 0x13000, 0x1342E }, { 0x14400, 0x14646 }, { 0x16800, 0x16A38 },
+    { 0x16A40, 0x16A5E }, { 0x16A60, 0x16A69 }, { 0x16A70, 0x16ABE }, { 0x16AC0, 0x16AC9 },
+    { 0x16AD0, 0x16AED }, { 0x16AF0, 0x16AF4 }, { 0x16B00, 0x16B36 }, { 0x16B40, 0x16B43 },
+    { 0x16B50, 0x16B59 }, { 0x16B63, 0x16B77 }, { 0x16B7D, 0x16B8F }, { 0x16E40, 0x16E7F },
+    { 0x16F00, 0x16F4A }, { 0x16F4F, 0x16F87 }, { 0x16F8F, 0x16F9F }, { 0x16FE0, 0x16FE1 },
+    { 0x16FE3, 0x16FE4 }, { 0x16FF0, 0x16FF1 }, { 0x17000, 0x187F7 }, { 0x18800, 0x18CD5 },
+    { 0x18D00, 0x18D08 }, { 0x1AFF0, 0x1AFF3 }, { 0x1AFF5, 0x1AFFB }, { 0x1AFFD, 0x1AFFE },
+    { 0x1B000, 0x1B000 }, { 0x1B120, 0x1B122 }, { 0x1B150, 0x1B152 }, { 0x1B164, 0x1B167 },
+    { 0x1B170, 0x1B2FB }, { 0x1BC00, 0x1BC6A }, { 0x1BC70, 0x1BC7C }, { 0x1BC80, 0x1BC88 },
+    { 0x1BC90, 0x1BC99 }, { 0x1BC9D, 0x1BC9E }, { 0x1CF00, 0x1CF2D }, { 0x1CF30, 0x1CF46 },
+    { 0x1D165, 0x1D169 }, { 0x1D16D, 0x1D172 }, { 0x1D17B, 0x1D182 }, { 0x1D185, 0x1D18B },
+    { 0x1D1AA, 0x1D1AD }, { 0x1D242, 0x1D244 }, { 0x1D400, 0x1D454 }, { 0x1D456, 0x1D49C },
+    { 0x1D49E, 0x1D49F }, { 0x1D4A2, 0x1D4A2 }, { 0x1D4A5, 0x1D4A6 }, { 0x1D4A9, 0x1D4AC },
+    { 0x1D4AE, 0x1D4B9 }, { 0x1D4BB, 0x1D4BB }, { 0x1D4BD, 0x1D4C3 }, { 0x1D4C5, 0x1D505 },
+    { 0x1D507, 0x1D50A }, { 0x1D50D, 0x1D514 }, { 0x1D516, 0x1D51C }, { 0x1D51E, 0x1D539 },
+    { 0x1D53B, 0x1D53E }, { 0x1D540, 0x1D544 }, { 0x1D546, 0x1D546 }, { 0x1D54A, 0x1D550 },
+    { 0x1D552, 0x1D6A5 }, { 0x1D6A8, 0x1D6C0 }, { 0x1D6C2, 0x1D6DA }, { 0x1D6DC, 0x1D6FA },
+    { 0x1D6FC, 0x1D714 }, { 0x1D716, 0x1D734 }, { 0x1D736, 0x1D74E }, { 0x1D750, 0x1D76E },
+    { 0x1D770, 0x1D788 }, { 0x1D78A, 0x1D7A8 }, { 0x1D7AA, 0x1D7C2 }, { 0x1D7C4, 0x1D7CB },
+    { 0x1D7CE, 0x1D7FF }, { 0x1DA00, 0x1DA36 }, { 0x1DA3B, 0x1DA6C }, { 0x1DA75, 0x1DA75 },
+    { 0x1DA84, 0x1DA84 }, { 0x1DA9B, 0x1DA9F }, { 0x1DAA1, 0x1DAAF }, { 0x1DF00, 0x1DF1E },
+    { 0x1E000, 0x1E006 }, { 0x1E008, 0x1E018 }, { 0x1E01B, 0x1E021 }, { 0x1E023, 0x1E024 },
+    { 0x1E026, 0x1E02A }, { 0x1E100, 0x1E12C }, { 0x1E130, 0x1E13D }, { 0x1E140, 0x1E149 },
+    { 0x1E14E, 0x1E14E }, { 0x1E290, 0x1E2AE }, { 0x1E2C0, 0x1E2F9 }, { 0x1E7E0, 0x1E7E6 },
+    { 0x1E7E8, 0x1E7EB }, { 0x1E7ED, 0x1E7EE }, { 0x1E7F0, 0x1E7FE }, { 0x1E800, 0x1E8C4 },
+    { 0x1E8D0, 0x1E8D6 }, { 0x1E900, 0x1E94B }, { 0x1E950, 0x1E959 }, { 0x1EE00, 0x1EE03 },
+    { 0x1EE05, 0x1EE1F }, { 0x1EE21, 0x1EE22 }, { 0x1EE24, 0x1EE24 }, { 0x1EE27, 0x1EE27 },
+    { 0x1EE29, 0x1EE32 }, { 0x1EE34, 0x1EE37 }, { 0x1EE39, 0x1EE39 }, { 0x1EE3B, 0x1EE3B },
+    { 0x1EE42, 0x1EE42 }, { 0x1EE47, 0x1EE47 }, { 0x1EE49, 0x1EE49 }, { 0x1EE4B, 0x1EE4B },
+    { 0x1EE4D, 0x1EE4F }, { 0x1EE51, 0x1EE52 }, { 0x1EE54, 0x1EE54 }, { 0x1EE57, 0x1EE57 },
+    { 0x1EE59, 0x1EE59 }, { 0x1EE5B, 0x1EE5B }, { 0x1EE5D, 0x1EE5D }, { 0x1EE5F, 0x1EE5F },
+    { 0x1EE61, 0x1EE62 }, { 0x1EE64, 0x1EE64 }, { 0x1EE67, 0x1EE6A }, { 0x1EE6C, 0x1EE72 },
+    { 0x1EE74, 0x1EE77 }, { 0x1EE79, 0x1EE7C }, { 0x1EE7E, 0x1EE7E }, { 0x1EE80, 0x1EE89 },
+    { 0x1EE8B, 0x1EE9B }, { 0x1EEA1, 0x1EEA3 }, { 0x1EEA5, 0x1EEA9 }, { 0x1EEAB, 0x1EEBB },
+    { 0x1FBF0, 0x1FBF9 }, { 0xE0100, 0xE01EF },
+};
+
+// The simple case folding of Unicode 14.0 past ASCII, which maps each character to one character and never to
+// several, like the C and S mappings of CaseFolding.txt. Folding lengthens U+023A and U+023E from two bytes to
+// three.
+static const Mapping fold_mappings[] = {
+    { 0x00B5, 0x00B5, 775, 1 }, { 0x00C0, 0x00D6, 32, 1 }, { 0x00D8, 0x00DE, 32, 1 },
+    { 0x0100, 0x012E, 1, 2 }, { 0x0132, 0x0136, 1, 2 }, { 0x0139, 0x0147, 1, 2 },
+    { 0x014A, 0x0176, 1, 2 }, { 0x0178, 0x0178, -121, 1 }, { 0x0179, 0x017D, 1, 2 },
+    { 0x017F, 0x017F, -268, 1 }, { 0x0181, 0x0181, 210, 1 }, { 0x0182, 0x0184, 1, 2 },
+    { 0x0186, 0x0186, 206, 1 }, { 0x0187, 0x0187, 1, 1 }, { 0x0189, 0x018A, 205, 1 },
+    { 0x018B, 0x018B, 1, 1 }, { 0x018E, 0x018E, 79, 1 }, { 0x018F, 0x018F, 202, 1 },
+    { 0x0190, 0x0190, 203, 1 }, { 0x0191, 0x0191, 1, 1 }, { 0x0193, 0x0193, 205, 1 },
+    { 0x0194, 0x0194, 207, 1 }, { 0x0196, 0x0196, 211, 1 }, { 0x0197, 0x0197, 209, 1 },
+    { 0x0198, 0x0198, 1, 1 }, { 0x019C, 0x019C, 211, 1 }, { 0x019D, 0x019D, 213, 1 },
+    { 0x019F, 0x019F, 214, 1 }, { 0x01A0, 0x01A4, 1, 2 }, { 0x01A6, 0x01A6, 218, 1 },
+    { 0x01A7, 0x01A7, 1, 1 }, { 0x01A9, 0x01A9, 218, 1 }, { 0x01AC, 0x01AC, 1, 1 },
+    { 0x01AE, 0x01AE, 218, 1 }, { 0x01AF, 0x01AF, 1, 1 }, { 0x01B1, 0x01B2, 217, 1 },
+    { 0x01B3, 0x01B5, 1, 2 }, { 0x01B7, 0x01B7, 219, 1 }, { 0x01B8, 0x01B8, 1, 1 },
+    { 0x01BC, 0x01BC, 1, 1 }, { 0x01C4, 0x01C4, 2, 1 }, { 0x01C5, 0x01C5, 1, 1 },
+    { 0x01C7, 0x01C7, 2, 1 }, { 0x01C8, 0x01C8, 1, 1 }, { 0x01CA, 0x01CA, 2, 1 },
+    { 0x01CB, 0x01DB, 1, 2 }, { 0x01DE, 0x01EE, 1, 2 }, { 0x01F1, 0x01F1, 2, 1 },
+    { 0x01F2, 0x01F4, 1, 2 }, { 0x01F6, 0x01F6, -97, 1 }, { 0x01F7, 0x01F7, -56, 1 },
+    { 0x01F8, 0x021E, 1, 2 }, { 0x0220, 0x0220, -130, 1 }, { 0x0222, 0x0232, 1, 2 },
+    { 0x023A, 0x023A, 10795, 1 }, { 0x023B, 0x023B, 1, 1 }, { 0x023D, 0x023D, -163, 1 },
+    { 0x023E, 0x023E, 10792, 1 }, { 0x0241, 0x0241, 1, 1 }, { 0x0243, 0x0243, -195, 1 },
+    { 0x0244, 0x0244, 69, 1 }, { 0x0245, 0x0245, 71, 1 }, { 0x0246, 0x024E, 1, 2 },
+    { 0x0345, 0x0345, 116, 1 }, { 0x0370, 0x0372, 1, 2 }, { 0x0376, 0x0376, 1, 1 },
+    { 0x037F, 0x037F, 116, 1 }, { 0x0386, 0x0386, 38, 1 }, { 0x0388, 0x038A, 37, 1 },
+    { 0x038C, 0x038C, 64, 1 }, { 0x038E, 0x038F, 63, 1 }, { 0x0391, 0x03A1, 32, 1 },
+    { 0x03A3, 0x03AB, 32, 1 }, { 0x03C2, 0x03C2, 1, 1 }, { 0x03CF, 0x03CF, 8, 1 },
+    { 0x03D0, 0x03D0, -30, 1 }, { 0x03D1, 0x03D1, -25, 1 }, { 0x03D5, 0x03D5, -15, 1 },
+    { 0x03D6, 0x03D6, -22, 1 }, { 0x03D8, 0x03EE, 1, 2 }, { 0x03F0, 0x03F0, -54, 1 },
+    { 0x03F1, 0x03F1, -48, 1 }, { 0x03F4, 0x03F4, -60, 1 }, { 0x03F5, 0x03F5, -64, 1 },
+    { 0x03F7, 0x03F7, 1, 1 }, { 0x03F9, 0x03F9, -7, 1 }, { 0x03FA, 0x03FA, 1, 1 },
+    { 0x03FD, 0x03FF, -130, 1 }, { 0x0400, 0x040F, 80, 1 }, { 0x0410, 0x042F, 32, 1 },
+    { 0x0460, 0x0480, 1, 2 }, { 0x048A, 0x04BE, 1, 2 }, { 0x04C0, 0x04C0, 15, 1 },
+    { 0x04C1, 0x04CD, 1, 2 }, { 0x04D0, 0x052E, 1, 2 }, { 0x0531, 0x0556, 48, 1 },
+    { 0x10A0, 0x10C5, 7264, 1 }, { 0x10C7, 0x10C7, 7264, 1 }, { 0x10CD, 0x10CD, 7264, 1 },
+    { 0x13F8, 0x13FD, -8, 1 }, { 0x1C80, 0x1C80, -6222, 1 }, { 0x1C81, 0x1C81, -6221, 1 },
+    { 0x1C82, 0x1C82, -6212, 1 }, { 0x1C83, 0x1C84, -6210, 1 }, { 0x1C85, 0x1C85, -6211, 1 },
+    { 0x1C86, 0x1C86, -6204, 1 }, { 0x1C87, 0x1C87, -6180, 1 }, { 0x1C88, 0x1C88, 35267, 1 },
+    { 0x1C90, 0x1CBA, -3008, 1 }, { 0x1CBD, 0x1CBF, -3008, 1 }, { 0x1E00, 0x1E94, 1, 2 },
+    { 0x1E9B, 0x1E9B, -58, 1 }, { 0x1E9E, 0x1E9E, -7615, 1 }, { 0x1EA0, 0x1EFE, 1, 2 },
+    { 0x1F08, 0x1F0F, -8, 1 }, { 0x1F18, 0x1F1D, -8, 1 }, { 0x1F28, 0x1F2F, -8, 1 },
+    { 0x1F38, 0x1F3F, -8, 1 }, { 0x1F48, 0x1F4D, -8, 1 }, { 0x1F59, 0x1F5F, -8, 2 },
+    { 0x1F68, 0x1F6F, -8, 1 }, { 0x1F88, 0x1F8F, -8, 1 }, { 0x1F98, 0x1F9F, -8, 1 },
+    { 0x1FA8, 0x1FAF, -8, 1 }, { 0x1FB8, 0x1FB9, -8, 1 }, { 0x1FBA, 0x1FBB, -74, 1 },
+    { 0x1FBC, 0x1FBC, -9, 1 }, { 0x1FBE, 0x1FBE, -7173, 1 }, { 0x1FC8, 0x1FCB, -86, 1 },
+    { 0x1FCC, 0x1FCC, -9, 1 }, { 0x1FD8, 0x1FD9, -8, 1 }, { 0x1FDA, 0x1FDB, -100, 1 },
+    { 0x1FE8, 0x1FE9, -8, 1 }, { 0x1FEA, 0x1FEB, -112, 1 }, { 0x1FEC, 0x1FEC, -7, 1 },
+    { 0x1FF8, 0x1FF9, -128, 1 }, { 0x1FFA, 0x1FFB, -126, 1 }, { 0x1FFC, 0x1FFC, -9, 1 },
+    { 0x2126, 0x2126, -7517, 1 }, { 0x212A, 0x212A, -8383, 1 }, { 0x212B, 0x212B, -8262, 1 },
+    { 0x2132, 0x2132, 28, 1 }, { 0x2160, 0x216F, 16, 1 }, { 0x2183, 0x2183, 1, 1 },
+    { 0x24B6, 0x24CF, 26, 1 }, { 0x2C00, 0x2C2F, 48, 1 }, { 0x2C60, 0x2C60, 1, 1 },
+    { 0x2C62, 0x2C62, -10743, 1 }, { 0x2C63, 0x2C63, -3814, 1 }, { 0x2C64, 0x2C64, -10727, 1 },
+    { 0x2C67, 0x2C6B, 1, 2 }, { 0x2C6D, 0x2C6D, -10780, 1 }, { 0x2C6E, 0x2C6E, -10749, 1 },
+    { 0x2C6F, 0x2C6F, -10783, 1 }, { 0x2C70, 0x2C70, -10782, 1 }, { 0x2C72, 0x2C72, 1, 1 },
+    { 0x2C75, 0x2C75, 1, 1 }, { 0x2C7E, 0x2C7F, -10815, 1 }, { 0x2C80, 0x2CE2, 1, 2 },
+    { 0x2CEB, 0x2CED, 1, 2 }, { 0x2CF2, 0x2CF2, 1, 1 }, { 0xA640, 0xA66C, 1, 2 },
+    { 0xA680, 0xA69A, 1, 2 }, { 0xA722, 0xA72E, 1, 2 }, { 0xA732, 0xA76E, 1, 2 },
+    { 0xA779, 0xA77B, 1, 2 }, { 0xA77D, 0xA77D, -35332, 1 }, { 0xA77E, 0xA786, 1, 2 },
+    { 0xA78B, 0xA78B, 1, 1 }, { 0xA78D, 0xA78D, -42280, 1 }, { 0xA790, 0xA792, 1, 2 },
+    { 0xA796, 0xA7A8, 1, 2 }, { 0xA7AA, 0xA7AA, -42308, 1 }, { 0xA7AB, 0xA7AB, -42319, 1 },
+    { 0xA7AC, 0xA7AC, -42315, 1 }, { 0xA7AD, 0xA7AD, -42305, 1 }, { 0xA7AE, 0xA7AE, -42308, 1 },
+    { 0xA7B0, 0xA7B0, -42258, 1 }, { 0xA7B1, 0xA7B1, -42282, 1 }, { 0xA7B2, 0xA7B2, -42261, 1 },
+    { 0xA7B3, 0xA7B3, 928, 1 }, { 0xA7B4, 0xA7C2, 1, 2 }, { 0xA7C4, 0xA7C4, -48, 1 },
+    { 0xA7C5, 0xA7C5, -42307, 1 }, { 0xA7C6, 0xA7C6, -35384, 1 }, { 0xA7C7, 0xA7C9, 1, 2 },
+    { 0xA7D0, 0xA7D0, 1, 1 }, { 0xA7D6, 0xA7D8, 1, 2 }, { 0xA7F5, 0xA7F5, 1, 1 },
+    { 0xAB70, 0xABBF, -38864, 1 }, { 0xFF21, 0xFF3A, 32, 1 }, { 0x10400, 0x10427, 40, 1 },
+    { 0x104B0, 0x104D3, 40, 1 }, { 0x10570, 0x1057A, 39, 1 }, { 0x1057C, 0x1058A, 39, 1 },
+    { 0x1058C, 0x10592, 39, 1 }, { 0x10594, 0x10595, 39, 1 }, { 0x10C80, 0x10CB2, 64, 1 },
+    { 0x118A0, 0x118BF, 32, 1 }, { 0x16E40, 0x16E5F, 32, 1 }, { 0x1E900, 0x1E921, 34, 1 },
+};
+
+// The simple uppercase mapping of Unicode 14.0 past ASCII.
+static const Mapping upper_mappings[] = {
+    { 0x00B5, 0x00B5, 743, 1 }, { 0x00E0, 0x00F6, -32, 1 }, { 0x00F8, 0x00FE, -32, 1 },
+    { 0x00FF, 0x00FF, 121, 1 }, { 0x0101, 0x012F, -1, 2 }, { 0x0131, 0x0131, -232, 1 },
+    { 0x0133, 0x0137, -1, 2 }, { 0x013A, 0x0148, -1, 2 }, { 0x014B, 0x0177, -1, 2 },
+    { 0x017A, 0x017E, -1, 2 }, { 0x017F, 0x017F, -300, 1 }, { 0x0180, 0x0180, 195, 1 },
+    { 0x0183, 0x0185, -1, 2 }, { 0x0188, 0x0188, -1, 1 }, { 0x018C, 0x018C, -1, 1 },
+    { 0x0192, 0x0192, -1, 1 }, { 0x0195, 0x0195, 97, 1 }, { 0x0199, 0x0199, -1, 1 },
+    { 0x019A, 0x019A, 163, 1 }, { 0x019E, 0x019E, 130, 1 }, { 0x01A1, 0x01A5, -1, 2 },
+    { 0x01A8, 0x01A8, -1, 1 }, { 0x01AD, 0x01AD, -1, 1 }, { 0x01B0, 0x01B0, -1, 1 },
+    { 0x01B4, 0x01B6, -1, 2 }, { 0x01B9, 0x01B9, -1, 1 }, { 0x01BD, 0x01BD, -1, 1 },
+    { 0x01BF, 0x01BF, 56, 1 }, { 0x01C5, 0x01C5, -1, 1 }, { 0x01C6, 0x01C6, -2, 1 },
+    { 0x01C8, 0x01C8, -1, 1 }, { 0x01C9, 0x01C9, -2, 1 }, { 0x01CB, 0x01CB, -1, 1 },
+    { 0x01CC, 0x01CC, -2, 1 }, { 0x01CE, 0x01DC, -1, 2 }, { 0x01DD, 0x01DD, -79, 1 },
+    { 0x01DF, 0x01EF, -1, 2 }, { 0x01F2, 0x01F2, -1, 1 }, { 0x01F3, 0x01F3, -2, 1 },
+    { 0x01F5, 0x01F5, -1, 1 }, { 0x01F9, 0x021F, -1, 2 }, { 0x0223, 0x0233, -1, 2 },
+    { 0x023C, 0x023C, -1, 1 }, { 0x023F, 0x0240, 10815, 1 }, { 0x0242, 0x0242, -1, 1 },
+    { 0x0247, 0x024F, -1, 2 }, { 0x0250, 0x0250, 10783, 1 }, { 0x0251, 0x0251, 10780, 1 },
+    { 0x0252, 0x0252, 10782, 1 }, { 0x0253, 0x0253, -210, 1 }, { 0x0254, 0x0254, -206, 1 },
+    { 0x0256, 0x0257, -205, 1 }, { 0x0259, 0x0259, -202, 1 }, { 0x025B, 0x025B, -203, 1 },
+    { 0x025C, 0x025C, 42319, 1 }, { 0x0260, 0x0260, -205, 1 }, { 0x0261, 0x0261, 42315, 1 },
+    { 0x0263, 0x0263, -207, 1 }, { 0x0265, 0x0265, 42280, 1 }, { 0x0266, 0x0266, 42308, 1 },
+    { 0x0268, 0x0268, -209, 1 }, { 0x0269, 0x0269, -211, 1 }, { 0x026A, 0x026A, 42308, 1 },
+    { 0x026B, 0x026B, 10743, 1 }, { 0x026C, 0x026C, 42305, 1 }, { 0x026F, 0x026F, -211, 1 },
+    { 0x0271, 0x0271, 10749, 1 }, { 0x0272, 0x0272, -213, 1 }, { 0x0275, 0x0275, -214, 1 },
+    { 0x027D, 0x027D, 10727, 1 }, { 0x0280, 0x0280, -218, 1 }, { 0x0282, 0x0282, 42307, 1 },
+    { 0x0283, 0x0283, -218, 1 }, { 0x0287, 0x0287, 42282, 1 }, { 0x0288, 0x0288, -218, 1 },
+    { 0x0289, 0x0289, -69, 1 }, { 0x028A, 0x028B, -217, 1 }, { 0x028C, 0x028C, -71, 1 },
+    { 0x0292, 0x0292, -219, 1 }, { 0x029D, 0x029D, 42261, 1 }, { 0x029E, 0x029E, 42258, 1 },
+    { 0x0345, 0x0345, 84, 1 }, { 0x0371, 0x0373, -1, 2 }, { 0x0377, 0x0377, -1, 1 },
+    { 0x037B, 0x037D, 130, 1 }, { 0x03AC, 0x03AC, -38, 1 }, { 0x03AD, 0x03AF, -37, 1 },
+    { 0x03B1, 0x03C1, -32, 1 }, { 0x03C2, 0x03C2, -31, 1 }, { 0x03C3, 0x03CB, -32, 1 },
+    { 0x03CC, 0x03CC, -64, 1 }, { 0x03CD, 0x03CE, -63, 1 }, { 0x03D0, 0x03D0, -62, 1 },
+    { 0x03D1, 0x03D1, -57, 1 }, { 0x03D5, 0x03D5, -47, 1 }, { 0x03D6, 0x03D6, -54, 1 },
+    { 0x03D7, 0x03D7, -8, 1 }, { 0x03D9, 0x03EF, -1, 2 }, { 0x03F0, 0x03F0, -86, 1 },
+    { 0x03F1, 0x03F1, -80, 1 }, { 0x03F2, 0x03F2, 7, 1 }, { 0x03F3, 0x03F3, -116, 1 },
+    { 0x03F5, 0x03F5, -96, 1 }, { 0x03F8, 0x03F8, -1, 1 }, { 0x03FB, 0x03FB, -1, 1 },
+    { 0x0430, 0x044F, -32, 1 }, { 0x0450, 0x045F, -80, 1 }, { 0x0461, 0x0481, -1, 2 },
+    { 0x048B, 0x04BF, -1, 2 }, { 0x04C2, 0x04CE, -1, 2 }, { 0x04CF, 0x04CF, -15, 1 },
+    { 0x04D1, 0x052F, -1, 2 }, { 0x0561, 0x0586, -48, 1 }, { 0x10D0, 0x10FA, 3008, 1 },
+    { 0x10FD, 0x10FF, 3008, 1 }, { 0x13F8, 0x13FD, -8, 1 }, { 0x1C80, 0x1C80, -6254, 1 },
+    { 0x1C81, 0x1C81, -6253, 1 }, { 0x1C82, 0x1C82, -6244, 1 }, { 0x1C83, 0x1C84, -6242, 1 },
+    { 0x1C85, 0x1C85, -6243, 1 }, { 0x1C86, 0x1C86, -6236, 1 }, { 0x1C87, 0x1C87, -6181, 1 },
+    { 0x1C88, 0x1C88, 35266, 1 }, { 0x1D79, 0x1D79, 35332, 1 }, { 0x1D7D, 0x1D7D, 3814, 1 },
+    { 0x1D8E, 0x1D8E, 35384, 1 }, { 0x1E01, 0x1E95, -1, 2 }, { 0x1E9B, 0x1E9B, -59, 1 },
+    { 0x1EA1, 0x1EFF, -1, 2 }, { 0x1F00, 0x1F07, 8, 1 }, { 0x1F10, 0x1F15, 8, 1 },
+    { 0x1F20, 0x1F27, 8, 1 }, { 0x1F30, 0x1F37, 8, 1 }, { 0x1F40, 0x1F45, 8, 1 },
+    { 0x1F51, 0x1F57, 8, 2 }, { 0x1F60, 0x1F67, 8, 1 }, { 0x1F70, 0x1F71, 74, 1 },
+    { 0x1F72, 0x1F75, 86, 1 }, { 0x1F76, 0x1F77, 100, 1 }, { 0x1F78, 0x1F79, 128, 1 },
+    { 0x1F7A, 0x1F7B, 112, 1 }, { 0x1F7C, 0x1F7D, 126, 1 }, { 0x1FB0, 0x1FB1, 8, 1 },
+    { 0x1FBE, 0x1FBE, -7205, 1 }, { 0x1FD0, 0x1FD1, 8, 1 }, { 0x1FE0, 0x1FE1, 8, 1 },
+    { 0x1FE5, 0x1FE5, 7, 1 }, { 0x214E, 0x214E, -28, 1 }, { 0x2170, 0x217F, -16, 1 },
+    { 0x2184, 0x2184, -1, 1 }, { 0x24D0, 0x24E9, -26, 1 }, { 0x2C30, 0x2C5F, -48, 1 },
+    { 0x2C61, 0x2C61, -1, 1 }, { 0x2C65, 0x2C65, -10795, 1 }, { 0x2C66, 0x2C66, -10792, 1 },
+    { 0x2C68, 0x2C6C, -1, 2 }, { 0x2C73, 0x2C73, -1, 1 }, { 0x2C76, 0x2C76, -1, 1 },
+    { 0x2C81, 0x2CE3, -1, 2 }, { 0x2CEC, 0x2CEE, -1, 2 }, { 0x2CF3, 0x2CF3, -1, 1 },
+    { 0x2D00, 0x2D25, -7264, 1 }, { 0x2D27, 0x2D27, -7264, 1 }, { 0x2D2D, 0x2D2D, -7264, 1 },
+    { 0xA641, 0xA66D, -1, 2 }, { 0xA681, 0xA69B, -1, 2 }, { 0xA723, 0xA72F, -1, 2 },
+    { 0xA733, 0xA76F, -1, 2 }, { 0xA77A, 0xA77C, -1, 2 }, { 0xA77F, 0xA787, -1, 2 },
+    { 0xA78C, 0xA78C, -1, 1 }, { 0xA791, 0xA793, -1, 2 }, { 0xA794, 0xA794, 48, 1 },
+    { 0xA797, 0xA7A9, -1, 2 }, { 0xA7B5, 0xA7C3, -1, 2 }, { 0xA7C8, 0xA7CA, -1, 2 },
+    { 0xA7D1, 0xA7D1, -1, 1 }, { 0xA7D7, 0xA7D9, -1, 2 }, { 0xA7F6, 0xA7F6, -1, 1 },
+    { 0xAB53, 0xAB53, -928, 1 }, { 0xAB70, 0xABBF, -38864, 1 }, { 0xFF41, 0xFF5A, -32, 1 },
+    { 0x10428, 0x1044F, -40, 1 }, { 0x104D8, 0x104FB, -40, 1 }, { 0x10597, 0x105A1, -39, 1 },
+    { 0x105A3, 0x105B1, -39, 1 }, { 0x105B3, 0x105B9, -39, 1 }, { 0x105BB, 0x105BC, -39, 1 },
+    { 0x10CC0, 0x10CF2, -64, 1 }, { 0x118C0, 0x118DF, -32, 1 }, { 0x16E60, 0x16E7F, -32, 1 },
+    { 0x1E922, 0x1E943, -34, 1 },
+};
+
+// This function is a helper function that returns whether c lies in one of the n sorted spans.
+static bool in_spans(const Span *spans, size_t n, uint32_t c) {
+    size_t lo = 0;
+    size_t hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (c < spans[mid].first) {
+            hi = mid;
+        } else if (c > spans[mid].last) {
+            lo = mid + 1;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+// This function is a helper function that returns what the n sorted mappings map c to, which is c itself if none
+// of them does.
+static uint32_t map(const Mapping *mappings, size_t n, uint32_t c) {
+    size_t lo = 0;
+    size_t hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (c < mappings[mid].first) {
+            hi = mid;
+        } else if (c > mappings[mid].last) {
+            lo = mid + 1;
+        } else {
+            const Mapping *m = &mappings[mid];
+            return (c - m->first) % m->stride == 0 ? (uint32_t) ((int32_t) c + m->delta) : c;
+        }
+    }
+    return c;
+}
+
+// This function decodes the character at the start of s, which holds length bytes, at least one. A byte that does
+// not start a well-formed character, including an overlong encoding, a surrogate or a code point past U+10FFFF, is
+// decoded by itself as U+FFFD.
+// Returns the number of bytes of the character, or 0 if s ends before the character does, so that the caller can
+// read more and try again.
+// This function takes in as parameters the char s, the size_t length of s, and a pointer to the uint32_t c, which
+// is set to the character.
+size_t utf8_decode(const char *s, size_t length, uint32_t *c) {
+    const uint8_t *b = (const uint8_t *) s;
+    size_t size = 0;
+    uint32_t code = 0;
+    uint32_t least = 0; // Least code point the size may encode.
+    if (b[0] < 0x80) {
+        *c = b[0];
+        return 1;
+    } else if ((b[0] & 0xE0) == 0xC0) {
+        size = 2;
+        code = b[0] & 0x1F;
+        least = 0x80;
+    } else if ((b[0] & 0xF0) == 0xE0) {
+        size = 3;
+        code = b[0] & 0x0F;
+        least = 0x800;
+    } else if ((b[0] & 0xF8) == 0xF0) {
+        size = 4;
+        code = b[0] & 0x07;
+        least = 0x10000;
+    } else {
+        *c = REPLACEMENT;
+        return 1;
+    }
+    for (size_t i = 1; i < size; i++) {
+        if (i == length) {
+            return 0;
+        }
+        if ((b[i] & 0xC0) != 0x80) {
+            *c = REPLACEMENT;
+            return 1;
+        }
+        code = code << 6 | (b[i] & 0x3F);
+    }
+    if (code < least || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
+        *c = REPLACEMENT;
+        return 1;
+    }
+    *c = code;
+    return size;
+}
+
+// This function encodes the character c, a code point up to U+10FFFF, into out, which must have room for 4 bytes.
+// Returns the number of bytes written.
+size_t utf8_encode(uint32_t c, char *out) {
+    uint8_t *b = (uint8_t *) out;
+    if (c < 0x80) {
+        b[0] = (uint8_t) c;
+        return 1;
+    }
+    if (c < 0x800) {
+        b[0] = (uint8_t) (0xC0 | c >> 6);
+        b[1] = (uint8_t) (0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000) {
+        b[0] = (uint8_t) (0xE0 | c >> 12);
+        b[1] = (uint8_t) (0x80 | (c >> 6 & 0x3F));
+        b[2] = (uint8_t) (0x80 | (c & 0x3F));
+        return 3;
+    }
+    b[0] = (uint8_t) (0xF0 | c >> 18);
+    b[1] = (uint8_t) (0x80 | (c >> 12 & 0x3F));
+    b[2] = (uint8_t) (0x80 | (c >> 6 & 0x3F));
+    b[3] = (uint8_t) (0x80 | (c & 0x3F));
+    return 4;
+}
+
+// This function returns what the character c is to the tokenizer. The ASCII word characters are [A-Za-z0-9_].
+CharClass utf8_class(uint32_t c) {
+    if (c < 0x80) {
+        bool word = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+        return word ? CHAR_WORD : CHAR_OTHER;
+    }
+    if (in_spans(alone_spans, sizeof(alone_spans) / sizeof(Span), c)) {
+        return CHAR_ALONE;
+    }
+    return in_spans(word_spans, sizeof(word_spans) / sizeof(Span), c) ? CHAR_WORD : CHAR_OTHER;
+}
+
+// This function returns the simple case folding of the character c, which is its lowercase for most letters.
+uint32_t utf8_fold(uint32_t c) {
+    if (c < 0x80) {
+        return c >= 'A' && c <= 'Z' ? c | 0x20 : c;
+    }
+    return map(fold_mappings, sizeof(fold_mappings) / sizeof(Mapping), c);
+}
+
+// This function returns the simple uppercase mapping of the character c.
+uint32_t utf8_upper(uint32_t c) {
+    if (c < 0x80) {
+        return c >= 'a' && c <= 'z' ? c & ~0x20u : c;
+    }
+    return map(upper_mappings, sizeof(upper_mappings) / sizeof(Mapping), c);
+}
+
+// This function returns how many of the length bytes of s are ASCII before the first that is not. The bytes are
+// tested eight at a time.
+size_t utf8_ascii_prefix(const char *s, size_t length) {
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t block;
+        memcpy(&block, s + i, sizeof(block));
+        if (block & 0x8080808080808080ull) {
+            break;
+        }
+    }
+    while (i < length && (uint8_t) s[i] < 0x80) {
+        i += 1;
+    }
+    return i;
+}
+
+// This function returns whether the length bytes of s are all ASCII.
+bool utf8_is_ascii(const char *s, size_t length) {
+    return utf8_ascii_prefix(s, length) == length;
+}
+
+// This function writes the length bytes of s to out with every character case folded, which is how words are
+// looked up. Bytes that are not part of a well-formed character are copied as they are. Folding may lengthen the
+// text by half, so out must have room for 2 * length bytes.
+// Returns the number of bytes written.
+size_t utf8_fold_text(const char *s, size_t length, char *out) {
+    size_t n = 0;
+    for (size_t i = 0; i < length;) {
+        uint8_t b = (uint8_t) s[i];
+        if (b < 0x80) {
+            out[n++] = (char) (b >= 'A' && b <= 'Z' ? b | 0x20 : b);
+            i += 1;
+            continue;
+        }
+        uint32_t c = 0;
+        size_t size = utf8_decode(s + i, length - i, &c);
+        if (size <= 1) {
+            out[n++] = (char) b;
+            i += 1;
+            continue;
+        }
+        n += utf8_encode(utf8_fold(c), out + n);
+        i += size;
+    }
+    return n;
+}
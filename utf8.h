@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// What a character is to the tokenizer. A word is a run of word characters, but a character that stands alone, such
+// as a Chinese or Japanese ideograph or a hiragana letter, is a word by itself, since those scripts are written
+// without spaces between words.
+typedef enum { CHAR_OTHER, CHAR_WORD, CHAR_ALONE } CharClass;
+
+size_t utf8_decode(const char *s, size_t length, uint32_t *c);
+
+size_t utf8_encode(uint32_t c, char *out);
+
+CharClass utf8_class(uint32_t c);
+
+uint32_t utf8_fold(uint32_t c);
+
+uint32_t utf8_upper(uint32_t c);
+
+size_t utf8_ascii_prefix(const char *s, size_t length);
+
+bool utf8_is_ascii(const char *s, size_t length);
+
+size_t utf8_fold_text(const char *s, size_t length, char *out);